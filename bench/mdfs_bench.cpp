@@ -0,0 +1,525 @@
+// End-to-end benchmark of the CPU engine (run_mdfs) on synthetic data.
+//
+// Sweeps over the cartesian product of the listed parameter values and
+// writes a JSON report with wall time, throughput and peak RSS of each run.
+// Example:
+//   mdfs_bench --objects 1000,10000 --variables 1000 --dimensions 1,2,3
+//              --threads 1,4,16 --variants continuous,discrete --output out.json
+
+#include "cpu/api.h"
+#include "synthetic.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+class BenchOptions {
+public:
+    std::vector<size_t> objects = {1000};
+    std::vector<size_t> variables = {100};
+    std::vector<size_t> dimensions = {1, 2};
+    std::vector<size_t> divisions = {1};
+    std::vector<size_t> discretizations = {1};
+    std::vector<size_t> threads;  // empty means the OpenMP default
+    std::vector<std::string> variants = {"continuous"};
+    size_t interactions_2d = 1;
+    size_t interactions_3d = 1;
+    double positive_fraction = 0.5;
+    double zero_fraction = 0.0;
+    size_t decision_classes = 2;
+    size_t permutations = 0;  // of the decision, evaluated together with it
+    size_t bootstraps = 0;  // weightings of the objects evaluated together
+    size_t folds = 0;  // of cross-validation, each left out in turn together
+    size_t repeats = 1;
+    uint32_t seed = 0;
+    std::string output;
+    std::string write_data;  // only writes the data of the first configuration for the mdfs CLI
+};
+
+static std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static std::vector<size_t> parse_sizes(const std::string& list) {
+    std::vector<size_t> values;
+    for (const auto& item : split_list(list)) {
+        values.push_back(std::stoull(item));
+    }
+    return values;
+}
+
+static void usage() {
+    std::cerr <<
+        "usage: mdfs_bench [options]\n"
+        "  lists are comma-separated, all their combinations are run\n"
+        "  --objects LIST            number of objects (default 1000)\n"
+        "  --variables LIST          number of variables (default 100)\n"
+        "  --dimensions LIST         dimensions, 1 to 5 (default 1,2)\n"
+        "  --divisions LIST          divisions, 1 to 15; levels-1 for discrete (default 1)\n"
+        "  --discretizations LIST    discretizations, continuous only (default 1)\n"
+        "  --threads LIST            OpenMP threads (default: OpenMP default)\n"
+        "  --variants LIST           continuous and/or discrete (default continuous)\n"
+        "  --interactions-2d N       planted 2D interactions (default 1)\n"
+        "  --interactions-3d N       planted 3D interactions (default 1)\n"
+        "  --positive-fraction F     share of positive decisions (default 0.5)\n"
+        "  --zero-fraction F         share of discrete noise values that are 0 (default 0)\n"
+        "  --decision-classes N      2 to 8, more than 2 of equal shares (default 2)\n"
+        "  --permutations N          evaluate the decision and N permutations of it in one pass\n"
+        "                            (run_mdfs_decisions, 2 classes only)\n"
+        "  --bootstraps N            evaluate N bootstrap resamples (multiplicities of the objects)\n"
+        "                            in one pass (run_mdfs_replicates, 2 classes only)\n"
+        "  --folds K                 evaluate the training sets of K random folds of the objects\n"
+        "                            in one pass (run_mdfs_folds, 2 classes only)\n"
+        "  --repeats N               runs per configuration, the fastest is reported (default 1)\n"
+        "  --seed N                  seed for data generation and discretization (default 0)\n"
+        "  --output FILE             JSON report path (default stdout)\n"
+        "  --write-data PREFIX       write PREFIX.data.bin and PREFIX.decision.bin in the mdfs CLI\n"
+        "                            format for the first configuration instead of benchmarking,\n"
+        "                            with --permutations also PREFIX.decisions.bin (objects x decisions),\n"
+        "                            with --bootstraps PREFIX.replicates.bin (objects x resamples)\n"
+        "                            and PREFIX.weights.bin (the first resample alone),\n"
+        "                            with --folds PREFIX.folds.bin and PREFIX.weights.bin (the training\n"
+        "                            set of the first fold alone)\n";
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string name = argv[i];
+        if (name == "--help") {
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << name << "\n";
+            return false;
+        }
+        const std::string value = argv[++i];
+
+        if (name == "--objects") {
+            options.objects = parse_sizes(value);
+        } else if (name == "--variables") {
+            options.variables = parse_sizes(value);
+        } else if (name == "--dimensions") {
+            options.dimensions = parse_sizes(value);
+        } else if (name == "--divisions") {
+            options.divisions = parse_sizes(value);
+        } else if (name == "--discretizations") {
+            options.discretizations = parse_sizes(value);
+        } else if (name == "--threads") {
+            options.threads = parse_sizes(value);
+        } else if (name == "--variants") {
+            options.variants = split_list(value);
+        } else if (name == "--interactions-2d") {
+            options.interactions_2d = std::stoull(value);
+        } else if (name == "--interactions-3d") {
+            options.interactions_3d = std::stoull(value);
+        } else if (name == "--positive-fraction") {
+            options.positive_fraction = std::stod(value);
+        } else if (name == "--zero-fraction") {
+            options.zero_fraction = std::stod(value);
+        } else if (name == "--decision-classes") {
+            options.decision_classes = std::stoull(value);
+        } else if (name == "--repeats") {
+            options.repeats = std::max<size_t>(1, std::stoull(value));
+        } else if (name == "--permutations") {
+            options.permutations = std::stoull(value);
+        } else if (name == "--bootstraps") {
+            options.bootstraps = std::stoull(value);
+        } else if (name == "--folds") {
+            options.folds = std::stoull(value);
+        } else if (name == "--seed") {
+            options.seed = std::stoul(value);
+        } else if (name == "--output") {
+            options.output = value;
+        } else if (name == "--write-data") {
+            options.write_data = value;
+        } else {
+            std::cerr << "unknown option " << name << "\n";
+            return false;
+        }
+    }
+
+    for (size_t d : options.dimensions) {
+        if (d < 1 || d > 5) {
+            std::cerr << "dimensions must be between 1 and 5\n";
+            return false;
+        }
+    }
+    for (size_t d : options.divisions) {
+        if (d < 1 || d > 15) {
+            std::cerr << "divisions must be between 1 and 15\n";
+            return false;
+        }
+    }
+    if (options.zero_fraction < 0.0 || options.zero_fraction >= 1.0) {
+        std::cerr << "zero fraction must be at least 0 and below 1\n";
+        return false;
+    }
+    if (options.decision_classes < 2 || options.decision_classes > max_decision_classes) {
+        std::cerr << "decision classes must be between 2 and 8\n";
+        return false;
+    }
+    const int many_decisions = (options.permutations > 0) + (options.bootstraps > 0) + (options.folds > 0);
+    if (many_decisions > 0 && options.decision_classes != 2) {
+        std::cerr << "permutations, bootstraps and folds need 2 decision classes\n";
+        return false;
+    }
+    if (many_decisions > 1) {
+        std::cerr << "permutations, bootstraps and folds are mutually exclusive\n";
+        return false;
+    }
+    if (options.folds == 1) {
+        std::cerr << "folds need to be at least 2\n";
+        return false;
+    }
+    for (const auto& variant : options.variants) {
+        if (variant != "continuous" && variant != "discrete") {
+            std::cerr << "unknown variant " << variant << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// resets the peak RSS of the process (Linux only, ignored elsewhere)
+static void reset_peak_rss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs) {
+        clear_refs << "5";
+    }
+}
+
+static long peak_rss_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atol(line.c_str() + 6);
+        }
+    }
+
+    // not resettable, the peak of the whole process
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+template <typename T>
+static bool write_binary(const std::string& path, const std::vector<T>& values) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    return static_cast<bool>(out);
+}
+
+// continuous data as float64, discrete as int32, the decision as int32
+static bool write_data(const SyntheticData& synthetic, bool discrete, const std::string& prefix) {
+    const bool data_written = discrete
+        ? write_binary(prefix + ".data.bin", synthetic.data_discrete)
+        : write_binary(prefix + ".data.bin", synthetic.data);
+    return data_written && write_binary(prefix + ".decision.bin", synthetic.decision);
+}
+
+// the decision followed by n permutations of it, one after another
+static std::vector<int> permuted_decisions(const std::vector<int>& decision, size_t n, uint32_t seed) {
+    std::vector<int> decisions(decision);
+    decisions.reserve(decision.size() * (n + 1));
+    std::mt19937 random_generator(seed);
+    std::vector<int> permuted(decision);
+    for (size_t i = 0; i < n; i++) {
+        std::shuffle(permuted.begin(), permuted.end(), random_generator);
+        decisions.insert(decisions.end(), permuted.begin(), permuted.end());
+    }
+    return decisions;
+}
+
+// multiplicities of the objects in n resamples (with replacement) of them, one after another
+static std::vector<int> bootstrap_weights(size_t n_objects, size_t n, uint32_t seed) {
+    std::vector<int> weights(n_objects * n, 0);
+    std::mt19937 random_generator(seed);
+    std::uniform_int_distribution<size_t> object(0, n_objects - 1);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t o = 0; o < n_objects; o++) {
+            weights[i * n_objects + object(random_generator)]++;
+        }
+    }
+    return weights;
+}
+
+// fold of each object, of k folds of sizes differing by at most 1
+static std::vector<int> random_folds(size_t n_objects, size_t k, uint32_t seed) {
+    std::vector<int> folds(n_objects);
+    for (size_t o = 0; o < n_objects; o++) {
+        folds[o] = o % k;
+    }
+    std::mt19937 random_generator(seed);
+    std::shuffle(folds.begin(), folds.end(), random_generator);
+    return folds;
+}
+
+class BenchResult {
+public:
+    double wall_seconds = 0.0;
+    uint64_t tuples = 0;
+    long peak_rss_kb = 0;
+    size_t planted_in_top = 0;
+};
+
+static BenchResult run_once(
+    const SyntheticData& synthetic,
+    bool discrete,
+    size_t dimensions,
+    size_t divisions,
+    size_t discretizations,
+    uint32_t seed,
+    const std::vector<int>& decisions,  // empty - only the decision of the data, with run_mdfs
+    const std::vector<int>& replicate_weights,  // instead of decisions, of the decision of the data
+    const std::vector<int>& folds,  // instead of decisions, of the objects
+    size_t n_folds
+) {
+    RawData raw_data(
+        RawDataInfo(synthetic.object_count, synthetic.variable_count),
+        discrete ? static_cast<const void*>(synthetic.data_discrete.data()) : static_cast<const void*>(synthetic.data.data()),
+        synthetic.decision.data());
+
+    MDFSInfo mdfs_info(
+        dimensions,
+        divisions,
+        discretizations,
+        0.25f,
+        0.0f,
+        nullptr,
+        0,
+        false,
+        nullptr,
+        false
+    );
+
+    std::unique_ptr<const DiscretizationInfo> dfi;
+    if (!discrete) {
+        const double range = discretizations > 1 ? recommended_range(synthetic.object_count, dimensions, divisions) : 0.0;
+        dfi.reset(new DiscretizationInfo(seed, discretizations, divisions, range));
+    }
+
+    MDFSOutput mdfs_output(MDFSOutputType::MaxIGs, dimensions, synthetic.variable_count, 0);
+    MDFSRunStats run_stats;
+    mdfs_output.setRunStats(&run_stats);
+    std::vector<float> decisions_max_igs;  // of the first decision (or replicate) first
+    const bool single = decisions.empty() && replicate_weights.empty() && folds.empty();
+
+    reset_peak_rss();
+    const auto start = std::chrono::steady_clock::now();
+    if (single) {
+        // selects the engine of the number of decision classes
+        run_mdfs(mdfs_info, &raw_data, nullptr, std::move(dfi), StatMode::MutualInformation, mdfs_output);
+    } else if (!decisions.empty()) {
+        run_mdfs_decisions(mdfs_info, &raw_data, decisions.data(), decisions.size() / synthetic.object_count,
+                           std::move(dfi), decisions_max_igs);
+    } else if (!replicate_weights.empty()) {
+        run_mdfs_replicates(mdfs_info, &raw_data, replicate_weights.data(), replicate_weights.size() / synthetic.object_count,
+                            std::move(dfi), decisions_max_igs);
+    } else {
+        run_mdfs_folds(mdfs_info, &raw_data, folds.data(), n_folds, std::move(dfi), decisions_max_igs);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    BenchResult result;
+    result.wall_seconds = std::chrono::duration<double>(end - start).count();
+    result.peak_rss_kb = peak_rss_kb();
+    result.tuples = 0;
+    if (single) {
+        for (const auto& thread_stats : run_stats.threads) {
+            result.tuples += thread_stats.tuples_evaluated;
+        }
+    } else {
+        // each of them once for all the decisions
+        result.tuples = binomial(synthetic.variable_count, dimensions) * discretizations;
+        mdfs_output.max_igs->assign(decisions_max_igs.begin(), decisions_max_igs.begin() + synthetic.variable_count);
+    }
+
+    // how many planted variables made it to the top by IG
+    std::vector<size_t> order(synthetic.variable_count);
+    for (size_t v = 0; v < order.size(); v++) {
+        order[v] = v;
+    }
+    const std::vector<float>& igs = *mdfs_output.max_igs;
+    const size_t top = std::min(synthetic.planted.size(), order.size());
+    std::partial_sort(order.begin(), order.begin() + top, order.end(),
+                      [&igs](size_t a, size_t b) { return igs[a] > igs[b]; });
+    result.planted_in_top = 0;
+    for (size_t i = 0; i < top; i++) {
+        result.planted_in_top += std::find(synthetic.planted.begin(), synthetic.planted.end(), order[i]) != synthetic.planted.end();
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    if (options.threads.empty()) {
+        #ifdef _OPENMP
+        options.threads.push_back(omp_get_max_threads());
+        #else
+        options.threads.push_back(1);
+        #endif
+    }
+
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"mdfs_bench\",\n  \"runs\": [";
+    bool first_run = true;
+
+    SyntheticData synthetic;
+    SyntheticSpec last_spec;
+    bool generated = false;
+
+    for (size_t objects : options.objects) {
+        for (size_t variables : options.variables) {
+            for (const auto& variant : options.variants) {
+                const bool discrete = variant == "discrete";
+
+                for (size_t divisions : options.divisions) {
+                    SyntheticSpec spec;
+                    spec.objects = objects;
+                    spec.variables = variables;
+                    spec.interactions_2d = options.interactions_2d;
+                    spec.interactions_3d = options.interactions_3d;
+                    spec.positive_fraction = options.positive_fraction;
+                    spec.decision_classes = options.decision_classes;
+                    spec.levels = discrete ? divisions + 1 : 0;
+                    spec.zero_fraction = options.zero_fraction;
+                    spec.seed = options.seed;
+
+                    // continuous data does not depend on divisions
+                    if (!generated || last_spec.objects != spec.objects || last_spec.variables != spec.variables
+                            || last_spec.levels != spec.levels) {
+                        synthetic = generate_synthetic(spec);
+                        last_spec = spec;
+                        generated = true;
+                    }
+
+                    std::vector<int> decisions;
+                    if (options.permutations > 0) {
+                        decisions = permuted_decisions(synthetic.decision, options.permutations, options.seed);
+                    }
+                    std::vector<int> replicate_weights;
+                    if (options.bootstraps > 0) {
+                        replicate_weights = bootstrap_weights(objects, options.bootstraps, options.seed);
+                    }
+                    std::vector<int> folds;
+                    std::vector<int> first_weights;  // written for a single run
+                    if (options.folds > 0) {
+                        folds = random_folds(objects, options.folds, options.seed);
+                        for (int fold : folds) {
+                            first_weights.push_back(fold != 0);
+                        }
+                    } else if (!replicate_weights.empty()) {
+                        first_weights.assign(replicate_weights.begin(), replicate_weights.begin() + objects);
+                    }
+
+                    if (!options.write_data.empty()) {
+                        if (!write_data(synthetic, discrete, options.write_data)
+                                || (!decisions.empty() && !write_binary(options.write_data + ".decisions.bin", decisions))
+                                || (!replicate_weights.empty() && !write_binary(options.write_data + ".replicates.bin", replicate_weights))
+                                || (!folds.empty() && !write_binary(options.write_data + ".folds.bin", folds))
+                                || (!first_weights.empty() && !write_binary(options.write_data + ".weights.bin", first_weights))) {
+                            std::cerr << "cannot write " << options.write_data << "\n";
+                            return 1;
+                        }
+                        return 0;
+                    }
+
+                    for (size_t dimensions : options.dimensions) {
+                        for (size_t discretizations : options.discretizations) {
+                            if (discrete && discretizations != options.discretizations.front()) {
+                                continue;  // discrete data is not discretized
+                            }
+
+                            for (size_t threads : options.threads) {
+                                #ifdef _OPENMP
+                                omp_set_num_threads(threads);
+                                #endif
+
+                                BenchResult best;
+                                for (size_t r = 0; r < options.repeats; r++) {
+                                    BenchResult result = run_once(synthetic, discrete, dimensions, divisions,
+                                                                  discrete ? 1 : discretizations, options.seed, decisions,
+                                                                  replicate_weights, folds, options.folds);
+                                    if (r == 0 || result.wall_seconds < best.wall_seconds) {
+                                        best = result;
+                                    }
+                                }
+
+                                std::cerr << variant << " n=" << objects << " V=" << variables << " dim=" << dimensions
+                                          << " div=" << divisions << " disc=" << discretizations << " thr=" << threads
+                                          << ": " << best.wall_seconds << "s\n";
+
+                                json << (first_run ? "\n" : ",\n") << "    {"
+                                     << "\"variant\": \"" << variant << "\", "
+                                     << "\"objects\": " << objects << ", "
+                                     << "\"variables\": " << variables << ", "
+                                     << "\"dimensions\": " << dimensions << ", "
+                                     << "\"divisions\": " << divisions << ", "
+                                     << "\"discretizations\": " << (discrete ? 1 : discretizations) << ", "
+                                     << "\"threads\": " << threads << ", "
+                                     << "\"positive_fraction\": " << options.positive_fraction << ", "
+                                     << "\"zero_fraction\": " << options.zero_fraction << ", "
+                                     << "\"decision_classes\": " << options.decision_classes << ", "
+                                     << "\"decisions\": " << options.permutations + 1 << ", "
+                                     << "\"bootstraps\": " << options.bootstraps << ", "
+                                     << "\"folds\": " << options.folds << ", "
+                                     << "\"wall_seconds\": " << best.wall_seconds << ", "
+                                     << "\"tuples\": " << best.tuples << ", "
+                                     << "\"tuples_per_second\": " << (best.wall_seconds > 0 ? best.tuples / best.wall_seconds : 0.0) << ", "
+                                     << "\"peak_rss_kb\": " << best.peak_rss_kb << ", "
+                                     << "\"planted\": " << synthetic.planted.size() << ", "
+                                     << "\"planted_in_top\": " << best.planted_in_top
+                                     << "}";
+                                first_run = false;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    json << "\n  ]\n}\n";
+
+    if (options.output.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(options.output);
+        if (!out) {
+            std::cerr << "cannot write " << options.output << "\n";
+            return 1;
+        }
+        out << json.str();
+    }
+
+    return 0;
+}
@@ -0,0 +1,441 @@
+// Microbenchmarks of the CPU engine building blocks.
+//
+// Each case is identified by its primitive (e.g. count_counters<2,3>) and its
+// variant (the implementation, "scalar" for the current one). Alternative
+// implementations are meant to be registered as further variants of the same
+// primitive so that they are measured on identical (fixed-seed) inputs.
+// Example:
+//   mdfs_microbench --objects 100000 --divisions 1,2 --filter count --output out.json
+
+#include "cpu/common.h"
+#include "cpu/discretize.h"
+#include "cpu/entropy.h"
+#include "cpu/mdfs_count_counters.h"
+#include "cpu/mdfs_reduce_counters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+class MicroCase {
+public:
+    std::string primitive;
+    std::string variant;
+    size_t divisions;
+    size_t objects;  // per call, 0 if not applicable
+    size_t cubes;  // per call, 0 if not applicable
+    size_t items;  // other units per call (e.g. tuples), 0 if not applicable
+    std::function<float()> run;  // returns something depending on the result to keep it alive
+};
+
+class MicroOptions {
+public:
+    size_t objects = 100000;
+    size_t variables = 200;
+    std::vector<size_t> divisions = {1, 2};
+    double min_time = 0.2;
+    std::string filter;
+    std::string output;
+};
+
+// fixed-seed inputs shared by all the cases of a given divisions value
+class MicroInputs {
+public:
+    static constexpr size_t n_columns = 6;  // up to 5 dimensions plus contrast
+
+    size_t n_objects;
+    size_t n_classes;
+    std::vector<uint8_t> data;  // n_columns columns
+    std::vector<uint8_t> decision;
+    std::vector<double> raw;
+    std::vector<double> sorted_raw;
+
+    MicroInputs(size_t n_objects, size_t divisions) : n_objects(n_objects), n_classes(divisions + 1) {
+        std::mt19937 random_generator(divisions);
+        std::uniform_int_distribution<int> bucket(0, divisions);
+        std::uniform_int_distribution<int> binary(0, 1);
+        std::normal_distribution<double> normal(0.0, 1.0);
+
+        data.resize(n_columns * n_objects);
+        for (auto& value : data) {
+            value = bucket(random_generator);
+        }
+        decision.resize(n_objects);
+        for (auto& value : decision) {
+            value = binary(random_generator);
+        }
+        raw.resize(n_objects);
+        for (auto& value : raw) {
+            value = normal(random_generator);
+        }
+        sorted_raw = raw;
+        std::sort(sorted_raw.begin(), sorted_raw.end());
+    }
+};
+
+static size_t ipow(size_t base, size_t exponent) {
+    size_t result = 1;
+    for (size_t i = 0; i < exponent; i++) {
+        result *= base;
+    }
+    return result;
+}
+
+// n_dimensions counts the contrast variable too when with_contrast
+template <uint8_t n_decision_classes, uint8_t n_dimensions, bool with_contrast>
+static void add_count_counters_case(std::vector<MicroCase>& cases, const MicroInputs& inputs, size_t divisions) {
+    constexpr uint8_t n_tuple_dimensions = with_contrast ? n_dimensions - 1 : n_dimensions;
+    const size_t n_cubes = ipow(inputs.n_classes, n_dimensions);
+
+    auto counters = std::make_shared<std::vector<float>>(n_decision_classes * n_cubes);
+    auto d = std::make_shared<std::vector<size_t>>(std::vector<size_t>{
+        ipow(inputs.n_classes, 2), ipow(inputs.n_classes, 3), ipow(inputs.n_classes, 4)});
+
+    MicroCase micro_case;
+    micro_case.primitive = std::string("count_counters<") + std::to_string(n_decision_classes) + ","
+                         + std::to_string(n_tuple_dimensions) + (with_contrast ? ",contrast>" : ">");
+    micro_case.variant = "scalar";
+    micro_case.divisions = divisions;
+    micro_case.objects = inputs.n_objects;
+    micro_case.cubes = n_cubes;
+    micro_case.items = 0;
+    micro_case.run = [&inputs, counters, d, n_cubes]() {
+        const size_t tuple[5] = {0, 1, 2, 3, 4};
+        const float p[2] = {0.25f, 0.25f};
+        count_counters<n_decision_classes, n_tuple_dimensions, with_contrast>(
+            inputs.data.data(), inputs.data.data() + 5 * inputs.n_objects, inputs.decision.data(),
+            inputs.n_objects, inputs.n_classes, tuple, 0, counters->data(), nullptr, n_cubes, p, d->data());  // fewer than float_exact_objects
+        return (*counters)[0];
+    };
+    cases.push_back(micro_case);
+}
+
+template <uint8_t n_decision_classes>
+static void add_count_counters_cases(std::vector<MicroCase>& cases, const MicroInputs& inputs, size_t divisions) {
+    add_count_counters_case<n_decision_classes, 1, false>(cases, inputs, divisions);
+    add_count_counters_case<n_decision_classes, 2, false>(cases, inputs, divisions);
+    add_count_counters_case<n_decision_classes, 3, false>(cases, inputs, divisions);
+    add_count_counters_case<n_decision_classes, 4, false>(cases, inputs, divisions);
+    add_count_counters_case<n_decision_classes, 5, false>(cases, inputs, divisions);
+    if (n_decision_classes > 1) {
+        add_count_counters_case<n_decision_classes, 2, true>(cases, inputs, divisions);
+        add_count_counters_case<n_decision_classes, 3, true>(cases, inputs, divisions);
+        add_count_counters_case<n_decision_classes, 4, true>(cases, inputs, divisions);
+        add_count_counters_case<n_decision_classes, 5, true>(cases, inputs, divisions);
+    }
+}
+
+static void add_reduce_counters_cases(std::vector<MicroCase>& cases, const MicroInputs& inputs, size_t divisions) {
+    for (size_t n_dimensions = 2; n_dimensions <= 5; n_dimensions++) {
+        const size_t n_cubes = ipow(inputs.n_classes, n_dimensions);
+        auto in = std::make_shared<std::vector<float>>(n_cubes);
+        for (size_t c = 0; c < n_cubes; c++) {
+            (*in)[c] = c % 7 + 0.25f;
+        }
+        auto out = std::make_shared<std::vector<float>>(n_cubes / inputs.n_classes);
+
+        for (size_t v = 0, stride = 1; v < n_dimensions; v++, stride *= inputs.n_classes) {
+            MicroCase micro_case;
+            micro_case.primitive = "reduce_counters<" + std::to_string(n_dimensions) + ",stride=" + std::to_string(stride) + ">";
+            micro_case.variant = "scalar";
+            micro_case.divisions = divisions;
+            micro_case.objects = 0;
+            micro_case.cubes = n_cubes;
+            micro_case.items = 0;
+            const size_t n_classes = inputs.n_classes;
+            micro_case.run = [in, out, n_classes, n_cubes, stride]() {
+                std::fill(out->begin(), out->end(), 0.0f);
+                reduce_counters(n_classes, n_cubes, in->data(), out->data(), stride);
+                return (*out)[0];
+            };
+            cases.push_back(micro_case);
+        }
+    }
+}
+
+static void add_entropy_cases(std::vector<MicroCase>& cases, const MicroInputs& inputs, size_t divisions) {
+    for (size_t n_dimensions = 1; n_dimensions <= 5; n_dimensions++) {
+        const size_t n_cubes = ipow(inputs.n_classes, n_dimensions);
+        auto counters = std::make_shared<std::vector<float>>(4 * n_cubes);
+        for (size_t c = 0; c < 4 * n_cubes; c++) {
+            (*counters)[c] = c % 13 + 0.25f;
+        }
+
+        MicroCase micro_case;
+        micro_case.variant = "scalar";
+        micro_case.divisions = divisions;
+        micro_case.objects = 0;
+        micro_case.cubes = n_cubes;
+        micro_case.items = 0;
+
+        micro_case.primitive = "conditional_entropy<2,cubes=" + std::to_string(n_cubes) + ">";
+        micro_case.run = [counters, n_cubes]() {
+            return conditional_entropy<2>(n_cubes, counters->data());
+        };
+        cases.push_back(micro_case);
+
+        micro_case.primitive = "conditional_entropy<4,cubes=" + std::to_string(n_cubes) + ">";
+        micro_case.run = [counters, n_cubes]() {
+            return conditional_entropy<4>(n_cubes, counters->data());
+        };
+        cases.push_back(micro_case);
+
+        micro_case.primitive = "entropy<cubes=" + std::to_string(n_cubes) + ">";
+        micro_case.run = [counters, n_cubes]() {
+            return entropy(n_cubes * 7.0f, n_cubes, counters->data());
+        };
+        cases.push_back(micro_case);
+    }
+}
+
+static void add_discretize_cases(std::vector<MicroCase>& cases, const MicroInputs& inputs, size_t divisions) {
+    auto out = std::make_shared<std::vector<uint8_t>>(inputs.n_objects);
+
+    MicroCase micro_case;
+    micro_case.primitive = "discretize";
+    micro_case.variant = "scalar";
+    micro_case.divisions = divisions;
+    micro_case.objects = inputs.n_objects;
+    micro_case.cubes = 0;
+    micro_case.items = 0;
+    micro_case.run = [&inputs, out, divisions]() {
+        discretize(0, 0, 0, divisions, inputs.n_objects, inputs.raw.data(), inputs.sorted_raw, out->data(), 0.5);
+        return float((*out)[0]);
+    };
+    cases.push_back(micro_case);
+
+    // discretize needs sorted input, this is what precedes it in the engine
+    micro_case.primitive = "sort";
+    micro_case.run = [&inputs]() {
+        std::vector<double> sorted(inputs.raw);
+        std::sort(sorted.begin(), sorted.end());
+        return float(sorted[0]);
+    };
+    cases.push_back(micro_case);
+}
+
+template <uint8_t n_dimensions>
+static void add_tuple_generator_case(std::vector<MicroCase>& cases, size_t n_variables) {
+    // limit the number of tuples per call to keep calls short
+    const size_t n_tuples = std::min<uint64_t>(binomial(n_variables, n_dimensions), 1000000);
+
+    MicroCase micro_case;
+    micro_case.variant = "scalar";
+    micro_case.divisions = 0;
+    micro_case.objects = 0;
+    micro_case.cubes = 0;
+    micro_case.items = n_tuples;
+
+    micro_case.primitive = "TupleGenerator<" + std::to_string(n_dimensions) + ">::next";
+    micro_case.run = [n_variables, n_tuples]() {
+        TupleGenerator<n_dimensions> generator(n_variables);
+        generator.reset();
+        size_t tuple[n_dimensions];
+        size_t sum = 0;
+        for (size_t i = 0; i < n_tuples && generator.hasNext(); i++) {
+            generator.next(tuple);
+            sum += tuple[n_dimensions-1];
+        }
+        return float(sum);
+    };
+    cases.push_back(micro_case);
+
+    micro_case.primitive = "TupleGenerator<" + std::to_string(n_dimensions) + ">::skip";
+    micro_case.run = [n_variables, n_tuples]() {
+        TupleGenerator<n_dimensions> generator(n_variables);
+        generator.reset();
+        size_t skipped = 0;
+        for (size_t i = 0; i < n_tuples && generator.hasNext(); i++) {
+            generator.skip();
+            skipped++;
+        }
+        return float(skipped);
+    };
+    cases.push_back(micro_case);
+
+    // every tenth variable interesting, tuples without them are not generated
+    micro_case.primitive = "TupleGenerator<" + std::to_string(n_dimensions) + ">::next(interesting)";
+    micro_case.run = [n_variables, n_tuples]() {
+        std::vector<int> interesting_vars;
+        for (size_t v = 0; v < n_variables; v += 10) {
+            interesting_vars.push_back(v);
+        }
+        TupleGenerator<n_dimensions> generator(n_variables, interesting_vars.data(), interesting_vars.size());
+        generator.reset();
+        size_t tuple[n_dimensions];
+        size_t sum = 0;
+        for (size_t i = 0; i < n_tuples && generator.hasNext(); i++) {
+            generator.next(tuple);
+            sum += tuple[n_dimensions-1];
+        }
+        return float(sum);
+    };
+    cases.push_back(micro_case);
+
+    micro_case.primitive = "TupleGenerator<" + std::to_string(n_dimensions) + ">::unrank";
+    micro_case.items = std::min<size_t>(n_tuples, 10000);
+    micro_case.run = [n_variables, n_tuples]() {
+        TupleGenerator<n_dimensions> generator(n_variables);
+        const uint64_t step = generator.count() / std::min<size_t>(n_tuples, 10000);
+        size_t tuple[n_dimensions];
+        size_t sum = 0;
+        for (uint64_t rank = 0; rank < generator.count(); rank += step) {
+            generator.unrank(rank, tuple);
+            sum += tuple[0];
+        }
+        return float(sum);
+    };
+    cases.push_back(micro_case);
+}
+
+// ns per call, the call is repeated for at least min_time seconds
+static double measure(const MicroCase& micro_case, double min_time) {
+    typedef std::chrono::steady_clock clock;
+
+    volatile float sink = micro_case.run();  // warm-up
+
+    size_t calls = 0;
+    const clock::time_point start = clock::now();
+    double elapsed = 0.0;
+    do {
+        sink = sink + micro_case.run();
+        calls++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < min_time);
+
+    return elapsed * 1e9 / calls;
+}
+
+static std::vector<size_t> parse_sizes(const std::string& list) {
+    std::vector<size_t> values;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(std::stoull(item));
+        }
+    }
+    return values;
+}
+
+static void usage() {
+    std::cerr <<
+        "usage: mdfs_microbench [options]\n"
+        "  --objects N           objects per call (default 100000)\n"
+        "  --variables N         variables for TupleGenerator (default 200)\n"
+        "  --divisions LIST      comma-separated divisions, 1 to 15 (default 1,2)\n"
+        "  --min-time S          minimum measuring time per case in seconds (default 0.2)\n"
+        "  --filter TEXT         run only primitives containing TEXT\n"
+        "  --output FILE         JSON report path (default stdout)\n";
+}
+
+int main(int argc, char** argv) {
+    MicroOptions options;
+    for (int i = 1; i < argc; i++) {
+        const std::string name = argv[i];
+        if (name == "--help" || i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        const std::string value = argv[++i];
+
+        if (name == "--objects") {
+            options.objects = std::stoull(value);
+        } else if (name == "--variables") {
+            options.variables = std::stoull(value);
+        } else if (name == "--divisions") {
+            options.divisions = parse_sizes(value);
+        } else if (name == "--min-time") {
+            options.min_time = std::stod(value);
+        } else if (name == "--filter") {
+            options.filter = value;
+        } else if (name == "--output") {
+            options.output = value;
+        } else {
+            std::cerr << "unknown option " << name << "\n";
+            usage();
+            return 1;
+        }
+    }
+
+    for (size_t divisions : options.divisions) {
+        if (divisions < 1 || divisions > 15) {
+            std::cerr << "divisions must be between 1 and 15\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<MicroInputs>> inputs;
+    std::vector<MicroCase> cases;
+    for (size_t divisions : options.divisions) {
+        inputs.emplace_back(new MicroInputs(options.objects, divisions));
+        add_count_counters_cases<1>(cases, *inputs.back(), divisions);
+        add_count_counters_cases<2>(cases, *inputs.back(), divisions);
+        add_reduce_counters_cases(cases, *inputs.back(), divisions);
+        add_entropy_cases(cases, *inputs.back(), divisions);
+        add_discretize_cases(cases, *inputs.back(), divisions);
+    }
+    add_tuple_generator_case<1>(cases, options.variables);
+    add_tuple_generator_case<2>(cases, options.variables);
+    add_tuple_generator_case<3>(cases, options.variables);
+    add_tuple_generator_case<4>(cases, options.variables);
+    add_tuple_generator_case<5>(cases, options.variables);
+
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"mdfs_microbench\",\n  \"cases\": [";
+    bool first_case = true;
+
+    for (const auto& micro_case : cases) {
+        if (micro_case.primitive.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        const double ns_per_call = measure(micro_case, options.min_time);
+
+        std::cerr << micro_case.primitive << " [" << micro_case.variant << ", div=" << micro_case.divisions << "]: "
+                  << ns_per_call << " ns/call\n";
+
+        json << (first_case ? "\n" : ",\n") << "    {"
+             << "\"primitive\": \"" << micro_case.primitive << "\", "
+             << "\"variant\": \"" << micro_case.variant << "\", "
+             << "\"divisions\": " << micro_case.divisions << ", "
+             << "\"objects\": " << micro_case.objects << ", "
+             << "\"cubes\": " << micro_case.cubes << ", "
+             << "\"ns_per_call\": " << ns_per_call;
+        if (micro_case.objects > 0) {
+            json << ", \"ns_per_object\": " << ns_per_call / micro_case.objects;
+        }
+        if (micro_case.cubes > 0) {
+            json << ", \"ns_per_cube\": " << ns_per_call / micro_case.cubes;
+        }
+        if (micro_case.items > 0) {
+            json << ", \"ns_per_tuple\": " << ns_per_call / micro_case.items;
+        }
+        json << "}";
+        first_case = false;
+    }
+
+    json << "\n  ]\n}\n";
+
+    if (options.output.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(options.output);
+        if (!out) {
+            std::cerr << "cannot write " << options.output << "\n";
+            return 1;
+        }
+        out << json.str();
+    }
+
+    return 0;
+}
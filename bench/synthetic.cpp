@@ -0,0 +1,81 @@
+#include "synthetic.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+SyntheticData generate_synthetic(const SyntheticSpec& spec) {
+    const size_t n_planted = 2 * spec.interactions_2d + 3 * spec.interactions_3d;
+    if (n_planted > spec.variables) {
+        throw std::invalid_argument("more planted variables than variables");
+    }
+
+    SyntheticData result;
+    result.object_count = spec.objects;
+    result.variable_count = spec.variables;
+
+    std::mt19937 random_generator(spec.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    std::vector<double> values(spec.objects * spec.variables);
+    for (auto& value : values) {
+        value = uniform(random_generator);
+    }
+
+    // decision score: each interaction votes +1/-1 by the parity of its variables
+    std::vector<double> score(spec.objects, 0.0);
+    for (size_t o = 0; o < spec.objects; ++o) {
+        size_t v = 0;
+        for (size_t i = 0; i < spec.interactions_2d; ++i, v += 2) {
+            const bool parity = (values[v * spec.objects + o] > 0.5) != (values[(v+1) * spec.objects + o] > 0.5);
+            score[o] += parity ? 1.0 : -1.0;
+        }
+        for (size_t i = 0; i < spec.interactions_3d; ++i, v += 3) {
+            const bool parity = ((values[v * spec.objects + o] > 0.5) != (values[(v+1) * spec.objects + o] > 0.5))
+                             != (values[(v+2) * spec.objects + o] > 0.5);
+            score[o] += parity ? 1.0 : -1.0;
+        }
+        score[o] += spec.noise * normal(random_generator);
+    }
+
+    // threshold at the quantile giving the requested share of positives
+    std::vector<double> sorted_score(score);
+    std::sort(sorted_score.begin(), sorted_score.end());
+    size_t n_negative = static_cast<size_t>((1.0 - spec.positive_fraction) * spec.objects);
+    n_negative = std::min(std::max<size_t>(n_negative, 1), spec.objects - 1);
+    const double threshold = sorted_score[n_negative - 1];
+
+    result.decision.resize(spec.objects);
+    for (size_t o = 0; o < spec.objects; ++o) {
+        result.decision[o] = score[o] > threshold;
+    }
+    if (spec.decision_classes > 2) {
+        // class by the quantile of the score, the lowest scores are class 0
+        for (size_t o = 0; o < spec.objects; ++o) {
+            const size_t rank = std::lower_bound(sorted_score.begin(), sorted_score.end(), score[o]) - sorted_score.begin();
+            result.decision[o] = rank * spec.decision_classes / spec.objects;
+        }
+    }
+
+    for (size_t v = 0; v < n_planted; ++v) {
+        result.planted.push_back(v);
+    }
+
+    if (spec.levels == 0) {
+        result.data = std::move(values);
+    } else {
+        result.data_discrete.resize(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            double value = values[i];
+            // the planted variables stay uniform, the other values below zero_fraction
+            // are 0 and the rest is spread over all the levels
+            if (spec.zero_fraction > 0.0 && i >= n_planted * spec.objects) {
+                value = value < spec.zero_fraction ? 0.0 : (value - spec.zero_fraction) / (1.0 - spec.zero_fraction);
+            }
+            result.data_discrete[i] = std::min(static_cast<size_t>(value * spec.levels), spec.levels - 1);
+        }
+    }
+
+    return result;
+}
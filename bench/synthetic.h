@@ -0,0 +1,41 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Synthetic data with planted interactions.
+// Each planted interaction is a parity (XOR) of its variables being above the
+// median, so it is invisible in fewer dimensions than its own. Planted
+// variables come first (2D pairs, then 3D triples), the rest is noise.
+class SyntheticSpec {
+public:
+    size_t objects = 1000;
+    size_t variables = 100;
+    size_t interactions_2d = 1;
+    size_t interactions_3d = 1;
+    double positive_fraction = 0.5;  // decision imbalance
+    size_t decision_classes = 2;  // more than 2 split the score into equal shares
+    double noise = 0.5;  // std dev of the noise added to the decision score
+    size_t levels = 0;  // 0 means continuous, otherwise discrete with this many levels
+    double zero_fraction = 0.0;  // discrete only: share of the noise values that are 0, as in sparse data
+    uint32_t seed = 0;
+};
+
+class SyntheticData {
+public:
+    size_t object_count;
+    size_t variable_count;
+
+    std::vector<double> data;  // column-major, only for continuous
+    std::vector<int> data_discrete;  // column-major, only for discrete
+    std::vector<int> decision;
+
+    std::vector<size_t> planted;  // indices of the planted variables
+};
+
+SyntheticData generate_synthetic(const SyntheticSpec& spec);
+
+#endif
@@ -0,0 +1,28 @@
+# Compares the max IGs of a run with one decision (MAX_IGS, as written by
+# mdfs --mode max-igs) with the column of that decision (DECISION, from 1)
+# of a run with many of them (DECISIONS_MAX_IGS, as written by mdfs --decisions,
+# --replicate-weights or --folds); the column of a discretization (as written by
+# mdfs --discretization-output) is compared alike.
+# Usage: cmake -DMAX_IGS=a.tsv -DDECISIONS_MAX_IGS=b.tsv -DDECISION=1 -P compare_decision_igs.cmake
+
+file(STRINGS ${MAX_IGS} max_igs_lines)
+file(STRINGS ${DECISIONS_MAX_IGS} decisions_lines)
+
+list(LENGTH max_igs_lines line_count)
+list(LENGTH decisions_lines decisions_line_count)
+if(NOT line_count EQUAL decisions_line_count)
+  message(FATAL_ERROR "${MAX_IGS} and ${DECISIONS_MAX_IGS} differ in the number of variables")
+endif()
+
+math(EXPR last_line "${line_count} - 1")
+foreach(i RANGE 1 ${last_line})
+  list(GET max_igs_lines ${i} max_igs_line)
+  list(GET decisions_lines ${i} decisions_line)
+  string(REPLACE "\t" ";" max_igs_fields "${max_igs_line}")
+  string(REPLACE "\t" ";" decisions_fields "${decisions_line}")
+  list(GET max_igs_fields 1 expected)
+  list(GET decisions_fields ${DECISION} actual)
+  if(NOT expected STREQUAL actual)
+    message(FATAL_ERROR "variable ${i}: ${actual} instead of ${expected}")
+  endif()
+endforeach()
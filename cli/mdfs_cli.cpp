@@ -0,0 +1,1065 @@
+// Command-line driver of the CPU engine, the counterpart of ComputeMaxInfoGains
+// and ComputeInterestingTuples (and their discrete variants) without R.
+//
+// Inputs are raw little-endian binary files: the data matrix is column-major
+// (all objects of the first variable, then of the second and so on) of
+// float64 values (int32 with --discrete), the decision is an int32 vector of
+// classes 0..7 (0/1 except for MI). Continuous data may also be an MDFS column file (see
+// src/cpu/column_file.h) which is mapped instead of read. Discrete data may be
+// sparse: --data then holds the values other than 0, --sparse-objects their
+// objects (ascending in each variable) and --sparse-columns where each variable
+// starts (and the end), all int32. Genotypes may be read from a PLINK .bed
+// file (--bed, with the number of samples as --objects), which is mapped and
+// counted packed. With --uint8 discrete data is uint8 instead, which the engine
+// counts in place. Many binary decisions may be evaluated at once (--decisions,
+// an int32 column-major matrix of objects by decisions), as well as many
+// weightings of the objects (--replicate-weights, e.g. bootstrap resamples,
+// of the same layout) or the training sets of cross-validation (--folds, an
+// int32 vector of the folds of the objects). Results are written as
+// tab-separated text with a header line, with variables, tuples and
+// discretizations numbered from 1 as in R.
+// Example:
+//   mdfs --data x.bin --objects 500 --decision y.bin --dimensions 2
+//        --discretizations 30 --mode tuples --output igs.tsv
+
+#include "cpu/api.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+class CliOptions {
+public:
+    std::string data;
+    std::string decision;
+    std::string decisions;
+    std::string replicate_weights;
+    std::string folds;
+    std::string weights;
+    std::string contrast;
+    std::vector<int> contrast_vars;  // 0-based, in the order given
+    std::string i_lower;
+    size_t objects = 0;
+    bool discrete = false;
+    bool uint8 = false;
+    std::string sparse_columns;
+    std::string sparse_objects;
+    std::string bed;
+    std::string mode = "max-igs";
+    StatMode stat_mode = StatMode::MutualInformation;
+    size_t dimensions = 1;
+    size_t divisions = 1;
+    size_t discretizations = 1;
+    uint32_t seed = 0;
+    double range = -1.0;  // negative means the recommended one
+    float pseudo = 0.25f;
+    float ig_thr = 0.0f;
+    std::vector<int> interesting_vars;  // 0-based, sorted
+    bool require_all_vars = false;
+    bool average = false;
+    int threads = 0;  // 0 means the OpenMP default
+    ParallelMode parallel_mode = ParallelMode::Auto;
+    size_t tile_size = 0;  // 0 means in memory
+    std::string tile_dir;
+    size_t lower_entropies_bytes = size_t(256) << 20;  // the default of MDFSInfo
+    bool prune = false;
+    bool deduplicate = false;
+    size_t screen_dimensions = 2;
+    size_t screen_top = 0;  // 0 means no screening
+    bool screen_partners = false;
+    std::string screen_output;
+    bool progress = false;
+    std::string output;
+    std::string contrast_output;
+    std::string discretization_output;
+    std::string convert;  // column file to write the data to instead of computing
+    std::string convert_sparse;  // prefix of the sparse files to write the discrete data to
+    std::string convert_bed;  // .bed file to write the discrete data to
+    std::string convert_uint8;  // file to write the discrete data to as uint8
+    bool float32 = false;
+};
+
+static void usage() {
+    std::cerr <<
+        "usage: mdfs --data FILE [--objects N] [options]\n"
+        "input\n"
+        "  --data FILE               column-major float64 matrix (int32 with --discrete) or column file\n"
+        "  --objects N               number of objects (rows), variables follow from the file size;\n"
+        "                            not needed for column files\n"
+        "  --discrete                data is already discrete (int32 values 0..15), not discretized\n"
+        "  --uint8                   --discrete --data and --contrast hold uint8 values instead of int32,\n"
+        "                            --data is counted in place without --require-all-vars\n"
+        "  --decision FILE           int32 vector of classes 0..7, 0/1 except for MI\n"
+        "                            (required except for matching-tuples)\n"
+        "  --decisions FILE          instead of --decision: int32 column-major matrix of 0/1 decisions\n"
+        "                            evaluated in one pass (max-igs only, an ig column for each)\n"
+        "  --replicate-weights FILE  int32 column-major matrix of multiplicities of the objects in each\n"
+        "                            replicate (e.g. bootstrap) evaluated in one pass with the binary\n"
+        "                            --decision (max-igs only, an ig column for each)\n"
+        "  --folds FILE              int32 vector of folds (0..K-1) of the objects, each left out in turn\n"
+        "                            in one pass with the binary --decision (max-igs only, an ig column\n"
+        "                            for the training set of each fold)\n"
+        "  --sparse-columns FILE     --discrete data is sparse: int32 offsets of the variables in --data\n"
+        "                            (variables + 1 of them), which holds only the values other than 0\n"
+        "  --sparse-objects FILE     int32 objects (numbered from 0) of the values in sparse --data\n"
+        "  --bed FILE                instead of --data: genotypes of a PLINK .bed file (variant-major,\n"
+        "                            none missing) of --objects samples, valued 0..2 by the second allele\n"
+        "  --weights FILE            int32 vector of multiplicities of the objects (--discrete only)\n"
+        "  --contrast FILE           contrast variables, the same format as --data (max-igs and tuples)\n"
+        "  --contrast-vars LIST      instead of --contrast: comma-separated variables (numbered from 1,\n"
+        "                            repetitions allowed) permuted into contrast variables with --seed\n"
+        "  --i-lower FILE            float64 vector of per-variable IG lower bounds (matching-tuples, 2D)\n"
+        "computation\n"
+        "  --mode MODE               max-igs (default), tuples (max IGs with their tuples) or matching-tuples\n"
+        "  --stat STAT               MI (default), H or VI, matching-tuples only\n"
+        "  --dimensions N            1 to 5 (default 1, matching-tuples needs at least 2)\n"
+        "  --divisions N             1 to 15 (default 1), for --discrete the highest value in data\n"
+        "  --discretizations N       continuous only (default 1)\n"
+        "  --seed N                  seed of the discretizations (default 0)\n"
+        "  --range R                 0 to 1 (default the same as GetRange in R)\n"
+        "  --pc-xi X                 pseudocount (default 0.25)\n"
+        "  --ig-thr X                IG threshold, matching-tuples only (default 0)\n"
+        "  --interesting-vars LIST   comma-separated variables (numbered from 1)\n"
+        "  --require-all-vars        tuples have to consist of interesting variables only\n"
+        "  --average                 average IGs over discretizations, matching-tuples only\n"
+        "  --threads N               OpenMP threads (default: OpenMP default)\n"
+        "  --parallel MODE           split tuples or objects among the threads: auto (default),\n"
+        "                            tuples or objects (dense data without contrast variables)\n"
+        "  --tile-size N             keep the discretized variables on disk in tiles of N variables\n"
+        "                            (out-of-core, not with contrast variables)\n"
+        "  --tile-dir DIR            directory for the tiles (default the system temporary directory)\n"
+        "  --lower-entropies-bytes N memory for lower-dimensional entropies kept in 3D+ (default 256 MiB,\n"
+        "                            0 - reduce the counters of each tuple instead)\n"
+        "  --prune                   skip tuples that cannot change the result (MI with decision,\n"
+        "                            not with --parallel objects or --tile-size),\n"
+        "                            their number is reported on stderr\n"
+        "  --deduplicate             count equal objects once with their multiplicity (--discrete only)\n"
+        "  --progress                report progress on stderr\n"
+        "screening (max-igs and tuples, the selected variables are the interesting ones)\n"
+        "  --screen-top K            first select the K variables with the highest max IGs\n"
+        "  --screen-dimensions N     of the screening, 1 or 2 (default 2)\n"
+        "  --screen-partners         in 2D select also the variables of the tuples of their max IGs\n"
+        "  --screen-output FILE      screening max IGs and the selected variables\n"
+        "output\n"
+        "  --output FILE             result path (default stdout)\n"
+        "  --contrast-output FILE    contrast max IGs path (required with contrast variables)\n"
+        "  --discretization-output FILE\n"
+        "                            max IGs of each discretization with their mean and variance\n"
+        "                            (max-igs and tuples)\n"
+        "conversion\n"
+        "  --convert FILE            only write continuous --data as a column file, column by column\n"
+        "  --float32                 store the column file values as float32 (default float64)\n"
+        "  --convert-sparse PREFIX   only write --discrete --data as sparse PREFIX.columns.bin,\n"
+        "                            PREFIX.objects.bin and PREFIX.values.bin\n"
+        "  --convert-bed FILE        only write --discrete --data (values 0..2) as a .bed file\n"
+        "  --convert-uint8 FILE      only write --discrete --data as uint8 values\n";
+}
+
+static bool parse_options(int argc, char** argv, CliOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string name = argv[i];
+        if (name == "--help") {
+            return false;
+        }
+
+        // flags
+        if (name == "--discrete") {
+            options.discrete = true;
+            continue;
+        } else if (name == "--uint8") {
+            options.uint8 = true;
+            continue;
+        } else if (name == "--require-all-vars") {
+            options.require_all_vars = true;
+            continue;
+        } else if (name == "--average") {
+            options.average = true;
+            continue;
+        } else if (name == "--progress") {
+            options.progress = true;
+            continue;
+        } else if (name == "--prune") {
+            options.prune = true;
+            continue;
+        } else if (name == "--deduplicate") {
+            options.deduplicate = true;
+            continue;
+        } else if (name == "--screen-partners") {
+            options.screen_partners = true;
+            continue;
+        } else if (name == "--float32") {
+            options.float32 = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << name << "\n";
+            return false;
+        }
+        const std::string value = argv[++i];
+
+        if (name == "--data") {
+            options.data = value;
+        } else if (name == "--objects") {
+            options.objects = std::stoull(value);
+        } else if (name == "--decision") {
+            options.decision = value;
+        } else if (name == "--decisions") {
+            options.decisions = value;
+        } else if (name == "--replicate-weights") {
+            options.replicate_weights = value;
+        } else if (name == "--folds") {
+            options.folds = value;
+        } else if (name == "--bed") {
+            options.bed = value;
+        } else if (name == "--sparse-columns") {
+            options.sparse_columns = value;
+        } else if (name == "--sparse-objects") {
+            options.sparse_objects = value;
+        } else if (name == "--weights") {
+            options.weights = value;
+        } else if (name == "--contrast") {
+            options.contrast = value;
+        } else if (name == "--contrast-vars") {
+            std::stringstream stream(value);
+            std::string item;
+            while (std::getline(stream, item, ',')) {
+                if (!item.empty()) {
+                    options.contrast_vars.push_back(std::stoi(item) - 1);
+                }
+            }
+        } else if (name == "--i-lower") {
+            options.i_lower = value;
+        } else if (name == "--mode") {
+            options.mode = value;
+        } else if (name == "--stat") {
+            if (value == "H") {
+                options.stat_mode = StatMode::Entropy;
+            } else if (value == "MI") {
+                options.stat_mode = StatMode::MutualInformation;
+            } else if (value == "VI") {
+                options.stat_mode = StatMode::VariationOfInformation;
+            } else {
+                std::cerr << "stat has to be one of MI, H or VI\n";
+                return false;
+            }
+        } else if (name == "--dimensions") {
+            options.dimensions = std::stoull(value);
+        } else if (name == "--divisions") {
+            options.divisions = std::stoull(value);
+        } else if (name == "--discretizations") {
+            options.discretizations = std::stoull(value);
+        } else if (name == "--seed") {
+            options.seed = std::stoul(value);
+        } else if (name == "--range") {
+            options.range = std::stod(value);
+        } else if (name == "--pc-xi") {
+            options.pseudo = std::stof(value);
+        } else if (name == "--ig-thr") {
+            options.ig_thr = std::stof(value);
+        } else if (name == "--interesting-vars") {
+            std::stringstream stream(value);
+            std::string item;
+            while (std::getline(stream, item, ',')) {
+                if (!item.empty()) {
+                    options.interesting_vars.push_back(std::stoi(item) - 1);
+                }
+            }
+            std::sort(options.interesting_vars.begin(), options.interesting_vars.end());
+            options.interesting_vars.erase(
+                std::unique(options.interesting_vars.begin(), options.interesting_vars.end()),
+                options.interesting_vars.end());
+        } else if (name == "--threads") {
+            options.threads = std::stoi(value);
+        } else if (name == "--parallel") {
+            if (value == "auto") {
+                options.parallel_mode = ParallelMode::Auto;
+            } else if (value == "tuples") {
+                options.parallel_mode = ParallelMode::Tuples;
+            } else if (value == "objects") {
+                options.parallel_mode = ParallelMode::Objects;
+            } else {
+                std::cerr << "unknown parallel mode " << value << "\n";
+                return false;
+            }
+        } else if (name == "--tile-size") {
+            options.tile_size = std::stoul(value);
+        } else if (name == "--tile-dir") {
+            options.tile_dir = value;
+        } else if (name == "--lower-entropies-bytes") {
+            options.lower_entropies_bytes = std::stoull(value);
+        } else if (name == "--screen-dimensions") {
+            options.screen_dimensions = std::stoull(value);
+        } else if (name == "--screen-top") {
+            options.screen_top = std::stoull(value);
+        } else if (name == "--screen-output") {
+            options.screen_output = value;
+        } else if (name == "--output") {
+            options.output = value;
+        } else if (name == "--contrast-output") {
+            options.contrast_output = value;
+        } else if (name == "--discretization-output") {
+            options.discretization_output = value;
+        } else if (name == "--convert") {
+            options.convert = value;
+        } else if (name == "--convert-sparse") {
+            options.convert_sparse = value;
+        } else if (name == "--convert-bed") {
+            options.convert_bed = value;
+        } else if (name == "--convert-uint8") {
+            options.convert_uint8 = value;
+        } else {
+            std::cerr << "unknown option " << name << "\n";
+            return false;
+        }
+    }
+
+    if (!options.bed.empty()) {
+        if (!options.data.empty() || !options.contrast.empty() || !options.sparse_columns.empty() || options.objects == 0) {
+            std::cerr << "--bed needs --objects and neither --data nor --contrast\n";
+            return false;
+        }
+        options.discrete = true;
+    } else if (options.data.empty()) {
+        std::cerr << "--data is required\n";
+        return false;
+    }
+    if (!options.convert.empty()) {
+        if (options.discrete || options.objects == 0) {
+            std::cerr << "--convert needs continuous data and --objects\n";
+            return false;
+        }
+        return true;
+    }
+    if (!options.convert_sparse.empty() || !options.convert_bed.empty() || !options.convert_uint8.empty()) {
+        if (!options.discrete || options.uint8 || options.objects == 0 || !options.sparse_columns.empty() || !options.bed.empty()) {
+            std::cerr << "--convert-sparse, --convert-bed and --convert-uint8 need dense int32 --discrete data and --objects\n";
+            return false;
+        }
+        return true;
+    }
+    if (options.sparse_columns.empty() != options.sparse_objects.empty()) {
+        std::cerr << "--sparse-columns and --sparse-objects go together\n";
+        return false;
+    }
+    if (!options.sparse_columns.empty() && !options.discrete) {
+        std::cerr << "sparse data has to be --discrete\n";
+        return false;
+    }
+    if (options.uint8 && (!options.discrete || !options.sparse_columns.empty() || !options.bed.empty())) {
+        std::cerr << "--uint8 needs dense --discrete data\n";
+        return false;
+    }
+    if (options.mode != "max-igs" && options.mode != "tuples" && options.mode != "matching-tuples") {
+        std::cerr << "unknown mode " << options.mode << "\n";
+        return false;
+    }
+    const int many_decisions = !options.decisions.empty() + !options.replicate_weights.empty() + !options.folds.empty();
+    if (many_decisions > 0) {
+        if (many_decisions > 1 || options.decision.empty() == options.decisions.empty() || options.mode != "max-igs"
+                || !options.weights.empty() || !options.contrast.empty() || !options.contrast_vars.empty()
+                || options.screen_top > 0 || options.tile_size > 0 || options.deduplicate) {
+            std::cerr << "one of --decisions, --replicate-weights and --folds (both with --decision) applies\n"
+                         "to max-igs without --weights, contrast variables, screening, --tile-size and --deduplicate\n";
+            return false;
+        }
+    } else if (options.mode != "matching-tuples" && options.decision.empty()) {
+        std::cerr << "--decision is required in " << options.mode << " mode\n";
+        return false;
+    }
+    if (options.mode == "tuples" && options.dimensions == 1) {
+        std::cerr << "tuples mode does not make sense in 1D\n";
+        return false;
+    }
+    if (options.mode == "matching-tuples" && options.dimensions == 1) {
+        std::cerr << "matching-tuples mode needs at least 2 dimensions\n";
+        return false;
+    }
+    if (options.mode != "matching-tuples"
+            && (options.stat_mode != StatMode::MutualInformation || options.ig_thr != 0.0f
+                || options.average || !options.i_lower.empty())) {
+        std::cerr << "--stat, --ig-thr, --average and --i-lower apply to matching-tuples only\n";
+        return false;
+    }
+    if (!options.contrast.empty() && !options.contrast_vars.empty()) {
+        std::cerr << "--contrast and --contrast-vars are mutually exclusive\n";
+        return false;
+    }
+    const bool has_contrast = !options.contrast.empty() || !options.contrast_vars.empty();
+    if (has_contrast && options.mode == "matching-tuples") {
+        std::cerr << "contrast variables apply to max-igs and tuples only\n";
+        return false;
+    }
+    if (has_contrast && options.tile_size > 0) {
+        std::cerr << "contrast variables cannot be used with --tile-size\n";
+        return false;
+    }
+    if (has_contrast && options.contrast_output.empty()) {
+        std::cerr << "--contrast-output is required with contrast variables\n";
+        return false;
+    }
+    if (!options.discretization_output.empty() && (options.mode == "matching-tuples" || many_decisions > 0)) {
+        std::cerr << "--discretization-output applies to max-igs and tuples without many decisions\n";
+        return false;
+    }
+    if (options.screen_top > 0) {
+        if (options.mode == "matching-tuples" || !options.contrast.empty() || !options.interesting_vars.empty()) {
+            std::cerr << "screening applies to max-igs and tuples without --contrast and --interesting-vars\n";
+            return false;
+        }
+        if (options.screen_dimensions < 1 || options.screen_dimensions > 2) {
+            std::cerr << "screen-dimensions must be 1 or 2\n";
+            return false;
+        }
+    }
+    if (options.dimensions < 1 || options.dimensions > 5) {
+        std::cerr << "dimensions must be between 1 and 5\n";
+        return false;
+    }
+    if (options.discretizations < 1) {
+        std::cerr << "discretizations must be positive\n";
+        return false;
+    }
+    if (options.pseudo <= 0.0f) {
+        std::cerr << "pc-xi must be positive\n";
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+static std::vector<T> read_binary(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("cannot read " + path);
+    }
+    const std::streamsize size = in.tellg();
+    if (size % sizeof(T) != 0) {
+        throw std::runtime_error(path + " is not a whole number of " + std::to_string(sizeof(T)) + "-byte values");
+    }
+    std::vector<T> values(size / sizeof(T));
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(values.data()), size)) {
+        throw std::runtime_error("cannot read " + path);
+    }
+    return values;
+}
+
+template <typename T>
+static size_t matrix_variables(const std::vector<T>& values, size_t objects, const std::string& path) {
+    if (values.size() % objects != 0) {
+        throw std::runtime_error(path + " does not hold whole columns of " + std::to_string(objects) + " objects");
+    }
+    return values.size() / objects;
+}
+
+// highest value in discrete data, which is the number of divisions
+template <typename T>
+static size_t discrete_divisions(const std::vector<T>& values, const std::string& path) {
+    int highest = 0;
+    for (int value : values) {
+        if (value < 0 || value > 15) {
+            throw std::runtime_error(path + " has values outside of 0..15");
+        }
+        highest = std::max(highest, value);
+    }
+    return highest;
+}
+
+static std::atomic<bool> sigint_received(false);
+
+static void on_sigint(int) {
+    sigint_received.store(true);
+}
+
+static bool cli_interrupted(void* context) {
+    return sigint_received.load();
+}
+
+static void cli_report_progress(void* context, uint64_t done, uint64_t total, double tuples_per_second, bool finished) {
+    const double percent = total > 0 ? 100.0 * done / total : 100.0;
+    const double eta = tuples_per_second > 0.0 && total > done ? (total - done) / tuples_per_second : 0.0;
+
+    std::fprintf(stderr, "\rmdfs: %5.1f%% (%.0f/%.0f tuples, %.0f tuples/s, ETA %.0fs)  ",
+                 percent, (double) done, (double) total, tuples_per_second, eta);
+    if (finished) {
+        std::fprintf(stderr, "\n");
+    }
+}
+
+// streams a raw float64 matrix into a column file, so it does not have to fit in memory
+static int convert(const CliOptions& options) {
+    std::ifstream in(options.data, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("cannot read " + options.data);
+    }
+    const uint64_t column_bytes = options.objects * sizeof(double);
+    const uint64_t size = in.tellg();
+    if (size % column_bytes != 0) {
+        throw std::runtime_error(options.data + " does not hold whole columns of " + std::to_string(options.objects) + " objects");
+    }
+    in.seekg(0);
+
+    const ColumnType type = options.float32 ? ColumnType::Float32 : ColumnType::Float64;
+    const size_t variable_count = size / column_bytes;
+    const size_t chunk_variables = std::max<size_t>(1, (64 << 20) / column_bytes);
+    std::vector<double> chunk(chunk_variables * options.objects);
+
+    write_column_file(options.convert, nullptr, options.objects, 0, type, false);
+    for (size_t v = 0; v < variable_count; v += chunk_variables) {
+        const size_t n = std::min(chunk_variables, variable_count - v);
+        if (!in.read(reinterpret_cast<char*>(chunk.data()), n * column_bytes)) {
+            throw std::runtime_error("cannot read " + options.data);
+        }
+        write_column_file(options.convert, chunk.data(), options.objects, n, type, true);
+    }
+    return 0;
+}
+
+// discrete data as the variables of the values other than 0, then their objects and values
+static int convert_sparse(const CliOptions& options) {
+    const std::vector<int> values = read_binary<int>(options.data);
+    const size_t variable_count = matrix_variables(values, options.objects, options.data);
+
+    std::vector<int> columns(1, 0);
+    std::vector<int> objects;
+    std::vector<int> nonzero_values;
+    for (size_t v = 0; v < variable_count; v++) {
+        for (size_t o = 0; o < options.objects; o++) {
+            if (values[v * options.objects + o] != 0) {
+                objects.push_back(o);
+                nonzero_values.push_back(values[v * options.objects + o]);
+            }
+        }
+        columns.push_back(objects.size());
+    }
+
+    auto write = [](const std::string& path, const std::vector<int>& vector) {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(vector.data()), vector.size() * sizeof(int));
+        if (!out) {
+            throw std::runtime_error("cannot write " + path);
+        }
+    };
+    write(options.convert_sparse + ".columns.bin", columns);
+    write(options.convert_sparse + ".objects.bin", objects);
+    write(options.convert_sparse + ".values.bin", nonzero_values);
+    return 0;
+}
+
+// discrete data of values 0..2 as the genotypes of a .bed file
+static int convert_bed(const CliOptions& options) {
+    const std::vector<int> values = read_binary<int>(options.data);
+    const size_t variable_count = matrix_variables(values, options.objects, options.data);
+    static const uint8_t code_of_genotype[3] = {0, 2, 3};
+
+    std::vector<uint8_t> bed = {0x6c, 0x1b, 0x01};
+    const size_t column_bytes = packed_genotype_bytes(options.objects);
+    for (size_t v = 0; v < variable_count; v++) {
+        const size_t first = bed.size();
+        bed.resize(first + column_bytes, 0);
+        for (size_t o = 0; o < options.objects; o++) {
+            const int value = values[v * options.objects + o];
+            if (value < 0 || value > 2) {
+                throw std::runtime_error(options.data + " has values outside of 0..2");
+            }
+            bed[first + o / 4] |= code_of_genotype[value] << (2 * (o % 4));
+        }
+    }
+
+    std::ofstream out(options.convert_bed, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bed.data()), bed.size());
+    if (!out) {
+        throw std::runtime_error("cannot write " + options.convert_bed);
+    }
+    return 0;
+}
+
+// discrete data as uint8 values, one byte each
+static int convert_uint8(const CliOptions& options) {
+    const std::vector<int> values = read_binary<int>(options.data);
+    matrix_variables(values, options.objects, options.data);
+    discrete_divisions(values, options.data);
+
+    const std::vector<uint8_t> bytes(values.begin(), values.end());
+    std::ofstream out(options.convert_uint8, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!out) {
+        throw std::runtime_error("cannot write " + options.convert_uint8);
+    }
+    return 0;
+}
+
+// continuous data, mapped if it is a column file, otherwise read whole;
+// objects is taken from the column file header if not given
+static std::unique_ptr<RawData> load_continuous(
+    const std::string& path,
+    size_t& objects,
+    std::vector<double>& values,
+    std::unique_ptr<MappedColumnFile>& mapped,
+    const int* decision
+) {
+    if (is_column_file(path)) {
+        mapped.reset(new MappedColumnFile(path));
+        if (objects != 0 && objects != mapped->header().object_count) {
+            throw std::runtime_error(path + " has a different number of objects");
+        }
+        objects = mapped->header().object_count;
+        return std::unique_ptr<RawData>(new RawData(*mapped, decision));
+    }
+
+    if (objects == 0) {
+        throw std::runtime_error("--objects is required for raw data files");
+    }
+    values = read_binary<double>(path);
+    return std::unique_ptr<RawData>(new RawData(
+        RawDataInfo(objects, matrix_variables(values, objects, path)), values.data(), decision));
+}
+
+static int run(const CliOptions& options, std::ostream& out) {
+    std::vector<double> data;
+    std::vector<int> data_discrete;
+    std::vector<uint8_t> data_uint8;
+    std::vector<int> sparse_columns;
+    std::vector<int> sparse_objects;
+    std::vector<double> contrast;
+    std::vector<int> contrast_discrete;
+    std::vector<uint8_t> contrast_uint8;
+    std::unique_ptr<MappedColumnFile> mapped_data;
+    std::unique_ptr<MappedColumnFile> mapped_contrast;
+    std::unique_ptr<MappedBedFile> mapped_bed;
+    std::unique_ptr<RawData> raw_data;
+    std::unique_ptr<RawData> contrast_raw_data;
+    size_t objects = options.objects;
+    size_t divisions = options.divisions;
+
+    // the decision is read first and attached to the data later
+    std::vector<int> decision;
+    if (!options.decision.empty()) {
+        decision = read_binary<int>(options.decision);
+        for (int value : decision) {
+            if (value < 0 || size_t(value) >= max_decision_classes) {
+                throw std::runtime_error("decision classes must be between 0 and 7");
+            }
+        }
+    }
+
+    if (!options.bed.empty()) {
+        mapped_bed.reset(new MappedBedFile(options.bed, objects));
+        raw_data.reset(new RawData(*mapped_bed, nullptr));
+        divisions = 2;
+    } else if (options.discrete && options.uint8) {
+        if (objects == 0) {
+            throw std::runtime_error("--objects is required for discrete data");
+        }
+        data_uint8 = read_binary<uint8_t>(options.data);
+        divisions = std::max<size_t>(1, discrete_divisions(data_uint8, options.data));
+        raw_data.reset(new RawData(
+            RawDataInfo(objects, matrix_variables(data_uint8, objects, options.data)), data_uint8.data(), nullptr));
+        if (!options.contrast.empty()) {
+            contrast_uint8 = read_binary<uint8_t>(options.contrast);
+            divisions = std::max(divisions, discrete_divisions(contrast_uint8, options.contrast));
+            contrast_raw_data.reset(new RawData(
+                RawDataInfo(objects, matrix_variables(contrast_uint8, objects, options.contrast)), contrast_uint8.data(), nullptr));
+        }
+    } else if (options.discrete) {
+        if (objects == 0) {
+            throw std::runtime_error("--objects is required for discrete data");
+        }
+        data_discrete = read_binary<int>(options.data);
+        divisions = std::max<size_t>(1, discrete_divisions(data_discrete, options.data));
+        if (!options.sparse_columns.empty()) {
+            sparse_columns = read_binary<int>(options.sparse_columns);
+            sparse_objects = read_binary<int>(options.sparse_objects);
+            if (sparse_columns.size() < 2 || size_t(sparse_columns.back()) != data_discrete.size()
+                    || sparse_objects.size() != data_discrete.size()) {
+                throw std::runtime_error("sparse columns, objects and values do not match");
+            }
+            raw_data.reset(new RawData(
+                RawDataInfo(objects, sparse_columns.size() - 1),
+                sparse_columns.data(), sparse_objects.data(), data_discrete.data(), nullptr));
+        } else {
+            raw_data.reset(new RawData(
+                RawDataInfo(objects, matrix_variables(data_discrete, objects, options.data)), data_discrete.data(), nullptr));
+        }
+        if (!options.contrast.empty()) {
+            contrast_discrete = read_binary<int>(options.contrast);
+            divisions = std::max(divisions, discrete_divisions(contrast_discrete, options.contrast));
+            contrast_raw_data.reset(new RawData(
+                RawDataInfo(objects, matrix_variables(contrast_discrete, objects, options.contrast)), contrast_discrete.data(), nullptr));
+        }
+    } else {
+        raw_data = load_continuous(options.data, objects, data, mapped_data, nullptr);
+        if (!options.contrast.empty()) {
+            contrast_raw_data = load_continuous(options.contrast, objects, contrast, mapped_contrast, nullptr);
+        }
+    }
+
+    const size_t variable_count = raw_data->info.variable_count;
+    const size_t contrast_variable_count = contrast_raw_data
+        ? contrast_raw_data->info.variable_count
+        : options.contrast_vars.size();
+
+    if (!decision.empty()) {
+        if (decision.size() != objects) {
+            throw std::runtime_error("decision length differs from the number of objects");
+        }
+        raw_data->decision = decision.data();
+    }
+
+    // many decisions, weightings or folds, evaluated in one pass
+    std::vector<int> decisions;
+    size_t n_decisions = 0;
+    if (!options.decisions.empty()) {
+        decisions = read_binary<int>(options.decisions);
+        n_decisions = matrix_variables(decisions, objects, options.decisions);
+    } else if (!options.replicate_weights.empty()) {
+        decisions = read_binary<int>(options.replicate_weights);
+        n_decisions = matrix_variables(decisions, objects, options.replicate_weights);
+    } else if (!options.folds.empty()) {
+        decisions = read_binary<int>(options.folds);
+        if (decisions.size() != objects) {
+            throw std::runtime_error("folds length differs from the number of objects");
+        }
+        // the folds themselves are validated by run_mdfs_folds
+        n_decisions = std::max(*std::max_element(decisions.begin(), decisions.end()) + 1, 1);
+    }
+
+    std::vector<int> weights;
+    if (!options.weights.empty()) {
+        weights = read_binary<int>(options.weights);
+        if (weights.size() != objects) {
+            throw std::runtime_error("weights length differs from the number of objects");
+        }
+        raw_data->weights = weights.data();
+    }
+
+    std::vector<double> i_lower;
+    if (!options.i_lower.empty()) {
+        i_lower = read_binary<double>(options.i_lower);
+        if (i_lower.size() != variable_count) {
+            throw std::runtime_error("i-lower length differs from the number of variables");
+        }
+    }
+
+    for (int v : options.interesting_vars) {
+        if (v < 0 || static_cast<size_t>(v) >= variable_count) {
+            throw std::runtime_error("interesting variable out of range");
+        }
+    }
+    for (int v : options.contrast_vars) {
+        if (v < 0 || static_cast<size_t>(v) >= variable_count) {
+            throw std::runtime_error("contrast variable out of range");
+        }
+    }
+
+    std::vector<int> interesting_vars(options.interesting_vars);
+    MDFSInfo mdfs_info(
+        options.dimensions,
+        divisions,
+        options.discrete ? 1 : options.discretizations,
+        options.pseudo,
+        options.ig_thr,
+        interesting_vars.data(),
+        interesting_vars.size(),
+        options.require_all_vars,
+        i_lower.empty() ? nullptr : i_lower.data(),
+        options.average
+    );
+
+    std::unique_ptr<const DiscretizationInfo> dfi;
+    if (!options.discrete) {
+        const double range = options.range >= 0.0
+            ? options.range
+            : recommended_range(objects, options.dimensions, divisions);
+        if (range > 1.0) {
+            throw std::runtime_error("range must be between 0 and 1");
+        }
+        if (range == 0.0 && options.discretizations > 1) {
+            throw std::runtime_error("zero range does not make sense with more than one discretization");
+        }
+        dfi.reset(new DiscretizationInfo(options.seed, options.discretizations, divisions, range));
+    }
+
+    const bool matching_tuples = options.mode == "matching-tuples";
+    const MDFSOutputType out_type = matching_tuples ? tuples_output_type(mdfs_info) : MDFSOutputType::MaxIGs;
+    MDFSOutput mdfs_output(out_type, options.dimensions, variable_count, contrast_variable_count);
+
+    std::vector<int> max_igs_tuples;
+    std::vector<int> dids;
+    if (options.mode == "tuples") {
+        max_igs_tuples.resize(options.dimensions * variable_count);
+        dids.resize(variable_count);
+        mdfs_output.setMaxIGsTuples(max_igs_tuples.data(), dids.data());  // row-first
+    }
+
+    std::vector<float> discretization_igs;  // by discretization, then variable
+    if (!options.discretization_output.empty()) {
+        discretization_igs.resize(mdfs_info.discretizations * variable_count);
+        mdfs_output.setDiscretizationMaxIGs(discretization_igs.data(), mdfs_info.discretizations);
+    }
+
+    MDFSRunStats run_stats;
+    if (options.prune) {
+        mdfs_output.setRunStats(&run_stats);
+    }
+
+    ProgressMonitor progress(options.progress ? cli_report_progress : nullptr, cli_interrupted, nullptr);
+    mdfs_info.progress = &progress;
+    mdfs_info.tile_size = options.tile_size;
+    mdfs_info.tile_dir = options.tile_dir;
+    mdfs_info.parallel_mode = options.parallel_mode;
+    mdfs_info.lower_entropies_max_bytes = options.lower_entropies_bytes;
+    mdfs_info.prune = options.prune;
+    mdfs_info.deduplicate = options.deduplicate;
+    mdfs_info.contrast_sources = options.contrast_vars.data();
+    mdfs_info.contrast_sources_count = options.contrast_vars.size();
+    mdfs_info.contrast_seed = options.seed;
+
+    out.precision(std::numeric_limits<float>::max_digits10);
+
+    if (n_decisions > 0) {
+        std::vector<float> decisions_max_igs;  // by decision, then variable
+        std::signal(SIGINT, on_sigint);
+        if (!options.decisions.empty()) {
+            run_mdfs_decisions(mdfs_info, raw_data.get(), decisions.data(), n_decisions, std::move(dfi), decisions_max_igs);
+        } else if (!options.replicate_weights.empty()) {
+            run_mdfs_replicates(mdfs_info, raw_data.get(), decisions.data(), n_decisions, std::move(dfi), decisions_max_igs);
+        } else {
+            run_mdfs_folds(mdfs_info, raw_data.get(), decisions.data(), n_decisions, std::move(dfi), decisions_max_igs);
+        }
+        std::signal(SIGINT, SIG_DFL);
+
+        if (progress.cancelled()) {
+            std::cerr << "mdfs: interrupted\n";
+            return 130;
+        }
+
+        out << "variable";
+        for (size_t t = 1; t <= n_decisions; t++) {
+            out << "\tig." << t;
+        }
+        out << "\n";
+        for (size_t v = 0; v < variable_count; v++) {
+            out << v + 1;
+            for (size_t t = 0; t < n_decisions; t++) {
+                out << "\t" << decisions_max_igs[t * variable_count + v];
+            }
+            out << "\n";
+        }
+        return 0;
+    }
+
+    ScreeningResult screening;
+    std::signal(SIGINT, on_sigint);
+    if (options.screen_top > 0) {
+        ScreeningInfo screening_info;
+        screening_info.dimensions = options.screen_dimensions;
+        screening_info.top = options.screen_top;
+        screening_info.partners = options.screen_partners;
+        run_screened_mdfs(mdfs_info, screening_info, raw_data.get(), std::move(dfi), screening, mdfs_output);
+    } else {
+        run_mdfs(mdfs_info, raw_data.get(), contrast_raw_data.get(), std::move(dfi), options.stat_mode, mdfs_output);
+    }
+    std::signal(SIGINT, SIG_DFL);
+
+    if (progress.cancelled()) {
+        std::cerr << "mdfs: interrupted\n";
+        return 130;
+    }
+
+    if (options.screen_top > 0) {
+        std::cerr << "mdfs: screening selected " << screening.selected.size() << " variables, "
+                  << screening.tuples << " tuples of " << (options.require_all_vars ? "only" : "at least one of")
+                  << " them evaluated in each discretization\n";
+
+        if (!options.screen_output.empty()) {
+            std::ofstream screen_out(options.screen_output);
+            if (!screen_out) {
+                throw std::runtime_error("cannot write " + options.screen_output);
+            }
+            screen_out.precision(std::numeric_limits<float>::max_digits10);
+
+            screen_out << "variable\tig\tselected\n";
+            for (size_t v = 0; v < variable_count; v++) {
+                const bool selected = std::binary_search(screening.selected.begin(), screening.selected.end(), int(v));
+                screen_out << v + 1 << "\t" << screening.max_igs[v] << "\t" << selected << "\n";
+            }
+        }
+    }
+
+    if (options.prune) {
+        uint64_t evaluated = 0;
+        uint64_t pruned = 0;
+        for (const ThreadRunStats& thread_stats : run_stats.threads) {
+            evaluated += thread_stats.tuples_evaluated;
+            pruned += thread_stats.tuples_pruned;
+        }
+        std::cerr << "mdfs: " << pruned << " of " << evaluated + pruned << " tuples pruned\n";
+    }
+
+    if (!matching_tuples) {
+        std::vector<double> igs(variable_count);
+        mdfs_output.copyMaxIGsAsDouble(igs.data());
+
+        out << "variable\tig";
+        if (options.mode == "tuples") {
+            for (size_t d = 1; d <= options.dimensions; d++) {
+                out << "\ttuple." << d;
+            }
+            out << "\tdiscretization";
+        }
+        out << "\n";
+
+        for (size_t v = 0; v < variable_count; v++) {
+            out << v + 1 << "\t" << igs[v];
+            if (options.mode == "tuples") {
+                for (size_t d = 0; d < options.dimensions; d++) {
+                    out << "\t" << max_igs_tuples[v * options.dimensions + d] + 1;
+                }
+                out << "\t" << dids[v] + 1;
+            }
+            out << "\n";
+        }
+
+        if (contrast_variable_count > 0) {
+            std::ofstream contrast_out(options.contrast_output);
+            if (!contrast_out) {
+                throw std::runtime_error("cannot write " + options.contrast_output);
+            }
+            contrast_out.precision(std::numeric_limits<float>::max_digits10);
+
+            std::vector<double> contrast_igs(contrast_variable_count);
+            mdfs_output.copyContrastMaxIGsAsDouble(contrast_igs.data());
+
+            contrast_out << "variable\tig\n";
+            for (size_t v = 0; v < contrast_variable_count; v++) {
+                contrast_out << v + 1 << "\t" << contrast_igs[v] << "\n";
+            }
+        }
+
+        if (!options.discretization_output.empty()) {
+            std::ofstream discretization_out(options.discretization_output);
+            if (!discretization_out) {
+                throw std::runtime_error("cannot write " + options.discretization_output);
+            }
+            discretization_out.precision(std::numeric_limits<float>::max_digits10);
+
+            const size_t n_discretizations = mdfs_info.discretizations;
+            discretization_out << "variable";
+            for (size_t d = 1; d <= n_discretizations; d++) {
+                discretization_out << "\tig." << d;
+            }
+            discretization_out << "\tmean\tvariance\n";
+            for (size_t v = 0; v < variable_count; v++) {
+                discretization_out << v + 1;
+                double sum = 0.0;
+                for (size_t d = 0; d < n_discretizations; d++) {
+                    const float ig = discretization_igs[d * variable_count + v];
+                    discretization_out << "\t" << ig;
+                    sum += ig;
+                }
+                const double mean = sum / n_discretizations;
+                // sample variance, as var in R
+                double squares = 0.0;
+                for (size_t d = 0; d < n_discretizations; d++) {
+                    const double deviation = discretization_igs[d * variable_count + v] - mean;
+                    squares += deviation * deviation;
+                }
+                const double variance = n_discretizations > 1 ?
+                    squares / (n_discretizations - 1) :
+                    std::numeric_limits<double>::quiet_NaN();
+                discretization_out << "\t" << mean << "\t" << variance << "\n";
+            }
+        }
+    } else {
+        const size_t tuples_count = out_type == MDFSOutputType::AllTuples
+            ? variable_count * (variable_count - 1)
+            : mdfs_output.getMatchingTuplesCount();
+
+        std::vector<int> vars(tuples_count);
+        std::vector<double> igs(tuples_count);
+        std::vector<int> tuples(tuples_count * options.dimensions);  // column-first
+        if (out_type == MDFSOutputType::AllTuples) {
+            mdfs_output.copyAllTuples(vars.data(), igs.data(), tuples.data());
+        } else {
+            mdfs_output.copyMatchingTuples(vars.data(), igs.data(), tuples.data());
+        }
+
+        out << "variable";
+        for (size_t d = 1; d <= options.dimensions; d++) {
+            out << "\ttuple." << d;
+        }
+        out << "\tig\n";
+
+        for (size_t i = 0; i < tuples_count; i++) {
+            out << vars[i] + 1;
+            for (size_t d = 0; d < options.dimensions; d++) {
+                out << "\t" << tuples[d * tuples_count + i] + 1;
+            }
+            out << "\t" << igs[i] << "\n";
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    CliOptions options;
+    try {
+        if (!parse_options(argc, argv, options)) {
+            usage();
+            return 1;
+        }
+    } catch (const std::logic_error& e) {  // from std::sto*
+        std::cerr << "invalid number: " << e.what() << "\n";
+        return 1;
+    }
+
+    #ifdef _OPENMP
+    if (options.threads > 0) {
+        omp_set_num_threads(options.threads);
+    }
+    #endif
+
+    try {
+        if (!options.convert.empty()) {
+            return convert(options);
+        }
+        if (!options.convert_sparse.empty()) {
+            return convert_sparse(options);
+        }
+        if (!options.convert_bed.empty()) {
+            return convert_bed(options);
+        }
+        if (!options.convert_uint8.empty()) {
+            return convert_uint8(options);
+        }
+        if (options.output.empty()) {
+            return run(options, std::cout);
+        }
+
+        std::ofstream out(options.output);
+        if (!out) {
+            std::cerr << "mdfs: cannot write " << options.output << "\n";
+            return 1;
+        }
+        return run(options, out);
+    } catch (const std::exception& e) {
+        std::cerr << "mdfs: " << e.what() << "\n";
+        return 1;
+    }
+}
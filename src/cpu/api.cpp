@@ -0,0 +1,583 @@
+#include "api.h"
+#include "discretization_cache.h"
+#include "mdfs.h"
+#include "mdfs_decisions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+// 1 decision class means no decision
+static MdfsImpl select_mdfs(size_t dimensions, StatMode stat_mode, size_t n_decision_classes) {
+    if (dimensions < 1 || dimensions > 5) {
+        return nullptr;
+    }
+
+    if (n_decision_classes > 2) {
+        if (n_decision_classes > max_decision_classes || stat_mode != StatMode::MutualInformation) {
+            return nullptr;
+        }
+        return mdfsMultiClass[n_decision_classes-3][dimensions-1];
+    }
+
+    if (n_decision_classes == 2) {
+        switch (stat_mode) {
+            case StatMode::Entropy: return mdfsDecisionConditionalEntropy[dimensions-1];
+            case StatMode::MutualInformation: return mdfs[dimensions-1];
+            case StatMode::VariationOfInformation: return mdfsDecisionConditionalVariationOfInformation[dimensions-1];
+        }
+    } else {
+        switch (stat_mode) {
+            case StatMode::Entropy: return mdfsEntropy[dimensions-1];
+            case StatMode::MutualInformation: return mdfsMutualInformation[dimensions-1];
+            case StatMode::VariationOfInformation: return mdfsVariationOfInformation[dimensions-1];
+        }
+    }
+
+    return nullptr;
+}
+
+bool mdfs_supported(size_t dimensions, StatMode stat_mode, bool with_decision) {
+    return select_mdfs(dimensions, stat_mode, with_decision ? 2 : 1) != nullptr;
+}
+
+// throws std::invalid_argument for classes out of range or missing
+static size_t count_decision_classes(const RawData* raw_data) {
+    if (raw_data->decision == nullptr) {
+        return 1;
+    }
+
+    size_t objects[max_decision_classes] = {};
+    size_t n_decision_classes = 2;  // as before, even if only one occurs
+    for (size_t i = 0; i < raw_data->info.object_count; i++) {
+        const int decision = raw_data->decision[i];
+        if (decision < 0 || size_t(decision) >= max_decision_classes) {
+            throw std::invalid_argument("decision classes must be between 0 and 7");
+        }
+        objects[decision]++;
+        n_decision_classes = std::max(n_decision_classes, size_t(decision) + 1);
+    }
+    if (n_decision_classes > 2 && std::find(objects, objects + n_decision_classes, size_t(0)) != objects + n_decision_classes) {
+        throw std::invalid_argument("all decision classes up to the highest must occur");
+    }
+    return n_decision_classes;
+}
+
+// throws std::invalid_argument unless the columns are consecutive and the
+// objects of each ascending and in range
+static void validate_sparse_columns(const RawData* raw_data) {
+    const int* columns = raw_data->sparse_columns;
+    if (columns[0] != 0) {
+        throw std::invalid_argument("sparse columns must start at 0");
+    }
+    for (size_t v = 0; v < raw_data->info.variable_count; v++) {
+        if (columns[v + 1] < columns[v]) {
+            throw std::invalid_argument("sparse columns must not decrease");
+        }
+        for (int cell = columns[v]; cell < columns[v + 1]; cell++) {
+            const int object = raw_data->sparse_objects[cell];
+            if (object < 0 || size_t(object) >= raw_data->info.object_count
+                    || (cell > columns[v] && object <= raw_data->sparse_objects[cell - 1])) {
+                throw std::invalid_argument("objects of a sparse column must be ascending and in range");
+            }
+        }
+    }
+}
+
+// discrete data with the objects equal in the variables in use (the other
+// ones are left zero), decision and contrast variables collapsed into one
+// object of their summed weight, in the order of first occurrence
+class DeduplicatedData {
+public:
+    std::vector<int> data;
+    std::vector<int> contrast_data;
+    std::vector<int> decision;
+    std::vector<int> weights;
+    size_t object_count = 0;
+};
+
+// the engines look them up by binary search and count tuples of them
+static void check_interesting_vars(const MDFSInfo& mdfs_info, size_t variable_count) {
+    for (size_t i = 0; i < mdfs_info.interesting_vars_count; i++) {
+        if (mdfs_info.interesting_vars[i] < 0 || size_t(mdfs_info.interesting_vars[i]) >= variable_count) {
+            throw std::invalid_argument("interesting variable out of range");
+        }
+        if (i > 0 && mdfs_info.interesting_vars[i] <= mdfs_info.interesting_vars[i-1]) {
+            throw std::invalid_argument("interesting variables must be sorted and distinct");
+        }
+    }
+}
+
+static void deduplicate_objects(
+    const MDFSInfo& mdfs_info,
+    const RawData* raw_data,
+    const RawData* contrast_raw_data,
+    DeduplicatedData& result
+) {
+    const size_t n_objects = raw_data->info.object_count;
+    const size_t n_variables = raw_data->info.variable_count;
+    const size_t n_contrast_variables = contrast_raw_data != nullptr ? contrast_raw_data->info.variable_count : 0;
+
+    std::vector<size_t> variables;
+    if (mdfs_info.interesting_vars_count > 0 && mdfs_info.require_all_vars) {
+        variables.assign(mdfs_info.interesting_vars, mdfs_info.interesting_vars + mdfs_info.interesting_vars_count);
+    } else {
+        variables.resize(n_variables);
+        std::iota(variables.begin(), variables.end(), size_t(0));
+    }
+
+    // rows of the values compared, stored as uint8_t in the engine anyway
+    const size_t width = variables.size() + n_contrast_variables + 1;
+    std::vector<char> rows(n_objects * width, '\0');
+    for (size_t i = 0; i < variables.size(); i++) {
+        for (size_t o = 0; o < n_objects; o++) {
+            rows[o * width + i] = char(raw_data->getValueI(variables[i], o));
+        }
+    }
+    for (size_t i = 0; i < n_contrast_variables; i++) {
+        for (size_t o = 0; o < n_objects; o++) {
+            rows[o * width + variables.size() + i] = char(contrast_raw_data->getValueI(i, o));
+        }
+    }
+    if (raw_data->decision != nullptr) {
+        for (size_t o = 0; o < n_objects; o++) {
+            rows[o * width + width - 1] = char(raw_data->decision[o]);
+        }
+    }
+
+    std::vector<size_t> representatives;  // the first object of each distinct one
+    std::vector<size_t> distinct_of(n_objects);
+    std::unordered_map<std::string, size_t> distinct;
+    for (size_t o = 0; o < n_objects; o++) {
+        auto inserted = distinct.emplace(std::string(rows.data() + o * width, width), representatives.size());
+        if (inserted.second) {
+            representatives.push_back(o);
+        }
+        distinct_of[o] = inserted.first->second;
+    }
+
+    const size_t n_distinct = representatives.size();
+    result.object_count = n_distinct;
+    std::vector<uint64_t> weights(n_distinct, 0);
+    for (size_t o = 0; o < n_objects; o++) {
+        weights[distinct_of[o]] += raw_data->weights != nullptr ? raw_data->weights[o] : 1;
+    }
+    if (std::any_of(weights.begin(), weights.end(), [](uint64_t w) { return w > uint64_t(std::numeric_limits<int>::max()); })) {
+        throw std::invalid_argument("deduplicated objects must weigh less than 2^31");
+    }
+    result.weights.assign(weights.begin(), weights.end());
+    result.data.assign(n_distinct * n_variables, 0);
+    for (size_t v : variables) {
+        for (size_t i = 0; i < n_distinct; i++) {
+            result.data[v * n_distinct + i] = raw_data->getValueI(v, representatives[i]);
+        }
+    }
+    result.contrast_data.resize(n_distinct * n_contrast_variables);
+    for (size_t v = 0; v < n_contrast_variables; v++) {
+        for (size_t i = 0; i < n_distinct; i++) {
+            result.contrast_data[v * n_distinct + i] = contrast_raw_data->getValueI(v, representatives[i]);
+        }
+    }
+    if (raw_data->decision != nullptr) {
+        result.decision.resize(n_distinct);
+        for (size_t i = 0; i < n_distinct; i++) {
+            result.decision[i] = raw_data->decision[representatives[i]];
+        }
+    }
+}
+
+void run_mdfs(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    RawData* contrast_raw_data,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    StatMode stat_mode,
+    MDFSOutput& out
+) {
+    const size_t n_decision_classes = count_decision_classes(raw_data);
+    const MdfsImpl impl = select_mdfs(mdfs_info.dimensions, stat_mode, n_decision_classes);
+    if (impl == nullptr) {
+        throw std::invalid_argument(n_decision_classes > 2 ?
+            "statistic not supported with more than 2 decision classes" :
+            "statistic not supported in the given dimensions");
+    }
+    if (mdfs_info.divisions < 1 || mdfs_info.divisions > 15) {
+        throw std::invalid_argument("divisions must be between 1 and 15");
+    }
+    if (mdfs_info.discretizations < 1) {
+        throw std::invalid_argument("at least one discretization is required");
+    }
+    if (raw_data->info.variable_count < mdfs_info.dimensions) {
+        throw std::invalid_argument("fewer variables than dimensions");
+    }
+    check_interesting_vars(mdfs_info, raw_data->info.variable_count);
+    if (contrast_raw_data != nullptr && contrast_raw_data->info.object_count != raw_data->info.object_count) {
+        throw std::invalid_argument("contrast data has a different number of objects");
+    }
+    if (contrast_raw_data != nullptr && out.type != MDFSOutputType::MaxIGs) {
+        throw std::invalid_argument("contrast variables are supported only for max IGs");
+    }
+    if (contrast_raw_data != nullptr && mdfs_info.contrast_sources_count > 0) {
+        throw std::invalid_argument("contrast data and contrast sources are mutually exclusive");
+    }
+    if (mdfs_info.contrast_sources_count > 0 && out.type != MDFSOutputType::MaxIGs) {
+        throw std::invalid_argument("contrast variables are supported only for max IGs");
+    }
+    for (size_t i = 0; i < mdfs_info.contrast_sources_count; i++) {
+        if (mdfs_info.contrast_sources[i] < 0 || size_t(mdfs_info.contrast_sources[i]) >= raw_data->info.variable_count) {
+            throw std::invalid_argument("contrast source out of range");
+        }
+    }
+    if ((contrast_raw_data != nullptr || mdfs_info.contrast_sources_count > 0) && mdfs_info.tile_size > 0) {
+        throw std::invalid_argument("contrast variables are not supported in the out-of-core mode");
+    }
+    if (mdfs_info.parallel_mode == ParallelMode::Objects
+            && (contrast_raw_data != nullptr || mdfs_info.contrast_sources_count > 0 || mdfs_info.tile_size > 0
+                || raw_data->isSparse() || raw_data->packed_genotypes)) {
+        throw std::invalid_argument("objects can be split only for dense data without contrast variables, in memory");
+    }
+    if (mdfs_info.prune && (mdfs_info.parallel_mode == ParallelMode::Objects || mdfs_info.tile_size > 0)) {
+        throw std::invalid_argument("pruning is supported only with tuples split among the threads, in memory");
+    }
+    const size_t n_contrast_variables = contrast_raw_data != nullptr ?
+                                        contrast_raw_data->info.variable_count :
+                                        mdfs_info.contrast_sources_count;
+    if (out.n_dimensions != mdfs_info.dimensions || out.n_variables != raw_data->info.variable_count
+            || out.n_contrast_variables != n_contrast_variables
+            || (out.discretization_max_igs != nullptr && out.n_discretizations != mdfs_info.discretizations)) {
+        throw std::invalid_argument("output does not match the data");
+    }
+    if (raw_data->weights != nullptr) {
+        if (dfi) {
+            throw std::invalid_argument("weights are supported only for discrete data");
+        }
+        if (mdfs_info.contrast_sources_count > 0) {
+            throw std::invalid_argument("weights are not supported with contrast sources");
+        }
+        for (size_t i = 0; i < raw_data->info.object_count; i++) {
+            if (raw_data->weights[i] < 0) {
+                throw std::invalid_argument("weights must not be negative");
+            }
+        }
+    }
+
+    if (raw_data->isSparse()) {
+        if (dfi) {
+            throw std::invalid_argument("sparse data must be discrete");
+        }
+        validate_sparse_columns(raw_data);
+    }
+    if (raw_data->packed_genotypes) {
+        if (dfi) {
+            throw std::invalid_argument("genotypes must be discrete");
+        }
+        if (mdfs_info.divisions < 2) {
+            throw std::invalid_argument("genotypes need at least 2 divisions");
+        }
+        if (packed_genotypes_missing(static_cast<const uint8_t*>(raw_data->data),
+                                     raw_data->info.object_count, raw_data->info.variable_count)) {
+            throw std::invalid_argument("missing genotypes are not supported");
+        }
+    }
+    if (dfi && (raw_data->byte_values || (contrast_raw_data != nullptr && contrast_raw_data->byte_values))) {
+        throw std::invalid_argument("byte values must be discrete");
+    }
+    if (contrast_raw_data != nullptr && (contrast_raw_data->isSparse() || contrast_raw_data->packed_genotypes)) {
+        throw std::invalid_argument("contrast data must be dense");
+    }
+
+    if (mdfs_info.deduplicate && !dfi && mdfs_info.contrast_sources_count == 0
+            && !raw_data->isSparse() && !raw_data->packed_genotypes) {
+        DeduplicatedData deduplicated;
+        deduplicate_objects(mdfs_info, raw_data, contrast_raw_data, deduplicated);
+        if (deduplicated.object_count < raw_data->info.object_count) {
+            RawData deduplicated_raw_data(
+                RawDataInfo(deduplicated.object_count, raw_data->info.variable_count),
+                deduplicated.data.data(),
+                raw_data->decision != nullptr ? deduplicated.decision.data() : nullptr);
+            deduplicated_raw_data.weights = deduplicated.weights.data();
+            std::unique_ptr<RawData> deduplicated_contrast_raw_data;
+            if (contrast_raw_data != nullptr) {
+                deduplicated_contrast_raw_data.reset(new RawData(
+                    RawDataInfo(deduplicated.object_count, contrast_raw_data->info.variable_count),
+                    deduplicated.contrast_data.data(),
+                    nullptr));
+            }
+            impl(mdfs_info, &deduplicated_raw_data, deduplicated_contrast_raw_data.get(), std::move(dfi), out);
+            return;
+        }
+    }
+
+    impl(mdfs_info, raw_data, contrast_raw_data, std::move(dfi), out);
+}
+
+void run_screened_mdfs(
+    const MDFSInfo& mdfs_info,
+    const ScreeningInfo& screening_info,
+    RawData* raw_data,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    ScreeningResult& screening,
+    MDFSOutput& out
+) {
+    if (raw_data->decision == nullptr) {
+        throw std::invalid_argument("screening requires decision");
+    }
+    if (screening_info.dimensions < 1 || screening_info.dimensions > 2) {
+        throw std::invalid_argument("screening dimensions must be 1 or 2");
+    }
+    if (screening_info.top < 1) {
+        throw std::invalid_argument("at least one variable has to be selected");
+    }
+    if (mdfs_info.interesting_vars_count > 0) {
+        throw std::invalid_argument("interesting variables are selected by screening");
+    }
+    const size_t variable_count = raw_data->info.variable_count;
+
+    // stage 2 finds the discretized variables of stage 1 in the cache
+    std::unique_ptr<DiscretizationCache> local_cache;
+    DiscretizationCache* cache = mdfs_info.cache;
+    if (cache == nullptr && dfi && screening_info.cache_max_bytes > 0) {
+        local_cache.reset(new DiscretizationCache(screening_info.cache_max_bytes, ""));
+        cache = local_cache.get();
+    }
+
+    MDFSInfo screen_info(mdfs_info);
+    screen_info.dimensions = screening_info.dimensions;
+    screen_info.ig_thr = 0.0f;
+    screen_info.require_all_vars = false;
+    screen_info.contrast_sources = nullptr;
+    screen_info.contrast_sources_count = 0;
+    screen_info.cache = cache;
+
+    const bool with_partners = screening_info.partners && screening_info.dimensions == 2;
+    MDFSOutput screen_out(MDFSOutputType::MaxIGs, screen_info.dimensions, variable_count, 0);
+    std::vector<int> screen_tuples;
+    std::vector<int> screen_dids;
+    if (with_partners) {
+        screen_tuples.resize(screen_info.dimensions * variable_count);
+        screen_dids.resize(variable_count);
+        screen_out.setMaxIGsTuples(screen_tuples.data(), screen_dids.data());  // row-first
+    }
+    std::unique_ptr<const DiscretizationInfo> screen_dfi;
+    if (dfi) {
+        screen_dfi.reset(new DiscretizationInfo(*dfi));
+    }
+    run_mdfs(screen_info, raw_data, nullptr, std::move(screen_dfi), StatMode::MutualInformation, screen_out);
+
+    screening.max_igs.assign(screen_out.max_igs->begin(), screen_out.max_igs->end());
+    screening.selected.clear();
+    screening.tuples = 0;
+    if (mdfs_info.progress != nullptr && mdfs_info.progress->cancelled()) {
+        return;
+    }
+
+    // the highest max IGs first (NaN last), ties by the variable
+    auto higher = [&](int a, int b) {
+        const float ig_a = std::isnan(screening.max_igs[a]) ? -std::numeric_limits<float>::infinity() : screening.max_igs[a];
+        const float ig_b = std::isnan(screening.max_igs[b]) ? -std::numeric_limits<float>::infinity() : screening.max_igs[b];
+        return ig_a > ig_b || (ig_a == ig_b && a < b);
+    };
+    std::vector<int> order(variable_count);
+    std::iota(order.begin(), order.end(), 0);
+    const size_t top = std::min(screening_info.top, variable_count);
+    std::partial_sort(order.begin(), order.begin() + top, order.end(), higher);
+
+    for (size_t i = 0; i < top; i++) {
+        screening.selected.push_back(order[i]);
+        // the tuple is set once the max IG is
+        if (with_partners && screening.max_igs[order[i]] > -std::numeric_limits<float>::infinity()) {
+            for (size_t d = 0; d < screen_info.dimensions; d++) {
+                screening.selected.push_back(screen_tuples[order[i] * screen_info.dimensions + d]);
+            }
+        }
+    }
+    std::sort(screening.selected.begin(), screening.selected.end());
+    screening.selected.erase(std::unique(screening.selected.begin(), screening.selected.end()), screening.selected.end());
+
+    const size_t n_selected = screening.selected.size();
+    if (mdfs_info.require_all_vars && n_selected < mdfs_info.dimensions) {
+        throw std::invalid_argument("fewer selected variables than dimensions");
+    }
+    screening.tuples = mdfs_info.require_all_vars ?
+        binomial(n_selected, mdfs_info.dimensions) :
+        binomial(variable_count, mdfs_info.dimensions) - binomial(variable_count - n_selected, mdfs_info.dimensions);
+
+    MDFSInfo search_info(mdfs_info);
+    search_info.interesting_vars = screening.selected.data();
+    search_info.interesting_vars_count = n_selected;
+    search_info.cache = cache;
+    run_mdfs(search_info, raw_data, nullptr, std::move(dfi), StatMode::MutualInformation, out);
+}
+
+// throws std::invalid_argument for what run_mdfs_decisions and run_mdfs_replicates do not support
+static void check_decisions_run(const MDFSInfo& mdfs_info, const RawData* raw_data, bool discrete) {
+    if (mdfs_info.dimensions < 1 || mdfs_info.dimensions > 5) {
+        throw std::invalid_argument("statistic not supported in the given dimensions");
+    }
+    if (mdfs_info.divisions < 1 || mdfs_info.divisions > 15) {
+        throw std::invalid_argument("divisions must be between 1 and 15");
+    }
+    if (mdfs_info.discretizations < 1) {
+        throw std::invalid_argument("at least one discretization is required");
+    }
+    if (raw_data->info.variable_count < mdfs_info.dimensions) {
+        throw std::invalid_argument("fewer variables than dimensions");
+    }
+    check_interesting_vars(mdfs_info, raw_data->info.variable_count);
+    if (mdfs_info.contrast_sources_count > 0) {
+        throw std::invalid_argument("contrast variables are not supported with many decisions");
+    }
+    if (mdfs_info.tile_size > 0) {
+        throw std::invalid_argument("many decisions are evaluated in memory only");
+    }
+    if (mdfs_info.parallel_mode == ParallelMode::Objects) {
+        throw std::invalid_argument("objects are not split with many decisions");
+    }
+    if (mdfs_info.prune) {
+        throw std::invalid_argument("pruning is not supported with many decisions");
+    }
+    if (mdfs_info.I_lower != nullptr) {
+        throw std::invalid_argument("lower IGs are not supported with many decisions");
+    }
+    if (raw_data->weights != nullptr) {
+        throw std::invalid_argument("weights are not supported with many decisions");
+    }
+    if (raw_data->isSparse()) {
+        if (!discrete) {
+            throw std::invalid_argument("sparse data must be discrete");
+        }
+        validate_sparse_columns(raw_data);
+    }
+    if (raw_data->packed_genotypes) {
+        if (!discrete) {
+            throw std::invalid_argument("genotypes must be discrete");
+        }
+        if (mdfs_info.divisions < 2) {
+            throw std::invalid_argument("genotypes need at least 2 divisions");
+        }
+        if (packed_genotypes_missing(static_cast<const uint8_t*>(raw_data->data),
+                                     raw_data->info.object_count, raw_data->info.variable_count)) {
+            throw std::invalid_argument("missing genotypes are not supported");
+        }
+    }
+    if (!discrete && raw_data->byte_values) {
+        throw std::invalid_argument("byte values must be discrete");
+    }
+}
+
+// the pseudocounts are relative to the smaller class, which may not be empty
+static void check_class_totals(const DecisionPlanes& planes, const char* message) {
+    if (std::find(planes.class_totals.begin(), planes.class_totals.end(), uint64_t(0)) != planes.class_totals.end()) {
+        throw std::invalid_argument(message);
+    }
+}
+
+void run_mdfs_decisions(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    const int* decisions,
+    size_t n_decisions,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    std::vector<float>& max_igs
+) {
+    check_decisions_run(mdfs_info, raw_data, !dfi);
+    if (n_decisions < 1) {
+        throw std::invalid_argument("at least one decision is required");
+    }
+    for (size_t i = 0; i < n_decisions * raw_data->info.object_count; i++) {
+        if (decisions[i] != 0 && decisions[i] != 1) {
+            throw std::invalid_argument("decisions must be binary (0 or 1)");
+        }
+    }
+
+    DecisionPlanes planes;
+    planes.prepare(decisions, n_decisions, raw_data->info.object_count);
+    check_class_totals(planes, "each decision must have objects of both classes");
+    mdfsDecisions[mdfs_info.dimensions - 1](mdfs_info, raw_data, planes, std::move(dfi), max_igs);
+}
+
+void run_mdfs_replicates(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    const int* replicate_weights,
+    size_t n_replicates,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    std::vector<float>& max_igs
+) {
+    check_decisions_run(mdfs_info, raw_data, !dfi);
+    if (raw_data->decision == nullptr) {
+        throw std::invalid_argument("replicates require decision");
+    }
+    if (count_decision_classes(raw_data) > 2) {
+        throw std::invalid_argument("replicates support only 2 decision classes");
+    }
+    if (n_replicates < 1) {
+        throw std::invalid_argument("at least one replicate is required");
+    }
+    for (size_t i = 0; i < n_replicates * raw_data->info.object_count; i++) {
+        if (replicate_weights[i] < 0) {
+            throw std::invalid_argument("weights must not be negative");
+        }
+    }
+
+    DecisionPlanes planes;
+    planes.prepareWeighted(raw_data->decision, replicate_weights, n_replicates, raw_data->info.object_count);
+    check_class_totals(planes, "each replicate must weigh objects of both classes");
+    // the objects of a class are counted in 32 bits
+    if (*std::max_element(planes.class_totals.begin(), planes.class_totals.end())
+            > uint64_t(std::numeric_limits<uint32_t>::max())) {
+        throw std::invalid_argument("total weight of a decision class in a replicate must be less than 2^32");
+    }
+    mdfsDecisions[mdfs_info.dimensions - 1](mdfs_info, raw_data, planes, std::move(dfi), max_igs);
+}
+
+void run_mdfs_folds(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    const int* folds,
+    size_t n_folds,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    std::vector<float>& max_igs
+) {
+    check_decisions_run(mdfs_info, raw_data, !dfi);
+    if (raw_data->decision == nullptr) {
+        throw std::invalid_argument("folds require decision");
+    }
+    if (count_decision_classes(raw_data) > 2) {
+        throw std::invalid_argument("folds support only 2 decision classes");
+    }
+    if (n_folds < 2) {
+        throw std::invalid_argument("at least two folds are required");
+    }
+    // the objects are counted in 32 bits
+    if (raw_data->info.object_count > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("folds support fewer than 2^32 objects");
+    }
+    for (size_t i = 0; i < raw_data->info.object_count; i++) {
+        if (folds[i] < 0 || size_t(folds[i]) >= n_folds) {
+            throw std::invalid_argument("folds must be from 0 to the number of folds - 1");
+        }
+    }
+
+    DecisionPlanes planes;
+    planes.prepareFolds(raw_data->decision, folds, n_folds, raw_data->info.object_count);
+    check_class_totals(planes, "each training set (fold left out) must have objects of both classes");
+    mdfsDecisions[mdfs_info.dimensions - 1](mdfs_info, raw_data, planes, std::move(dfi), max_igs);
+}
+
+MDFSOutputType tuples_output_type(const MDFSInfo& mdfs_info) {
+    if (mdfs_info.dimensions == 2 && mdfs_info.ig_thr <= 0.0f && mdfs_info.interesting_vars_count == 0) {
+        return MDFSOutputType::AllTuples;
+    }
+    return MDFSOutputType::MatchingTuples;
+}
+
+double recommended_range(size_t object_count, size_t dimensions, size_t divisions, double k) {
+    const double ksi = std::pow(k / object_count, 1.0 / dimensions);
+    const double range = (1 - ksi * (1 + divisions)) / (1 - ksi * (1.0 - divisions));
+    return std::max(0.0, std::min(range, 1.0));
+}
@@ -0,0 +1,139 @@
+#ifndef API_H
+#define API_H
+
+// Entry points of the CPU engine for use outside of R (the R interface is
+// built on top of them as well). All the arrays passed in are borrowed and
+// have to outlive the call.
+
+#include "common.h"
+#include "dataset.h"
+#include "mdfs_cpu_kernel.h"
+
+#include <memory>
+#include <vector>
+
+
+// decision classes are numbered from 0, all up to the highest have to occur
+// in the decision when there are more than 2 of them (MI only)
+constexpr size_t max_decision_classes = 8;
+
+// whether the engine implements the statistic in the given dimensions,
+// with_decision selects the decision-conditional variant (of 2 classes)
+bool mdfs_supported(size_t dimensions, StatMode stat_mode, bool with_decision);
+
+// runs the engine on raw_data, decision-conditional when raw_data->decision is set;
+// dfi == nullptr means discrete data (int, values 0..divisions), only such data
+// may be uint8_t (raw_data->byte_values, counted in place unless
+// mdfs_info.require_all_vars subsets it), weighted (raw_data->weights), deduplicated (mdfs_info.deduplicate;
+// not when sparse or packed), sparse (raw_data->isSparse(), counted by nonzero
+// cells) or packed genotypes (raw_data->packed_genotypes, none missing);
+// max IGs of each discretization are kept as well when set on out
+// (setDiscretizationMaxIGs, of mdfs_info.discretizations);
+// throws std::invalid_argument when the arguments are not supported and
+// std::runtime_error when the tiles of the out-of-core mode cannot be stored
+void run_mdfs(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    RawData* contrast_raw_data,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    StatMode stat_mode,
+    MDFSOutput& out
+);
+
+// stage 1 of run_screened_mdfs
+class ScreeningInfo {
+public:
+    size_t dimensions = 2;  // 1 or 2
+    size_t top = 0;  // variables with the highest max IGs selected (at least one)
+    bool partners = false;  // in 2D, with the variables of the tuples of their max IGs
+    // memory for the discretized variables kept for stage 2 when mdfs_info.cache
+    // is not set (0 - discretized again)
+    size_t cache_max_bytes = size_t(1) << 30;
+};
+
+// what stage 1 found and which tuples stage 2 evaluated
+class ScreeningResult {
+public:
+    std::vector<float> max_igs;  // of all variables
+    std::vector<int> selected;  // sorted
+    uint64_t tuples = 0;  // in each discretization
+};
+
+// two-stage screening in one call: max IGs of all variables in screening_info.dimensions
+// select variables, then max IGs in mdfs_info.dimensions are computed exactly over
+// the tuples of the selected variables (only them with mdfs_info.require_all_vars,
+// otherwise at least one of them), out is of stage 2; both stages use the same
+// discretizations (dfi), contrast variables (mdfs_info.contrast_sources) are only
+// in stage 2; nothing is selected when the run is cancelled in stage 1;
+// throws like run_mdfs, std::invalid_argument also for interesting variables in
+// mdfs_info or fewer selected variables than dimensions with require_all_vars
+void run_screened_mdfs(
+    const MDFSInfo& mdfs_info,
+    const ScreeningInfo& screening_info,
+    RawData* raw_data,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    ScreeningResult& screening,
+    MDFSOutput& out
+);
+
+// max IGs (MI with decision) of all variables for each of n_decisions binary
+// decisions (0 or 1, n_decisions * object_count values, one decision after
+// another, each with objects of both classes; raw_data->decision is not used)
+// in a single pass over the tuples;
+// max_igs gets variable_count values of each decision, one after another;
+// the data may be as in run_mdfs but not weighted (nor deduplicated), without contrast variables
+// and in memory, 3D+ IGs are computed as with lower_entropies_max_bytes = 0;
+// throws std::invalid_argument like run_mdfs
+void run_mdfs_decisions(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    const int* decisions,
+    size_t n_decisions,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    std::vector<float>& max_igs
+);
+
+// max IGs (MI with decision) of all variables for each of n_replicates weightings
+// of the objects (e.g. bootstrap resamples: replicate_weights holds object_count
+// multiplicities, not negative, of each replicate, one after another) in a single
+// pass over the tuples, as run_mdfs_decisions; raw_data->decision (of 2 classes) is
+// that of each replicate, raw_data->weights has to be unset; continuous data is
+// discretized once, as a whole (not each resample on its own); the total weight
+// of a decision class in a replicate has to be positive and less than 2^32; max_igs gets
+// variable_count values of each replicate, one after another;
+// throws std::invalid_argument like run_mdfs_decisions
+void run_mdfs_replicates(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    const int* replicate_weights,
+    size_t n_replicates,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    std::vector<float>& max_igs
+);
+
+// max IGs (MI with decision) of all variables for the training sets of K-fold
+// cross-validation (folds holds the fold, 0 to n_folds-1, of each object) in a
+// single pass over the tuples, as run_mdfs_replicates with the objects of each
+// fold left out in turn: each object is counted once, in its fold, and each
+// training set is the total less its fold; continuous data is discretized once,
+// as a whole (the held-out objects included); at least 2 folds are required,
+// no fold may hold all the objects of a class and object_count has to be less
+// than 2^32; max_igs gets variable_count values of
+// each training set (fold left out), one after another;
+// throws std::invalid_argument like run_mdfs_decisions
+void run_mdfs_folds(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    const int* folds,
+    size_t n_folds,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    std::vector<float>& max_igs
+);
+
+// output type for a run returning tuples - all of them in 2D when nothing is filtered out
+MDFSOutputType tuples_output_type(const MDFSInfo& mdfs_info);
+
+// the same as GetRange in R
+double recommended_range(size_t object_count, size_t dimensions, size_t divisions, double k = 3.0);
+
+#endif
@@ -0,0 +1,123 @@
+#include "bed_file.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint8_t bed_magic[3] = {0x6c, 0x1b, 0x01};
+
+bool packed_genotypes_missing(const uint8_t* genotypes, size_t object_count, size_t variable_count) {
+    const size_t column_bytes = packed_genotype_bytes(object_count);
+    for (size_t v = 0; v < variable_count; v++) {
+        const uint8_t* column = genotypes + v * column_bytes;
+        for (size_t o = 0; o < object_count; o++) {
+            if (packed_genotype_code(column, o) == missing_genotype_code) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t bed_file_variables(const std::string& path, size_t object_count) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    const uint64_t size = in.tellg();
+
+    char magic[3];
+    in.seekg(0);
+    if (size < sizeof(magic) || !in.read(magic, sizeof(magic))
+            || uint8_t(magic[0]) != bed_magic[0] || uint8_t(magic[1]) != bed_magic[1]) {
+        throw std::runtime_error(path + " is not a .bed file");
+    }
+    if (uint8_t(magic[2]) != bed_magic[2]) {
+        throw std::runtime_error(path + " is not variant-major");
+    }
+    if (object_count == 0) {
+        throw std::runtime_error(path + " needs at least one object");
+    }
+
+    const uint64_t column_bytes = packed_genotype_bytes(object_count);
+    if ((size - sizeof(magic)) % column_bytes != 0) {
+        throw std::runtime_error(path + " does not hold whole variables of " + std::to_string(object_count) + " objects");
+    }
+    return (size - sizeof(magic)) / column_bytes;
+}
+
+#ifdef _WIN32
+
+MappedBedFile::MappedBedFile(const std::string& path, size_t object_count)
+        : object_count(object_count), mapping(nullptr), mapping_size(0), data(nullptr),
+          file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr) {
+    this->variable_count = bed_file_variables(path, object_count);
+
+    this->file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (this->file_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    this->mapping_handle = CreateFileMappingA(this->file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (this->mapping_handle == nullptr) {
+        CloseHandle(this->file_handle);
+        throw std::runtime_error("cannot map " + path);
+    }
+
+    this->mapping = MapViewOfFile(this->mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (this->mapping == nullptr) {
+        CloseHandle(this->mapping_handle);
+        CloseHandle(this->file_handle);
+        throw std::runtime_error("cannot map " + path);
+    }
+
+    this->data = static_cast<const uint8_t*>(this->mapping) + sizeof(bed_magic);
+}
+
+MappedBedFile::~MappedBedFile() {
+    UnmapViewOfFile(this->mapping);
+    CloseHandle(this->mapping_handle);
+    CloseHandle(this->file_handle);
+}
+
+#else
+
+MappedBedFile::MappedBedFile(const std::string& path, size_t object_count)
+        : object_count(object_count), mapping(nullptr), mapping_size(0), data(nullptr) {
+    this->variable_count = bed_file_variables(path, object_count);
+
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("cannot open " + path);
+    }
+    this->mapping_size = file_stat.st_size;
+
+    this->mapping = mmap(nullptr, this->mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (this->mapping == MAP_FAILED) {
+        throw std::runtime_error("cannot map " + path);
+    }
+
+    this->data = static_cast<const uint8_t*>(this->mapping) + sizeof(bed_magic);
+}
+
+MappedBedFile::~MappedBedFile() {
+    munmap(this->mapping, this->mapping_size);
+}
+
+#endif
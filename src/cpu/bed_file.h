@@ -0,0 +1,64 @@
+#ifndef BED_FILE_H
+#define BED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Genotypes packed 2 bits each, in the layout of PLINK .bed files (variant-major):
+// each variable takes (object_count + 3) / 4 bytes, 4 objects a byte starting
+// with the lowest bits. The codes are 0 - homozygous for the first allele,
+// 1 - missing, 2 - heterozygous, 3 - homozygous for the second allele and
+// the value of a genotype is the count of the second allele (0, 1 or 2).
+// A .bed file is these variables after the 3 bytes 0x6c 0x1b 0x01.
+
+constexpr uint8_t missing_genotype_code = 1;
+
+inline size_t packed_genotype_bytes(size_t object_count) {
+    return (object_count + 3) / 4;
+}
+
+inline uint8_t packed_genotype_code(const uint8_t* column, size_t object) {
+    return (column[object / 4] >> (2 * (object % 4))) & 3;
+}
+
+// the missing genotype is 0 here, it has to be rejected beforehand
+inline uint8_t packed_genotype(const uint8_t* column, size_t object) {
+    static const uint8_t genotype_of_code[4] = {0, 0, 1, 2};
+    return genotype_of_code[packed_genotype_code(column, object)];
+}
+
+// whether any of the packed genotypes of the variables is missing
+bool packed_genotypes_missing(const uint8_t* genotypes, size_t object_count, size_t variable_count);
+
+// number of variables of a .bed file of object_count objects,
+// throws std::runtime_error when it is not one
+size_t bed_file_variables(const std::string& path, size_t object_count);
+
+class MappedBedFile {
+public:
+    // object_count is the number of samples (lines of the .fam file);
+    // throws std::runtime_error when the file cannot be mapped
+    MappedBedFile(const std::string& path, size_t object_count);
+    ~MappedBedFile();
+
+    MappedBedFile(const MappedBedFile&) = delete;
+    MappedBedFile& operator=(const MappedBedFile&) = delete;
+
+    size_t objectCount() const { return this->object_count; }
+    size_t variableCount() const { return this->variable_count; }
+    const uint8_t* genotypes() const { return this->data; }
+
+private:
+    size_t object_count;
+    size_t variable_count;
+    void* mapping;
+    size_t mapping_size;
+    const uint8_t* data;
+    #ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+    #endif
+};
+
+#endif
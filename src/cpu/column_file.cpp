@@ -0,0 +1,238 @@
+#include "column_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char column_file_magic[8] = {'M', 'D', 'F', 'S', 'C', 'O', 'L', 'S'};
+static const uint32_t column_file_version = 1;
+
+size_t column_type_size(ColumnType type) {
+    switch (type) {
+        case ColumnType::Float64: return sizeof(double);
+        case ColumnType::Float32: return sizeof(float);
+    }
+    return 0;
+}
+
+static void validate_header(const ColumnFileHeader& header, const std::string& path, uint64_t file_size) {
+    if (std::memcmp(header.magic, column_file_magic, sizeof(column_file_magic)) != 0) {
+        throw std::runtime_error(path + " is not an MDFS column file");
+    }
+    if (header.version != column_file_version) {
+        throw std::runtime_error(path + " has an unsupported column file version");
+    }
+    if (column_type_size(header.type) == 0) {
+        throw std::runtime_error(path + " has an unsupported value type");
+    }
+    if (header.data_offset < sizeof(ColumnFileHeader)) {
+        throw std::runtime_error(path + " has a corrupted header");
+    }
+    // by division, the size of the values of a corrupted header may overflow
+    if (file_size < header.data_offset) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    const uint64_t value_count = (file_size - header.data_offset) / column_type_size(header.type);
+    if (header.variable_count != 0 && header.object_count > value_count / header.variable_count) {
+        throw std::runtime_error(path + " is truncated");
+    }
+}
+
+bool is_column_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(column_file_magic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, column_file_magic, sizeof(magic)) == 0;
+}
+
+ColumnFileHeader read_column_file_header(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    const uint64_t file_size = in.tellg();
+    in.seekg(0);
+
+    ColumnFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        throw std::runtime_error(path + " is not an MDFS column file");
+    }
+    validate_header(header, path, file_size);
+    return header;
+}
+
+void write_column_file(
+    const std::string& path,
+    const double* data,
+    size_t object_count,
+    size_t variable_count,
+    ColumnType type,
+    bool append
+) {
+    ColumnFileHeader header;
+    std::fstream out;
+
+    if (append) {
+        header = read_column_file_header(path);
+        if (header.object_count != object_count) {
+            throw std::runtime_error(path + " has a different number of objects");
+        }
+        if (header.type != type) {
+            throw std::runtime_error(path + " has a different value type");
+        }
+        out.open(path, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(header.data_offset + header.object_count * header.variable_count * column_type_size(type));
+    } else {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, column_file_magic, sizeof(column_file_magic));
+        header.version = column_file_version;
+        header.type = type;
+        header.object_count = object_count;
+        header.variable_count = 0;
+        header.data_offset = sizeof(ColumnFileHeader);
+
+        out.open(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    if (!out) {
+        throw std::runtime_error("cannot write " + path);
+    }
+
+    if (type == ColumnType::Float64) {
+        out.write(reinterpret_cast<const char*>(data), object_count * variable_count * sizeof(double));
+    } else {
+        std::vector<float> column(object_count);
+        for (size_t v = 0; v < variable_count; ++v) {
+            for (size_t o = 0; o < object_count; ++o) {
+                column[o] = data[v * object_count + o];
+            }
+            out.write(reinterpret_cast<const char*>(column.data()), object_count * sizeof(float));
+        }
+    }
+
+    // the variable count is updated last so that a failed write leaves a valid (shorter) file
+    header.variable_count += variable_count;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+#ifdef _WIN32
+
+MappedColumnFile::MappedColumnFile(const std::string& path)
+        : mapping(nullptr), mapping_size(0), data(nullptr), file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr) {
+    this->file_header = read_column_file_header(path);
+
+    this->file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (this->file_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    this->mapping_handle = CreateFileMappingA(this->file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (this->mapping_handle == nullptr) {
+        CloseHandle(this->file_handle);
+        throw std::runtime_error("cannot map " + path);
+    }
+
+    this->mapping = MapViewOfFile(this->mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (this->mapping == nullptr) {
+        CloseHandle(this->mapping_handle);
+        CloseHandle(this->file_handle);
+        throw std::runtime_error("cannot map " + path);
+    }
+
+    this->data = static_cast<const char*>(this->mapping) + this->file_header.data_offset;
+}
+
+MappedColumnFile::~MappedColumnFile() {
+    UnmapViewOfFile(this->mapping);
+    CloseHandle(this->mapping_handle);
+    CloseHandle(this->file_handle);
+}
+
+// the system read-ahead is relied on (FILE_FLAG_SEQUENTIAL_SCAN)
+void MappedColumnFile::advise(size_t var_index, int advice, bool inner) const {}
+
+void MappedColumnFile::willNeed(size_t var_index) const {}
+
+void MappedColumnFile::doneWith(size_t var_index) const {}
+
+#else
+
+MappedColumnFile::MappedColumnFile(const std::string& path)
+        : mapping(nullptr), mapping_size(0), data(nullptr) {
+    this->file_header = read_column_file_header(path);
+
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("cannot open " + path);
+    }
+    this->mapping_size = file_stat.st_size;
+
+    this->mapping = mmap(nullptr, this->mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping keeps the file open
+    if (this->mapping == MAP_FAILED) {
+        throw std::runtime_error("cannot map " + path);
+    }
+
+    // variables are discretized roughly in the file order
+    madvise(this->mapping, this->mapping_size, MADV_SEQUENTIAL);
+
+    this->data = static_cast<const char*>(this->mapping) + this->file_header.data_offset;
+}
+
+MappedColumnFile::~MappedColumnFile() {
+    munmap(this->mapping, this->mapping_size);
+}
+
+// inner limits the range to the pages within the column, otherwise the pages
+// shared with the neighbouring columns are included
+void MappedColumnFile::advise(size_t var_index, int advice, bool inner) const {
+    if (var_index >= this->file_header.variable_count) {
+        return;
+    }
+
+    static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t column_size = this->file_header.object_count * column_type_size(this->file_header.type);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(this->data) + var_index * column_size;
+    const uintptr_t end = start + column_size;
+
+    // madvise needs a page-aligned start
+    const uintptr_t aligned_start = inner ? (start + page_size - 1) & ~(page_size - 1) : start & ~(page_size - 1);
+    const uintptr_t aligned_end = inner ? end & ~(page_size - 1) : end;
+    if (aligned_end > aligned_start) {
+        madvise(reinterpret_cast<void*>(aligned_start), aligned_end - aligned_start, advice);
+    }
+}
+
+void MappedColumnFile::willNeed(size_t var_index) const {
+    this->advise(var_index, MADV_WILLNEED, false);
+}
+
+// pages of the mapping are only dropped from this process, they stay in the
+// page cache as long as the system sees fit; the pages shared with the
+// neighbouring columns are kept as these may be still in use
+void MappedColumnFile::doneWith(size_t var_index) const {
+    this->advise(var_index, MADV_DONTNEED, true);
+}
+
+#endif
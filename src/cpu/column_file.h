@@ -0,0 +1,85 @@
+#ifndef COLUMN_FILE_H
+#define COLUMN_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On-disk column-major matrix of continuous variables, mapped read-only so
+// that it does not have to fit in memory.
+//
+// Layout (little-endian): a 64-byte header followed by the columns, each
+// object_count values of the given type, one variable after another.
+//   offset  0: char[8]  magic "MDFSCOLS"
+//   offset  8: uint32   version (1)
+//   offset 12: uint32   value type (1 - float64, 2 - float32)
+//   offset 16: uint64   object count
+//   offset 24: uint64   variable count
+//   offset 32: uint64   offset of the first column (64)
+//   offset 40: reserved, zeros
+
+enum class ColumnType : uint32_t { Float64 = 1, Float32 = 2 };
+
+class ColumnFileHeader {
+public:
+    char magic[8];
+    uint32_t version;
+    ColumnType type;
+    uint64_t object_count;
+    uint64_t variable_count;
+    uint64_t data_offset;
+    uint8_t reserved[24];
+};
+
+static_assert(sizeof(ColumnFileHeader) == 64, "column file header has to be 64 bytes");
+
+size_t column_type_size(ColumnType type);
+
+// whether the file starts like a column file
+bool is_column_file(const std::string& path);
+
+// reads and validates the header, throws std::runtime_error
+ColumnFileHeader read_column_file_header(const std::string& path);
+
+// appends columns (column-major doubles, stored as the type of the file) to
+// the file, creating it first unless append is set; throws std::runtime_error
+void write_column_file(
+    const std::string& path,
+    const double* data,
+    size_t object_count,
+    size_t variable_count,
+    ColumnType type,
+    bool append
+);
+
+class MappedColumnFile {
+public:
+    // throws std::runtime_error when the file cannot be mapped
+    explicit MappedColumnFile(const std::string& path);
+    ~MappedColumnFile();
+
+    MappedColumnFile(const MappedColumnFile&) = delete;
+    MappedColumnFile& operator=(const MappedColumnFile&) = delete;
+
+    const ColumnFileHeader& header() const { return this->file_header; }
+    const void* columns() const { return this->data; }
+
+    // read-ahead of a column that is going to be read soon
+    void willNeed(size_t var_index) const;
+    // the column is not going to be read again soon, its pages may be dropped
+    void doneWith(size_t var_index) const;
+
+private:
+    ColumnFileHeader file_header;
+    void* mapping;
+    size_t mapping_size;
+    const void* data;
+    #ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+    #endif
+
+    void advise(size_t var_index, int advice, bool inner) const;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "common.h"
 
+#include <algorithm>
 #include <limits>
 
 
@@ -25,7 +26,7 @@ MDFSInfo::MDFSInfo(
 /* MDFSOutput */
 
 MDFSOutput::MDFSOutput(MDFSOutputType type, size_t n_dimensions, size_t variable_count, size_t n_contrast_variables)
-    : max_igs_tuples(nullptr), type(type), n_dimensions(n_dimensions), n_variables(variable_count), n_contrast_variables(n_contrast_variables) {
+    : max_igs_tuples(nullptr), discretization_max_igs(nullptr), n_discretizations(0), run_stats(nullptr), type(type), n_dimensions(n_dimensions), n_variables(variable_count), n_contrast_variables(n_contrast_variables) {
     switch(type) {
         case MDFSOutputType::MaxIGs:
             // init to -Inf to ensure we save negative values as well (they happen due to numerical errors with log)
@@ -70,6 +71,26 @@ void MDFSOutput::setMaxIGsTuples(int *tuples, int *dids) {
     this->dids = dids;
 }
 
+// igs holds n_variables max IGs of each discretization, initialised here
+void MDFSOutput::setDiscretizationMaxIGs(float *igs, size_t n_discretizations) {
+    this->discretization_max_igs = igs;
+    this->n_discretizations = n_discretizations;
+    std::fill(igs, igs + n_discretizations * this->n_variables, -std::numeric_limits<float>::infinity());
+}
+
+// of another output (of a thread) of the same size
+void MDFSOutput::mergeDiscretizationMaxIGs(const float *igs) {
+    for (size_t i = 0; i < this->n_discretizations * this->n_variables; ++i) {
+        if (igs[i] > this->discretization_max_igs[i]) {
+            this->discretization_max_igs[i] = igs[i];
+        }
+    }
+}
+
+void MDFSOutput::setRunStats(MDFSRunStats *run_stats) {
+    this->run_stats = run_stats;
+}
+
 void MDFSOutput::updateMaxIG(const size_t* tuple, float *igs, size_t discretization_id) {
     if (this->max_igs_tuples == nullptr) {
         for (size_t i = 0; i < n_dimensions; ++i) {
@@ -91,6 +112,15 @@ void MDFSOutput::updateMaxIG(const size_t* tuple, float *igs, size_t discretizat
             }
         }
     }
+
+    if (this->discretization_max_igs != nullptr) {
+        float* discretization_igs = this->discretization_max_igs + discretization_id * this->n_variables;
+        for (size_t i = 0; i < n_dimensions; ++i) {
+            if (igs[i] > discretization_igs[tuple[i]]) {
+                discretization_igs[tuple[i]] = igs[i];
+            }
+        }
+    }
 }
 
 void MDFSOutput::updateContrastMaxIG(const size_t contrast_idx, float contrast_ig, size_t discretization_id) {
@@ -1,13 +1,27 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <list>
 #include <vector>
 #include <map>
+#include <string>
 #include <tuple>
 
+#include "progress.h"
+#include "run_stats.h"
+
+
+class DiscretizationCache;
+
+// how the work of a run is split among the threads
+enum class ParallelMode {
+    Auto,  // by the numbers of tuples, variables, objects and threads (in 3D+ only without lower entropies)
+    Tuples,  // each thread evaluates its own tuples
+    Objects,  // all threads count each tuple, each its own objects
+};
 
 class MDFSInfo {
 public:
@@ -16,11 +30,38 @@ public:
     size_t discretizations;
     float pseudo;
     float ig_thr;
-    int* interesting_vars;  // has to be sorted
+    int* interesting_vars;  // has to be sorted, distinct and in range of the variables
     size_t interesting_vars_count;
     bool require_all_vars;
     const double* I_lower;
     bool average;
+    ProgressMonitor* progress = nullptr;  // optional, allows cancelling the run
+    // out-of-core mode: discretized variables are kept on disk in tiles of
+    // this many variables (0 - all in memory), in tile_dir (empty - system temporary)
+    size_t tile_size = 0;
+    std::string tile_dir;
+    DiscretizationCache* cache = nullptr;  // optional, discretized variables reused between runs
+    // memory for the conditional entropies of decision given all but one
+    // variable of a tuple, kept for 3D+ IGs instead of reducing counters (0 - none);
+    // in 3D all pairs, only when there are many more tuples than pairs
+    size_t lower_entropies_max_bytes = size_t(256) << 20;
+    // skip the tuples whose IGs are bounded (by the lower entropies) so that
+    // they cannot change max IGs or pass ig_thr; the result stays the same
+    // (MI with decision, only with tuples split among the threads, in memory)
+    bool prune = false;
+    // discrete data only: the objects equal in all the variables in use (the
+    // interesting ones when all are required), decision and contrast variables
+    // are counted once with their multiplicity; the result stays the same
+    // (ignored with contrast_sources, for sparse data and packed genotypes)
+    bool deduplicate = false;
+    // instead of contrast data: contrast variables generated as permutations
+    // of the discretized variables of these indices (seeded with contrast_seed)
+    const int* contrast_sources = nullptr;
+    size_t contrast_sources_count = 0;
+    uint32_t contrast_seed = 0;
+    // splitting objects (see objectParallelMDFS) suits few variables of many
+    // objects; only dense data without contrast variables, in memory
+    ParallelMode parallel_mode = ParallelMode::Auto;
 
     MDFSInfo(
         size_t dimensions,
@@ -37,68 +78,248 @@ public:
 };
 
 
+// number of k-element subsets of an n-element set
+inline uint64_t binomial(uint64_t n, uint64_t k) {
+    if (k > n) {
+        return 0;
+    }
+    uint64_t result = 1;
+    for (uint64_t i = 1; i <= k; ++i) {
+        result = result * (n - k + i) / i;  // exact at each step
+    }
+    return result;
+}
+
+
+// Tuples of n_dimensions variables out of n_variables (ascending within a
+// tuple), in lexicographic order. With interesting variables given, only
+// the tuples containing at least one of them are generated (each once),
+// grouped by how many of them they contain. Tuples are numbered (ranked)
+// in the order, so a range of ranks may be generated on its own.
 template <uint8_t n_dimensions>
 class TupleGenerator {
-    size_t nextTuple[n_dimensions+1];
     const size_t n_variables;
-    std::vector<size_t> interesting_vars;
+    std::vector<size_t> interesting_vars;  // sorted and distinct, empty - all variables are
+    std::vector<size_t> others_before;  // not interesting variables before each interesting one
+    size_t n_interesting;
+    size_t n_others;
+    uint64_t group_first[n_dimensions+2];  // rank of the first tuple with j interesting variables
+
+    // the next tuple as combinations of interesting and other variables
+    size_t n_in;
+    size_t in[n_dimensions+1];
+    size_t other[n_dimensions+1];
+    uint64_t next_rank;
+    uint64_t end_rank;
+
+    void decompose(uint64_t rank, size_t& n_in, size_t* in, size_t* other) const;
+    void compose(size_t n_in, const size_t* in, const size_t* other, size_t* out) const;
+    size_t interestingVariable(size_t index) const;
+    size_t otherVariable(size_t index) const;
 
 public:
     TupleGenerator(size_t n_variables);
+    TupleGenerator(size_t n_variables, const int* interesting_vars, size_t interesting_vars_count);
 
-    void set_interesting_vars(const std::vector<size_t>& interesting_vars);
-    void reset();
+    uint64_t count() const;
+    void reset();  // all tuples
+    void reset(uint64_t first, uint64_t last);  // tuples of ranks first to last-1
     bool hasNext() const;
     void next(size_t* out);
     void skip();
+
+    // tuple has to be one of the generated ones
+    uint64_t rank(const size_t* tuple) const;
+    void unrank(uint64_t rank, size_t* out) const;
 };
 
 
+// the next k-element combination of 0..n-1 in lexicographic order, false after the last one
+inline bool next_combination(size_t* c, size_t k, size_t n) {
+    size_t i = k;
+    while (i > 0 && c[i-1] == n - k + i - 1) {
+        i--;
+    }
+    if (i == 0) {
+        return false;
+    }
+    ++c[i-1];
+    for (; i < k; ++i) {
+        c[i] = c[i-1] + 1;
+    }
+    return true;
+}
+
+// number of a k-element combination of 0..n-1 in lexicographic order
+inline uint64_t rank_combination(const size_t* c, size_t k, size_t n) {
+    // complement of the combinadic of the mirrored combination
+    uint64_t mirrored = 0;
+    for (size_t i = 0; i < k; ++i) {
+        mirrored += binomial(n - 1 - c[i], k - i);
+    }
+    return binomial(n, k) - 1 - mirrored;
+}
+
+inline void unrank_combination(uint64_t rank, size_t k, size_t n, size_t* c) {
+    uint64_t mirrored = binomial(n, k) - 1 - rank;
+    size_t upper = n;  // the mirrored values decrease
+    for (size_t i = 0; i < k; ++i) {
+        // the largest a < upper with binomial(a, k - i) <= mirrored
+        size_t low = k - i - 1;
+        size_t high = upper - 1;
+        while (low < high) {
+            const size_t mid = low + (high - low + 1) / 2;
+            if (binomial(mid, k - i) <= mirrored) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        mirrored -= binomial(low, k - i);
+        c[i] = n - 1 - low;
+        upper = low;
+    }
+}
+
+
 template<uint8_t n_dimensions> TupleGenerator<n_dimensions>::TupleGenerator(size_t n_variables)
-        : n_variables(n_variables) {}
+        : TupleGenerator(n_variables, nullptr, 0) {}
+
+template<uint8_t n_dimensions> TupleGenerator<n_dimensions>::TupleGenerator(
+        size_t n_variables, const int* interesting_vars, size_t interesting_vars_count)
+        : n_variables(n_variables),
+          interesting_vars(interesting_vars, interesting_vars + interesting_vars_count) {
+    // each tuple is generated once only for distinct variables
+    std::sort(this->interesting_vars.begin(), this->interesting_vars.end());
+    this->interesting_vars.erase(
+        std::unique(this->interesting_vars.begin(), this->interesting_vars.end()),
+        this->interesting_vars.end());
+    interesting_vars_count = this->interesting_vars.size();
+
+    for (size_t i = 0; i < interesting_vars_count; ++i) {
+        this->others_before.push_back(this->interesting_vars[i] - i);
+    }
+    this->n_interesting = interesting_vars_count ? interesting_vars_count : n_variables;
+    this->n_others = n_variables - this->n_interesting;
+
+    // without interesting variables all tuples are in the group of n_dimensions
+    this->group_first[0] = 0;
+    for (size_t j = 0; j <= n_dimensions; ++j) {
+        const bool counted = j > 0 || interesting_vars_count == 0;
+        this->group_first[j+1] = this->group_first[j]
+            + (counted ? binomial(this->n_interesting, j) * binomial(this->n_others, n_dimensions - j) : 0);
+    }
+
+    this->reset();
+}
 
-template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::set_interesting_vars(const std::vector<size_t>& interesting_vars) {
-    this->interesting_vars = interesting_vars;
+template<uint8_t n_dimensions> uint64_t TupleGenerator<n_dimensions>::count() const {
+    return this->group_first[n_dimensions+1];
 }
 
 template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::reset() {
-    this->nextTuple[0] = 0;  // the sentinel
+    this->reset(0, this->count());
+}
 
-    for (size_t d = 1; d <= n_dimensions; ++d) {
-        this->nextTuple[d] = d - 1;
+template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::reset(uint64_t first, uint64_t last) {
+    this->next_rank = first;
+    this->end_rank = std::min(last, this->count());
+    if (this->next_rank < this->end_rank) {
+        this->decompose(this->next_rank, this->n_in, this->in, this->other);
     }
 }
 
 template<uint8_t n_dimensions> bool TupleGenerator<n_dimensions>::hasNext() const {
-    return this->nextTuple[0] == 0;
+    return this->next_rank < this->end_rank;
 }
 
-template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::next(size_t* out) {
-    for (size_t i = 1; i <= n_dimensions; i++) {
-        if (interesting_vars.empty()) {
-            out[i-1] = this->nextTuple[i];
-        } else {
-            out[i-1] = interesting_vars[this->nextTuple[i]];
-        }
-    }
+template<uint8_t n_dimensions> size_t TupleGenerator<n_dimensions>::interestingVariable(size_t index) const {
+    return this->interesting_vars.empty() ? index : this->interesting_vars[index];
+}
+
+template<uint8_t n_dimensions> size_t TupleGenerator<n_dimensions>::otherVariable(size_t index) const {
+    // interesting variables before it are those with fewer other variables before them
+    return index + (std::upper_bound(this->others_before.begin(), this->others_before.end(), index) - this->others_before.begin());
+}
 
+template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::next(size_t* out) {
+    this->compose(this->n_in, this->in, this->other, out);
     this->skip();
 }
 
 template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::skip() {
-    size_t d = n_dimensions;
+    if (++(this->next_rank) >= this->end_rank) {
+        return;
+    }
 
-    do {
-        ++(this->nextTuple[d]);
-        if (this->nextTuple[d] < n_variables - (n_dimensions - d) || d == 0) {
-            break;
+    if (next_combination(this->other, n_dimensions - this->n_in, this->n_others)) {
+        return;
+    }
+    for (size_t i = 0; i < n_dimensions - this->n_in; ++i) {
+        this->other[i] = i;
+    }
+    if (next_combination(this->in, this->n_in, this->n_interesting)) {
+        return;
+    }
+    // the first one of the next group
+    this->decompose(this->next_rank, this->n_in, this->in, this->other);
+}
+
+template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::decompose(
+        uint64_t rank, size_t& n_in, size_t* in, size_t* other) const {
+    size_t j = n_dimensions;
+    while (this->group_first[j] > rank) {  // empty groups are skipped as they start where the next one does
+        j--;
+    }
+    const uint64_t others_count = binomial(this->n_others, n_dimensions - j);
+    n_in = j;
+    unrank_combination((rank - this->group_first[j]) / others_count, j, this->n_interesting, in);
+    unrank_combination((rank - this->group_first[j]) % others_count, n_dimensions - j, this->n_others, other);
+}
+
+template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::compose(
+        size_t n_in, const size_t* in, const size_t* other, size_t* out) const {
+    // merge of the two ascending parts
+    size_t i = 0;
+    size_t o = 0;
+    for (size_t d = 0; d < n_dimensions; ++d) {
+        if (o == n_dimensions - n_in
+                || (i < n_in && this->interestingVariable(in[i]) < this->otherVariable(other[o]))) {
+            out[d] = this->interestingVariable(in[i++]);
+        } else {
+            out[d] = this->otherVariable(other[o++]);
         }
-        d--;
-    } while (1);
+    }
+}
 
-    for (++d; d <= n_dimensions; ++d) {
-        this->nextTuple[d] = this->nextTuple[d-1]+1;
+template<uint8_t n_dimensions> uint64_t TupleGenerator<n_dimensions>::rank(const size_t* tuple) const {
+    size_t in[n_dimensions+1];
+    size_t other[n_dimensions+1];
+    size_t j = 0;
+    size_t o = 0;
+    for (size_t d = 0; d < n_dimensions; ++d) {
+        if (this->interesting_vars.empty()) {
+            in[j++] = tuple[d];
+            continue;
+        }
+        const auto found = std::lower_bound(this->interesting_vars.begin(), this->interesting_vars.end(), tuple[d]);
+        if (found != this->interesting_vars.end() && *found == tuple[d]) {
+            in[j++] = found - this->interesting_vars.begin();
+        } else {
+            other[o++] = tuple[d] - (found - this->interesting_vars.begin());
+        }
     }
+    return this->group_first[j]
+        + rank_combination(in, j, this->n_interesting) * binomial(this->n_others, n_dimensions - j)
+        + rank_combination(other, o, this->n_others);
+}
+
+template<uint8_t n_dimensions> void TupleGenerator<n_dimensions>::unrank(uint64_t rank, size_t* out) const {
+    size_t n_in;
+    size_t in[n_dimensions+1];
+    size_t other[n_dimensions+1];
+    this->decompose(rank, n_in, in, other);
+    this->compose(n_in, in, other, out);
 }
 
 
@@ -114,6 +335,9 @@ public:
         std::vector<float> *all_tuples;
     };
     std::vector<float> *contrast_max_igs;
+    float *discretization_max_igs;  // kept only when set, by discretization, then variable
+    size_t n_discretizations;  // of discretization_max_igs
+    MDFSRunStats *run_stats;  // collected only when set
 
     MDFSOutput(MDFSOutputType type, size_t n_dimensions, size_t variable_count, size_t n_contrast_variables);
     ~MDFSOutput();
@@ -124,6 +348,9 @@ public:
     const size_t n_contrast_variables;
 
     void setMaxIGsTuples(int *tuples, int *dids);
+    void setDiscretizationMaxIGs(float *igs, size_t n_discretizations);
+    void mergeDiscretizationMaxIGs(const float *igs);
+    void setRunStats(MDFSRunStats *run_stats);
     void updateMaxIG(const size_t* tuple, float *igs, size_t discretization_id);
     void updateContrastMaxIG(const size_t contrast_idx, float contrast_ig, size_t discretization_id);
     void copyMaxIGsAsDouble(double *copy) const;
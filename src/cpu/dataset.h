@@ -3,6 +3,10 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
+
+#include "bed_file.h"
+#include "column_file.h"
 
 class RawDataInfo {
 public:
@@ -18,14 +22,82 @@ public:
     RawData(RawDataInfo data_file_info, const void* data, const int* decision)
         : info(data_file_info), data(data), decision(decision) {}
 
+    // discrete data of one byte a value, used in place (see byte_values)
+    RawData(RawDataInfo data_file_info, const uint8_t* data, const int* decision)
+        : info(data_file_info), data(data), decision(decision), byte_values(true) {}
+
+    // discrete data in compressed sparse columns, see sparse_columns
+    RawData(RawDataInfo data_file_info, const int* columns, const int* objects, const int* values, const int* decision)
+        : info(data_file_info), data(values), decision(decision), sparse_columns(columns), sparse_objects(objects) {}
+
+    // continuous data read from a mapped column file
+    RawData(const MappedColumnFile& file, const int* decision)
+        : info(file.header().object_count, file.header().variable_count), data(file.columns()), decision(decision),
+          single_precision(file.header().type == ColumnType::Float32), file(&file) {}
+
+    // discrete data of the genotypes of a mapped .bed file
+    RawData(const MappedBedFile& file, const int* decision)
+        : info(file.objectCount(), file.variableCount()), data(file.genotypes()), decision(decision),
+          packed_genotypes(true) {}
+
     RawDataInfo info;
-    const void* data; // either double or int
+    const void* data; // either double (float if single_precision), int (uint8_t if byte_values) or packed genotypes
     const int* decision;
+    const int* weights = nullptr;  // multiplicity of each object (discrete data only), nullptr - 1 each
+    bool single_precision = false;
+    const MappedColumnFile* file = nullptr;  // set when mapped, for read-ahead
+    // discrete data only: when set, the cells of variable v other than 0 are
+    // sparse_columns[v]..sparse_columns[v+1]-1, their objects (ascending) in
+    // sparse_objects and their values in data
+    const int* sparse_columns = nullptr;
+    const int* sparse_objects = nullptr;
+    // discrete data only: data holds genotypes packed 2 bits each (see bed_file.h)
+    bool packed_genotypes = false;
+    // discrete data only: data holds uint8_t values, which the engine reads
+    // without a copy unless only some of the variables are in use
+    bool byte_values = false;
 
     // returns pointer to array (info.object_count length) with requested variable
     inline const double* getVariable(size_t var_index) const {
         return (const double*) this->data + var_index * this->info.object_count;
     }
+    // as above, converted into buffer if stored as float
+    inline const double* getVariable(size_t var_index, std::vector<double>& buffer) const {
+        if (!this->single_precision) {
+            return this->getVariable(var_index);
+        }
+        const float* variable = this->getVariableF(var_index);
+        buffer.assign(variable, variable + this->info.object_count);
+        return buffer.data();
+    }
+    // only when stored as float
+    inline const float* getVariableF(size_t var_index) const {
+        return (const float*) this->data + var_index * this->info.object_count;
+    }
+    inline void willNeed(size_t var_index) const {
+        if (this->file != nullptr) {
+            this->file->willNeed(var_index);
+        }
+    }
+    inline void doneWith(size_t var_index) const {
+        if (this->file != nullptr) {
+            this->file->doneWith(var_index);
+        }
+    }
+    inline bool isSparse() const {
+        return this->sparse_columns != nullptr;
+    }
+    inline const uint8_t* getPackedVariable(size_t var_index) const {
+        return (const uint8_t*) this->data + var_index * packed_genotype_bytes(this->info.object_count);
+    }
+    inline const uint8_t* getVariableB(size_t var_index) const {
+        return (const uint8_t*) this->data + var_index * this->info.object_count;
+    }
+    // dense discrete data (int or uint8_t)
+    inline int getValueI(size_t var_index, size_t object) const {
+        return this->byte_values ? this->getVariableB(var_index)[object] : this->getVariableI(var_index)[object];
+    }
+    // neither for sparse data, packed genotypes nor byte values
     inline const int* getVariableI(size_t var_index) const {
         return (const int*) this->data + var_index * this->info.object_count;
     }
@@ -0,0 +1,184 @@
+#include "discretization_cache.h"
+#include "tile_store.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+bool DiscretizationCache::Key::operator<(const Key& other) const {
+    return std::tie(values_hash, object_count, feature_id, seed, discretization_id, divisions, range)
+         < std::tie(other.values_hash, other.object_count, other.feature_id, other.seed,
+                    other.discretization_id, other.divisions, other.range);
+}
+
+static inline uint64_t hash_word(uint64_t h, uint64_t word) {
+    // the finaliser of MurmurHash3 applied to the running state
+    h ^= word;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t hash_bytes(uint64_t h, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        h = hash_word(h, word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes + i, size - i);
+    return hash_word(h, tail ^ (uint64_t(size) << 56));
+}
+
+uint64_t DiscretizationCache::hashValues(const double* values, size_t count) {
+    return hash_bytes(0x9e3779b97f4a7c15ULL, values, count * sizeof(double));
+}
+
+uint64_t DiscretizationCache::hashContext(const uint8_t* decision, size_t object_count, const float* p, size_t n_decision_classes) {
+    uint64_t h = hash_bytes(0x9e3779b97f4a7c15ULL, p, n_decision_classes * sizeof(float));
+    if (decision != nullptr) {
+        h = hash_bytes(h, decision, object_count);
+    }
+    return h;
+}
+
+DiscretizationCache::DiscretizationCache(size_t max_bytes, const std::string& spill_dir) : max_bytes(max_bytes) {
+    if (!spill_dir.empty()) {
+        this->remove_spill = open_temporary_file(spill_dir, "mdfs-cache", this->spill, this->spill_path);
+    }
+}
+
+DiscretizationCache::~DiscretizationCache() {
+    if (!this->spill_path.empty()) {
+        this->spill.close();
+        if (this->remove_spill) {
+            std::remove(this->spill_path.c_str());
+        }
+    }
+}
+
+bool DiscretizationCache::find(const Key& key, uint8_t* out) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    auto found = this->entries.find(key);
+    if (found == this->entries.end()) {
+        this->counters.misses++;
+        return false;
+    }
+    Entry& entry = found->second;
+
+    if (entry.data.empty()) {
+        this->load(entry, key.object_count);
+        if (entry.data.empty()) {  // the spill file failed us
+            this->entries.erase(found);
+            this->counters.variables--;
+            this->counters.misses++;
+            return false;
+        }
+        entry.lru = this->lru.insert(this->lru.begin(), key);
+        std::memcpy(out, entry.data.data(), key.object_count);
+        this->shrink();
+    } else {
+        this->lru.splice(this->lru.begin(), this->lru, entry.lru);
+        std::memcpy(out, entry.data.data(), key.object_count);
+    }
+
+    this->counters.hits++;
+    return true;
+}
+
+void DiscretizationCache::insert(const Key& key, const uint8_t* data) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    Entry& entry = this->entries[key];
+    if (!entry.data.empty()) {  // inserted by another thread meanwhile
+        return;
+    }
+    if (!entry.spilled) {
+        this->counters.variables++;
+    }
+    entry.data.assign(data, data + key.object_count);
+    entry.lru = this->lru.insert(this->lru.begin(), key);
+    this->counters.memory_bytes += key.object_count;
+    this->shrink();
+}
+
+bool DiscretizationCache::findLowerEntropy(const Key& key, uint64_t context, float& H) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    auto found = this->entries.find(key);
+    if (found == this->entries.end()) {
+        return false;
+    }
+    auto lower_entropy = found->second.lower_entropies.find(context);
+    if (lower_entropy == found->second.lower_entropies.end()) {
+        return false;
+    }
+    H = lower_entropy->second;
+    this->counters.entropy_hits++;
+    return true;
+}
+
+void DiscretizationCache::insertLowerEntropy(const Key& key, uint64_t context, float H) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // only along with the variable, which may have been dropped already
+    auto found = this->entries.find(key);
+    if (found != this->entries.end()) {
+        found->second.lower_entropies[context] = H;
+    }
+}
+
+DiscretizationCacheStats DiscretizationCache::stats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->counters;
+}
+
+// reads a spilled variable back, leaves the data empty on failure
+void DiscretizationCache::load(Entry& entry, size_t size) {
+    entry.data.resize(size);
+    this->spill.seekg(entry.spill_offset);
+    this->spill.read(reinterpret_cast<char*>(entry.data.data()), size);
+    if (!this->spill) {
+        this->spill.clear();
+        entry.data.clear();
+        return;
+    }
+    this->counters.memory_bytes += size;
+}
+
+// drops or spills the least recently used variables until within the limit
+void DiscretizationCache::shrink() {
+    while (this->counters.memory_bytes > this->max_bytes && !this->lru.empty()) {
+        const Key key = this->lru.back();
+        this->lru.pop_back();
+
+        auto found = this->entries.find(key);
+        Entry& entry = found->second;
+
+        if (!entry.spilled && !this->spill_path.empty()) {
+            this->spill.seekp(0, std::ios::end);
+            entry.spill_offset = this->spill.tellp();
+            this->spill.write(reinterpret_cast<const char*>(entry.data.data()), entry.data.size());
+            this->spill.flush();
+            if (this->spill) {
+                entry.spilled = true;
+                this->counters.spilled_bytes += entry.data.size();
+            } else {
+                this->spill.clear();
+            }
+        }
+
+        this->counters.memory_bytes -= entry.data.size();
+        if (entry.spilled) {
+            // already in the file, variables are never changed
+            std::vector<uint8_t>().swap(entry.data);
+        } else {
+            this->entries.erase(found);
+            this->counters.variables--;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef DISCRETIZATION_CACHE_H
+#define DISCRETIZATION_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class DiscretizationCacheStats {
+public:
+    uint64_t hits = 0;  // variables not discretized thanks to the cache
+    uint64_t misses = 0;
+    uint64_t entropy_hits = 0;  // lower entropies not computed thanks to the cache
+    uint64_t variables = 0;  // discretized variables held, in memory or spilled
+    uint64_t memory_bytes = 0;
+    uint64_t spilled_bytes = 0;
+};
+
+// Discretized variables (and their lower entropies) kept between runs so
+// that repeated runs on the same data with the same discretization
+// parameters skip sorting and discretizing. A variable is identified by
+// a hash of its values and all the parameters of discretize. Least
+// recently used variables are dropped when the cache grows over its limit,
+// or moved to a file in spill_dir when that is set. Thread-safe.
+class DiscretizationCache {
+public:
+    class Key {
+    public:
+        uint64_t values_hash;
+        uint64_t object_count;
+        uint32_t feature_id;
+        uint32_t seed;
+        uint32_t discretization_id;
+        uint32_t divisions;
+        double range;
+
+        bool operator<(const Key& other) const;
+    };
+
+    static uint64_t hashValues(const double* values, size_t count);
+    static Key key(const double* values, size_t object_count, uint32_t feature_id, uint32_t seed,
+                   uint32_t discretization_id, uint32_t divisions, double range) {
+        return Key{hashValues(values, object_count), object_count, feature_id, seed, discretization_id, divisions, range};
+    }
+    // of what lower entropies depend on besides the variable (decision and pseudocounts)
+    static uint64_t hashContext(const uint8_t* decision, size_t object_count, const float* p, size_t n_decision_classes);
+
+    // max_bytes limits discretized data in memory; spill_dir empty means no spilling;
+    // throws std::runtime_error when the spill file cannot be created
+    DiscretizationCache(size_t max_bytes, const std::string& spill_dir);
+    ~DiscretizationCache();
+
+    DiscretizationCache(const DiscretizationCache&) = delete;
+    DiscretizationCache& operator=(const DiscretizationCache&) = delete;
+
+    // copy key.object_count values, find returns whether the variable was there
+    bool find(const Key& key, uint8_t* out);
+    void insert(const Key& key, const uint8_t* data);
+
+    bool findLowerEntropy(const Key& key, uint64_t context, float& H);
+    void insertLowerEntropy(const Key& key, uint64_t context, float H);
+
+    DiscretizationCacheStats stats() const;
+
+private:
+    class Entry {
+    public:
+        std::vector<uint8_t> data;  // empty when only in the spill file
+        bool spilled = false;
+        uint64_t spill_offset = 0;
+        std::map<uint64_t, float> lower_entropies;  // by context
+        std::list<Key>::iterator lru;  // valid when data is in memory
+    };
+
+    std::map<Key, Entry> entries;
+    std::list<Key> lru;  // in memory only, the most recently used first
+    const size_t max_bytes;
+    DiscretizationCacheStats counters;
+
+    std::string spill_path;
+    std::fstream spill;
+    bool remove_spill = false;  // see open_temporary_file
+
+    mutable std::mutex mutex;
+
+    void load(Entry& entry, size_t size);
+    void shrink();
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "discretize.h"
 
+#include <algorithm>
 #include <random>
 
 void discretize(
@@ -15,43 +16,65 @@ void discretize(
 ) {
     double* thresholds = new double[divisions];
 
+    discretization_thresholds(seed, discretization_index, feature_id, divisions, object_count,
+                              sorted_in_data.data(), range, thresholds);
+    apply_thresholds(divisions, thresholds, object_count, in_data, out_data);
+
+    delete[] thresholds;
+}
+
+void discretization_thresholds(
+    uint32_t seed,
+    uint32_t discretization_index,
+    uint32_t feature_id,
+    std::size_t divisions,
+    std::size_t object_count,
+    const double* sorted_in_data,
+    double range,
+    double* thresholds
+) {
+    double sum = 0.0f;
     // brackets to limit scope
     {
-        double sum = 0.0f;
-        // brackets to limit scope
-        {
-            std::mt19937 seed_random_generator0(seed);
-            std::mt19937 seed_random_generator1(seed_random_generator0() ^ discretization_index);
-            std::mt19937 random_generator(seed_random_generator1() ^ feature_id);
-
-            // E(X) = (a + b) / 2 = (1 - range + 1 + range) / 2 = 1
-            std::uniform_real_distribution<double> uniform_range(1.0f - range, 1.0f + range);
-
-            for (std::size_t d = 0; d < divisions; ++d) {
-                thresholds[d] = uniform_range(random_generator);
-                sum += thresholds[d];
-            }
-
-            sum += uniform_range(random_generator);
-        }
+        std::mt19937 seed_random_generator0(seed);
+        std::mt19937 seed_random_generator1(seed_random_generator0() ^ discretization_index);
+        std::mt19937 random_generator(seed_random_generator1() ^ feature_id);
 
-        std::size_t done = 0;
-        const double length_step = static_cast<double>(object_count) / sum;
+        // E(X) = (a + b) / 2 = (1 - range + 1 + range) / 2 = 1
+        std::uniform_real_distribution<double> uniform_range(1.0f - range, 1.0f + range);
 
-        // thresholds are converted from an arbitrary space into real values (via indices)
-        // d - iterates over divisions (of a variable in a discretization)
         for (std::size_t d = 0; d < divisions; ++d) {
-            done += std::lround(thresholds[d] * length_step);
+            thresholds[d] = uniform_range(random_generator);
+            sum += thresholds[d];
+        }
+
+        sum += uniform_range(random_generator);
+    }
+
+    std::size_t done = 0;
+    const double length_step = static_cast<double>(object_count) / sum;
 
-            // Note: Check when will this happen, maybe could be skipped
-            if (done >= object_count) {
-                done = object_count - 1;
-            }
+    // thresholds are converted from an arbitrary space into real values (via indices)
+    // d - iterates over divisions (of a variable in a discretization)
+    for (std::size_t d = 0; d < divisions; ++d) {
+        done += std::lround(thresholds[d] * length_step);
 
-            thresholds[d] = sorted_in_data[done];
+        // Note: Check when will this happen, maybe could be skipped
+        if (done >= object_count) {
+            done = object_count - 1;
         }
+
+        thresholds[d] = sorted_in_data[done];
     }
+}
 
+void apply_thresholds(
+    std::size_t divisions,
+    const double* thresholds,
+    std::size_t object_count,
+    const double* in_data,
+    uint8_t* out_data
+) {
     // o - iterates over objects
     for (std::size_t o = 0; o < object_count; ++o) {
         out_data[o] = 0;
@@ -63,6 +86,23 @@ void discretize(
             out_data[o] += in_data[o] > thresholds[d];
         }
     }
+}
 
-    delete[] thresholds;
+void permute_discretized(
+    uint32_t seed,
+    uint32_t contrast_index,
+    std::size_t object_count,
+    const uint8_t* in_data,
+    uint8_t* out_data
+) {
+    std::mt19937 seed_random_generator(seed);
+    std::mt19937 random_generator(seed_random_generator() ^ contrast_index);
+
+    std::copy(in_data, in_data + object_count, out_data);
+
+    // Fisher-Yates shuffle
+    for (std::size_t o = object_count; o > 1; --o) {
+        std::uniform_int_distribution<std::size_t> uniform_index(0, o - 1);
+        std::swap(out_data[o - 1], out_data[uniform_index(random_generator)]);
+    }
 }
@@ -17,4 +17,36 @@ void discretize(
     double range
 );
 
+// the divisions thresholds of discretize, from the sorted values of the variable
+void discretization_thresholds(
+    uint32_t seed,
+    uint32_t discretization_index,
+    uint32_t feature_id,
+    std::size_t divisions,
+    std::size_t object_count,
+    const double* sorted_in_data,
+    double range,
+    double* thresholds
+);
+
+// discretizes object_count values with the thresholds, so that a range of
+// the objects may be discretized on its own
+void apply_thresholds(
+    std::size_t divisions,
+    const double* thresholds,
+    std::size_t object_count,
+    const double* in_data,
+    uint8_t* out_data
+);
+
+// contrast variable as a random permutation of the objects of a discretized
+// variable; the permutation depends only on seed and contrast_index
+void permute_discretized(
+    uint32_t seed,
+    uint32_t contrast_index,
+    std::size_t object_count,
+    const uint8_t* in_data,
+    uint8_t* out_data
+);
+
 #endif
@@ -5,7 +5,7 @@
 #include <cmath>
 
 
-// only 2 decision classes are supported
+// counters of each decision class follow those of the previous one
 // (note it does not make sense for 1 decision class)
 template <uint8_t n_decision_classes>
 inline float conditional_entropy(size_t n_cubes, const float *c) {
@@ -13,12 +13,11 @@ inline float conditional_entropy(size_t n_cubes, const float *c) {
 
     for (size_t i = 0; i < n_cubes; ++i) {
         float c_sum = c[i];
-        if (n_decision_classes > 1) {
-            c_sum += c[n_cubes + i];
+        for (uint8_t k = 1; k < n_decision_classes; ++k) {
+            c_sum += c[k * n_cubes + i];
         }
-        H -= (c[i]) * std::log2(c[i]/c_sum);
-        if (n_decision_classes > 1) {
-            H -= (c[n_cubes + i]) * std::log2(c[n_cubes + i]/c_sum);
+        for (uint8_t k = 0; k < n_decision_classes; ++k) {
+            H -= (c[k * n_cubes + i]) * std::log2(c[k * n_cubes + i]/c_sum);
         }
     }
 
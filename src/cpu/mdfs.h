@@ -5,11 +5,18 @@
 
 #include "common.h"
 #include "dataset.h"
-#include "discretize.h"
+#include "discretization_cache.h"
+#include "mdfs_discretize.h"
+#include "mdfs_lower_entropies.h"
+#include "mdfs_object_parallel.h"
+#include "mdfs_tiled.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <limits>
 #include <memory>
+#include <numeric>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -24,21 +31,52 @@ void scalarMDFS(
     std::unique_ptr<const DiscretizationInfo> dfi,
     MDFSOutput& out
 ) {
+    if (mdfs_info.tile_size > 0) {
+        tiledMDFS<n_decision_classes, n_dimensions, stat_mode>(mdfs_info, raw_data, std::move(dfi), out);
+        return;
+    }
+    if (use_object_parallel<n_dimensions>(mdfs_info, raw_data, contrast_raw_data)) {
+        objectParallelMDFS<n_decision_classes, n_dimensions, stat_mode>(mdfs_info, raw_data, std::move(dfi), out);
+        return;
+    }
+
+    const auto run_start = std::chrono::steady_clock::now();
+    #ifdef _OPENMP
+    int run_numthr = 1;
+    if (out.run_stats != nullptr) {
+        out.run_stats->threads.resize(omp_get_max_threads());
+    }
+    #else
+    if (out.run_stats != nullptr) {
+        out.run_stats->threads.resize(1);
+    }
+    #endif
+
     size_t c[n_decision_classes];
     for (uint8_t i = 0; i < n_decision_classes; i++) {
         c[i] = 0;
     }
+    // multiplicities of the objects, nullptr when each is 1
+    const int* weights = raw_data->weights;
+    auto weight_of = [&](size_t i) -> size_t {
+        return weights != nullptr ? weights[i] : 1;
+    };
+
     uint8_t* decision = nullptr;
     if (n_decision_classes > 1) {
         decision = new uint8_t[raw_data->info.object_count];
         for (size_t i = 0; i < raw_data->info.object_count; i++) {
             decision[i] = raw_data->decision[i];
-            c[decision[i]]++;
+            c[decision[i]] += weight_of(i);
         }
     } else {
-        c[0] = raw_data->info.object_count;
+        for (size_t i = 0; i < raw_data->info.object_count; i++) {
+            c[0] += weight_of(i);
+        }
     }
     const float cmin = *std::min_element(c, c+n_decision_classes);
+    // the total weight of the objects, see count_counters
+    const bool exact_in_float = std::accumulate(c, c+n_decision_classes, size_t(0)) <= float_exact_objects;
 
     // this is to treat ig_thr=0 and below as unset (ignored) and allow for the
     // numeric errors to pass through the relevance filter (IGs end up being
@@ -66,34 +104,138 @@ void scalarMDFS(
     // H(Y) (plain) entropy of decision (computed simply as conditional given an empty set of vars)
     const float H_Y = conditional_entropy<n_decision_classes>(1, H_Y_counters);
 
-    // for the optimised 2D version
+    // variables in use, stored densely and tuples are made of their positions in data;
+    // the positions are mapped back to variables only for the output
+    const bool only_interesting = mdfs_info.interesting_vars_count && mdfs_info.require_all_vars;
+    const size_t n_positions = only_interesting ? mdfs_info.interesting_vars_count : raw_data->info.variable_count;
+    auto variable_at = [&](size_t position) -> size_t {
+        return only_interesting ? mdfs_info.interesting_vars[position] : position;
+    };
+
+    // for the optimised 2D version, by position
     float* H = nullptr;
     if (n_dimensions == 2) {
-        H = new float[raw_data->info.variable_count];
+        H = new float[n_positions];
         if (mdfs_info.I_lower != nullptr) {
-            for (size_t i = 0; i < raw_data->info.variable_count; i++) {
+            for (size_t i = 0; i < n_positions; i++) {
                 if (n_decision_classes == 1) {
-                    H[i] = mdfs_info.I_lower[i];
+                    H[i] = mdfs_info.I_lower[variable_at(i)];
                 } else {
-                    H[i] = H_Y - mdfs_info.I_lower[i];
+                    H[i] = H_Y - mdfs_info.I_lower[variable_at(i)];
                 }
             }
         }
     }
 
-    const size_t n_vars_to_discretize = mdfs_info.interesting_vars_count && mdfs_info.require_all_vars ?
-                                        mdfs_info.interesting_vars_count :
-                                        raw_data->info.variable_count;
-
     // total of all counters; used only in no decision mode
-    const float total_counters = raw_data->info.object_count + p[0] * num_of_cubes;
-
-    uint8_t* data = new uint8_t[raw_data->info.object_count * raw_data->info.variable_count];
+    const float total_counters = c[0] + p[0] * num_of_cubes;
+
+    // contrast variables are either given or permutations of the given variables
+    const size_t n_contrast_variables = contrast_raw_data != nullptr ?
+                                        contrast_raw_data->info.variable_count :
+                                        mdfs_info.contrast_sources_count;
+    // sparse data is counted as given (by position), with contrast variables it is made dense
+    SparseColumns* sparse = nullptr;
+    SparseColumns sparse_columns;
+    if (raw_data->isSparse() && n_contrast_variables == 0) {
+        const int* values = static_cast<const int*>(raw_data->data);
+        for (size_t i = 0; i < n_positions; i++) {
+            const int first = raw_data->sparse_columns[variable_at(i)];
+            sparse_columns.objects.push_back(raw_data->sparse_objects + first);
+            sparse_columns.values.push_back(values + first);
+            sparse_columns.sizes.push_back(raw_data->sparse_columns[variable_at(i) + 1] - first);
+        }
+        sparse_columns.class_totals.assign(c, c + n_decision_classes);
+        sparse = &sparse_columns;
+    }
+    // and so are packed genotypes
+    PackedGenotypes* packed = nullptr;
+    PackedGenotypes packed_genotypes;
+    if (raw_data->packed_genotypes && n_contrast_variables == 0) {
+        for (size_t i = 0; i < n_positions; i++) {
+            packed_genotypes.columns.push_back(raw_data->getPackedVariable(variable_at(i)));
+        }
+        packed_genotypes.prepare(decision, n_decision_classes, raw_data->info.object_count);
+        packed = &packed_genotypes;
+    }
+    const bool dense = sparse == nullptr && packed == nullptr;
+    // discrete bytes are counted in the caller's buffer when positions are variables
+    const bool in_place = dense && raw_data->byte_values && !only_interesting;
+    uint8_t* owned_data = dense && !in_place ? new uint8_t[raw_data->info.object_count * n_positions] : nullptr;
+    const uint8_t* data = in_place ? static_cast<const uint8_t*>(raw_data->data) : owned_data;
     uint8_t* contrast_data = nullptr;
-    if (contrast_raw_data != nullptr) {
-        contrast_data = new uint8_t[contrast_raw_data->info.object_count * contrast_raw_data->info.variable_count];
+    if (n_contrast_variables > 0) {
+        contrast_data = new uint8_t[raw_data->info.object_count * n_contrast_variables];
+    }
+
+    // only continuous data is worth caching; keys of the current discretization, by position
+    DiscretizationCache* const cache = dfi ? mdfs_info.cache : nullptr;
+    std::vector<DiscretizationCache::Key> cache_keys(cache != nullptr ? n_positions : 0);
+
+    // tuples with at least one interesting variable when not all are required
+    const int* generated_interesting_vars = only_interesting ? nullptr : mdfs_info.interesting_vars;
+    const size_t generated_interesting_vars_count = only_interesting ? 0 : mdfs_info.interesting_vars_count;
+    const uint64_t n_tuples = TupleGenerator<n_dimensions>(
+        n_positions, generated_interesting_vars, generated_interesting_vars_count).count();
+
+    // for 3D+ IGs, H(Y|{X_i!=X_k}) is looked up instead of reduced from the counters:
+    // in 3D from a table of all pairs (by positions), computed once per discretization,
+    // beyond 3D memoised by each thread; the table is built only for many more tuples
+    // than pairs, otherwise counting the pairs costs more than it saves (as for the
+    // tuples of few interesting variables)
+    const bool use_lower_entropies = n_dimensions >= 3 && n_decision_classes > 1
+        && stat_mode == StatMode::MutualInformation && mdfs_info.lower_entropies_max_bytes > 0;
+    const uint64_t n_pairs = uint64_t(n_positions) * (n_positions - 1) / 2;
+    std::vector<float> H_pairs;
+    if (use_lower_entropies && n_dimensions == 3
+            && n_pairs <= mdfs_info.lower_entropies_max_bytes / sizeof(float)
+            && n_tuples >= pair_table_min_tuples_per_pair * n_pairs) {
+        H_pairs.resize(n_pairs);
     }
 
+    // H(Y|{X_i!=X_k}) of a 3D tuple (of positions) from the pair table,
+    // compiled only in 3D where the table exists
+    auto pairs_H_except = [&](const size_t* tuple_positions, float* tuple_H_except) {
+        if constexpr (n_dimensions == 3) {
+            for (size_t k = 0; k < n_dimensions; ++k) {
+                size_t others[2];
+                for (size_t v = 0, o = 0; v < n_dimensions && o < 2; ++v) {
+                    if (v != k) {
+                        others[o++] = tuple_positions[v];
+                    }
+                }
+                tuple_H_except[k] = H_pairs[pair_index(others[0], others[1])];
+            }
+        }
+    };
+
+    // the IG of X_k is H(Y|{X_i!=X_k}) - H(Y|{X_i}), where the latter is a sum of
+    // non-negative terms, so a tuple is skipped when the former (H in 2D, the lower
+    // entropies beyond) is not above the max IG of any X_k or ig_thr
+    const bool prune = mdfs_info.prune && n_dimensions >= 2 && n_decision_classes > 1
+        && stat_mode == StatMode::MutualInformation
+        && (out.type == MDFSOutputType::MaxIGs || (out.type == MDFSOutputType::MatchingTuples && mdfs_info.ig_thr > 0.0f));
+    // to have the maxima tight from the start, the IGs of one promising tuple of each
+    // position (with the most informative variables) are known before the run; only
+    // where these are computed the same way as in the run (2D and the 3D pair table)
+    const bool seed_max_igs = prune && out.type == MDFSOutputType::MaxIGs && (n_dimensions == 2 || !H_pairs.empty());
+    std::vector<float> seed_igs(seed_max_igs ? n_positions : 0);  // by position
+    std::vector<float> H_single(seed_max_igs && n_dimensions > 2 ? n_positions : 0);  // H(Y|X_i) to rank by in 3D
+
+    ProgressMonitor* const progress = mdfs_info.progress;
+    if (progress != nullptr) {
+        // the pairs of the table count as tuples
+        uint64_t tuples_per_discretization = n_tuples + H_pairs.size();
+        if (n_contrast_variables > 0) {
+            tuples_per_discretization += TupleGenerator<n_dimensions-1>(
+                n_positions, generated_interesting_vars, generated_interesting_vars_count).count() * n_contrast_variables;
+        }
+        // synchronise with the monitor about every 4M objects counted
+        progress->start(tuples_per_discretization * mdfs_info.discretizations, (1 << 22) / raw_data->info.object_count + 1);
+    }
+    // decided by the master thread at the start of each discretization so that all threads agree
+    bool stop_run = false;
+
     #ifdef _OPENMP
     #pragma omp parallel
     #endif
@@ -106,114 +248,166 @@ void scalarMDFS(
         constexpr int omp_tidx = 0;
         #endif
 
+        #ifdef _OPENMP
+        #pragma omp master
+        run_numthr = omp_numthr;
+        #endif
+
+        // counters are cheap enough to be always kept, timers are not
+        ThreadRunStats thread_stats;
+        PhaseTimer timer(out.run_stats != nullptr ? &thread_stats : nullptr);
+
+        uint64_t progress_pending = 0;
+
+        std::vector<double> column_buffer;  // for data stored as float
+        std::vector<uint8_t> source_buffer;  // for contrast sources not discretized otherwise
+
+        size_t local_tuple[n_dimensions];  // positions in data
         size_t tuple[n_dimensions];
         size_t subtuple[n_dimensions]; // only n_dimensions-1 are used, not using -1 in here to avoid 0-size array
         float igs[n_dimensions];
         float* counters = new float[n_decision_classes * num_of_cubes];
+        uint64_t* exact_counters = exact_in_float ? nullptr : new uint64_t[n_decision_classes * num_of_cubes];  // of any tuple counted here
         float* reduced = new float[n_decision_classes * num_of_cubes_reduced];
 
-        TupleGenerator<n_dimensions> generator(
-                mdfs_info.interesting_vars_count && mdfs_info.require_all_vars ?
-                mdfs_info.interesting_vars_count : raw_data->info.variable_count);
+        float H_except[n_dimensions];
+        const bool use_lower_memo = use_lower_entropies && n_dimensions > 3;
+        LowerEntropyMemo<n_dimensions> lower_memo(use_lower_memo ? mdfs_info.lower_entropies_max_bytes / omp_numthr : 0);
+
+        // both over positions
+        TupleGenerator<n_dimensions> generator(n_positions, generated_interesting_vars, generated_interesting_vars_count);
         TupleGenerator<n_dimensions-1> subgenerator(  // against contrast vars
-                mdfs_info.interesting_vars_count && mdfs_info.require_all_vars ?
-                mdfs_info.interesting_vars_count : raw_data->info.variable_count);
-        if (mdfs_info.interesting_vars_count && mdfs_info.require_all_vars) {
-            generator.set_interesting_vars(std::vector<size_t>(mdfs_info.interesting_vars, mdfs_info.interesting_vars + mdfs_info.interesting_vars_count));
-            subgenerator.set_interesting_vars(std::vector<size_t>(mdfs_info.interesting_vars, mdfs_info.interesting_vars + mdfs_info.interesting_vars_count));
-        }
+            n_positions, generated_interesting_vars, generated_interesting_vars_count);
+
+        // a contiguous range of tuples for each thread
+        const uint64_t thread_tuples = generator.count() / omp_numthr;
+        const uint64_t thread_tuples_left = generator.count() % omp_numthr;
+        const uint64_t thread_first_tuple = thread_tuples * omp_tidx + std::min<uint64_t>(omp_tidx, thread_tuples_left);
+        const uint64_t thread_last_tuple = thread_first_tuple + thread_tuples + (uint64_t(omp_tidx) < thread_tuples_left);
 
         #ifdef _OPENMP
         MDFSOutput* thread_out = nullptr;
         if (out.type == MDFSOutputType::MaxIGs) {
-            if (contrast_raw_data != nullptr) {
-                thread_out = new MDFSOutput(out.type, n_dimensions, raw_data->info.variable_count, contrast_raw_data->info.variable_count);
+            if (n_contrast_variables > 0) {
+                thread_out = new MDFSOutput(out.type, n_dimensions, raw_data->info.variable_count, n_contrast_variables);
             } else {
                 thread_out = new MDFSOutput(out.type, n_dimensions, raw_data->info.variable_count, 0);
             }
             if (out.max_igs_tuples != nullptr) {
                 thread_out->setMaxIGsTuples(new int[n_dimensions*raw_data->info.variable_count], new int[raw_data->info.variable_count]);
             }
+            if (out.discretization_max_igs != nullptr) {
+                thread_out->setDiscretizationMaxIGs(new float[mdfs_info.discretizations * raw_data->info.variable_count],
+                                                    mdfs_info.discretizations);
+            }
         }
         #endif
 
+        const MDFSOutput* known_out = nullptr;  // of this thread, for pruning
+        if (out.type == MDFSOutputType::MaxIGs) {
+            #ifdef _OPENMP
+            known_out = thread_out;
+            #else
+            known_out = &out;
+            #endif
+        }
+
         for (size_t discretization_id = 0; discretization_id < mdfs_info.discretizations; discretization_id++) {
+            #ifdef _OPENMP
+            #pragma omp master
+            #endif
+            stop_run = progress != nullptr && progress->cancelled();
+
             #ifdef _OPENMP
             #pragma omp barrier
             #endif
+            timer.lap(RunBarrier::DiscretizationStart);
+
+            if (stop_run) {
+                break;
+            }
 
             if (dfi) {
-                for (size_t i = omp_tidx; i < n_vars_to_discretize; i += omp_numthr) {
-                    const size_t v = mdfs_info.interesting_vars_count && mdfs_info.require_all_vars ?
-                                     mdfs_info.interesting_vars[i] :
-                                     i;
-                    const double* in_data = raw_data->getVariable(v);
-
-                    std::vector<double> sorted_in_data(in_data, in_data + raw_data->info.object_count);
-                    std::sort(sorted_in_data.begin(), sorted_in_data.end());
-
-                    discretize(
-                        dfi->seed,
-                        discretization_id,
-                        v,
-                        dfi->divisions,
-                        raw_data->info.object_count,
-                        in_data,
-                        sorted_in_data,
-                        data + v * raw_data->info.object_count,
-                        dfi->range
-                    );
+                for (size_t i = omp_tidx; i < n_positions; i += omp_numthr) {
+                    const size_t v = variable_at(i);
+                    // mapped data is read ahead by one variable
+                    if (i + omp_numthr < n_positions) {
+                        raw_data->willNeed(variable_at(i + omp_numthr));
+                    }
+                    discretize_variable(raw_data, v, v, discretization_id, *dfi, cache, cache != nullptr ? &cache_keys[i] : nullptr,
+                                        column_buffer, owned_data + i * raw_data->info.object_count, timer);
+                    raw_data->doneWith(v);
+                    timer.lap(RunPhase::Discretize);
+
+                    if (progress != nullptr && omp_tidx == 0) {
+                        progress->poll();
+                    }
                 }
                 if (contrast_raw_data != nullptr) {
                     for (size_t i = omp_tidx; i < contrast_raw_data->info.variable_count; i += omp_numthr) {
                         const size_t v = i;
-                        const double* in_data = contrast_raw_data->getVariable(v);
-
-                        std::vector<double> sorted_in_data(in_data, in_data + contrast_raw_data->info.object_count);
-                        std::sort(sorted_in_data.begin(), sorted_in_data.end());
-
-                        discretize(
-                            dfi->seed,
-                            discretization_id,
-                            raw_data->info.variable_count + v, // offset to be backwards-compatible
-                            dfi->divisions,
-                            contrast_raw_data->info.object_count,
-                            in_data,
-                            sorted_in_data,
-                            contrast_data + v * contrast_raw_data->info.object_count,
-                            dfi->range
-                        );
+                        contrast_raw_data->willNeed(v + omp_numthr);
+                        DiscretizationCache::Key key;
+                        discretize_variable(contrast_raw_data, v,
+                                            raw_data->info.variable_count + v, // offset to be backwards-compatible
+                                            discretization_id, *dfi, cache, &key,
+                                            column_buffer, contrast_data + v * contrast_raw_data->info.object_count, timer);
+                        contrast_raw_data->doneWith(v);
+                        timer.lap(RunPhase::Discretize);
                     }
                 }
             } else {
                 // rewrite int to uint8_t
-                for (size_t i = omp_tidx; i < n_vars_to_discretize; i += omp_numthr) {
-                    const size_t v = mdfs_info.interesting_vars_count && mdfs_info.require_all_vars ?
-                                     mdfs_info.interesting_vars[i] :
-                                     i;
-                    const int* in_data = raw_data->getVariableI(v);
-                    uint8_t* data_current_var = data + v * raw_data->info.object_count;
-
-                    for (size_t i = 0; i < raw_data->info.object_count; i++) {
-                        data_current_var[i] = in_data[i];
-                    }
+                for (size_t i = omp_tidx; i < n_positions && owned_data != nullptr; i += omp_numthr) {
+                    copy_discrete_variable(raw_data, variable_at(i), owned_data + i * raw_data->info.object_count);
                 }
                 if (contrast_raw_data != nullptr) {
                     for (size_t i = omp_tidx; i < contrast_raw_data->info.variable_count; i += omp_numthr) {
                         const size_t v = i;
-                        const int* in_data = contrast_raw_data->getVariableI(v);
-                        uint8_t* data_current_var = contrast_data + v * contrast_raw_data->info.object_count;
-
-                        for (size_t i = 0; i < contrast_raw_data->info.object_count; i++) {
-                            data_current_var[i] = in_data[i];
-                        }
+                        copy_discrete_variable(contrast_raw_data, v, contrast_data + v * contrast_raw_data->info.object_count);
                     }
                 }
+                timer.lap(RunPhase::Discretize);
             }
 
             #ifdef _OPENMP
             #pragma omp barrier
             #endif
+            timer.lap(RunBarrier::Discretized);
+
+            if (mdfs_info.contrast_sources_count > 0) {
+                for (size_t i = omp_tidx; i < n_contrast_variables; i += omp_numthr) {
+                    const size_t v = mdfs_info.contrast_sources[i];
+                    const int* interesting_begin = mdfs_info.interesting_vars;
+                    const int* interesting_end = interesting_begin + mdfs_info.interesting_vars_count;
+                    const int* position = only_interesting ?
+                                          std::lower_bound(interesting_begin, interesting_end, int(v)) :
+                                          nullptr;
+                    const uint8_t* source_data = data + (only_interesting ? position - interesting_begin : v) * raw_data->info.object_count;
+
+                    // only the interesting variables are discretized when all are required
+                    if (only_interesting && (position == interesting_end || *position != int(v))) {
+                        source_buffer.resize(raw_data->info.object_count);
+                        if (dfi) {
+                            DiscretizationCache::Key key;
+                            discretize_variable(raw_data, v, v, discretization_id, *dfi, cache, &key,
+                                                column_buffer, source_buffer.data(), timer);
+                        } else {
+                            copy_discrete_variable(raw_data, v, source_buffer.data());
+                        }
+                        source_data = source_buffer.data();
+                    }
+
+                    permute_discretized(mdfs_info.contrast_seed, i, raw_data->info.object_count,
+                                        source_data, contrast_data + i * raw_data->info.object_count);
+                    timer.lap(RunPhase::Discretize);
+                }
+
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::Discretized);
+            }
 
             // optimised 2D version
             if (n_dimensions == 2 && mdfs_info.I_lower == nullptr) {
@@ -223,8 +417,15 @@ void scalarMDFS(
                 for (uint8_t i = 0; i < n_decision_classes; i++) {
                     mini_p[i] = p[i] * num_of_cubes_reduced;
                 }
-                for (size_t i = omp_tidx; i < raw_data->info.variable_count; i += omp_numthr) {
-                    count_counters<n_decision_classes, 1, false>(data, nullptr, decision, raw_data->info.object_count, 0, &i, 0, mini_counters, n_classes, mini_p, nullptr);
+                const uint64_t cache_context = cache != nullptr ?
+                    DiscretizationCache::hashContext(decision, raw_data->info.object_count, mini_p, n_decision_classes) :
+                    0;
+                for (size_t i = omp_tidx; i < n_positions; i += omp_numthr) {
+                    if (cache != nullptr && cache->findLowerEntropy(cache_keys[i], cache_context, H[i])) {
+                        continue;
+                    }
+                    count_counters<n_decision_classes, 1, false>(data, nullptr, decision, raw_data->info.object_count, 0, &i, 0, mini_counters, exact_counters, n_classes, mini_p, nullptr, weights, sparse, packed);
+                    timer.lap(RunPhase::Count);
                     if (n_decision_classes == 1) {
                         // H(X_i) (plain) entropy of the current var
                         H[i] = entropy(total_counters, n_classes, mini_counters);
@@ -232,48 +433,188 @@ void scalarMDFS(
                         // H(Y|X_i) conditional entropy of decision given the current var
                         H[i] = conditional_entropy<n_decision_classes>(n_classes, mini_counters);
                     }
+                    if (cache != nullptr) {
+                        cache->insertLowerEntropy(cache_keys[i], cache_context, H[i]);
+                    }
+                    timer.lap(RunPhase::Entropy);
                 }
                 delete[] mini_counters;
 
                 #ifdef _OPENMP
                 #pragma omp barrier
                 #endif
+                timer.lap(RunBarrier::LowerEntropies);
             }
 
-            generator.reset();
-            subgenerator.reset();
+            if (!H_pairs.empty()) {
+                float* pair_counters = new float[n_decision_classes * n_classes * n_classes];
+                // to match counting in 3D
+                float pair_p[n_decision_classes];
+                for (uint8_t i = 0; i < n_decision_classes; i++) {
+                    pair_p[i] = p[i] * n_classes;
+                }
+                size_t pair[2];
+                for (pair[1] = 1 + omp_tidx; pair[1] < n_positions; pair[1] += omp_numthr) {
+                    for (pair[0] = 0; pair[0] < pair[1]; pair[0]++) {
+                        count_counters<n_decision_classes, 2, false>(data, nullptr, decision, raw_data->info.object_count, n_classes, pair, 0, pair_counters, exact_counters, n_classes * n_classes, pair_p, d, weights, sparse, packed);
+                        timer.lap(RunPhase::Count);
+                        // H(Y|X_i,X_j) conditional entropy of decision given the pair
+                        H_pairs[pair_index(pair[0], pair[1])] = conditional_entropy<n_decision_classes>(n_classes * n_classes, pair_counters);
+                        timer.lap(RunPhase::Entropy);
+                    }
+
+                    if (progress != nullptr) {
+                        progress->add(pair[1]);
+                        if (omp_tidx == 0) {
+                            progress->poll();
+                        }
+                    }
+                }
+                delete[] pair_counters;
 
-            do {
                 #ifdef _OPENMP
-                int consumed_i = 0;
-                for (; consumed_i < omp_numthr; consumed_i++) {
-                    if (!generator.hasNext()) {
-                        break;
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::LowerEntropies);
+            }
+            lower_memo.clear();
+
+            if (seed_max_igs) {
+                const float* H_rank = H;
+                if (n_dimensions > 2) {
+                    float* mini_counters = new float[n_decision_classes * n_classes];
+                    for (size_t i = omp_tidx; i < n_positions; i += omp_numthr) {
+                        count_counters<n_decision_classes, 1, false>(data, nullptr, decision, raw_data->info.object_count, 0, &i, 0, mini_counters, exact_counters, n_classes, p, nullptr, weights, sparse, packed);
+                        timer.lap(RunPhase::Count);
+                        H_single[i] = conditional_entropy<n_decision_classes>(n_classes, mini_counters);
+                        timer.lap(RunPhase::Entropy);
                     }
-                    if (consumed_i == omp_tidx) {
-                        generator.next(tuple);
-                    } else {
-                        generator.skip();
+                    delete[] mini_counters;
+
+                    #ifdef _OPENMP
+                    #pragma omp barrier
+                    #endif
+                    timer.lap(RunBarrier::LowerEntropies);
+                    H_rank = H_single.data();
+                }
+
+                // the most informative first (NaN last), n_dimensions + 1 of them complete any tuple
+                auto more_informative = [&](size_t a, size_t b) {
+                    const float H_a = std::isnan(H_rank[a]) ? std::numeric_limits<float>::infinity() : H_rank[a];
+                    const float H_b = std::isnan(H_rank[b]) ? std::numeric_limits<float>::infinity() : H_rank[b];
+                    return H_a < H_b || (H_a == H_b && a < b);
+                };
+                std::vector<size_t> best(n_positions);
+                std::iota(best.begin(), best.end(), size_t(0));
+                const size_t n_best = std::min<size_t>(n_positions, n_dimensions + 1);
+                std::partial_sort(best.begin(), best.begin() + n_best, best.end(), more_informative);
+
+                const int* interesting_begin = generated_interesting_vars;
+                const int* interesting_end = interesting_begin + generated_interesting_vars_count;
+                size_t best_interesting = 0;
+                if (generated_interesting_vars_count > 0) {
+                    best_interesting = *std::min_element(interesting_begin, interesting_end, more_informative);
+                }
+
+                for (size_t i = omp_tidx; i < n_positions; i += omp_numthr) {
+                    seed_igs[i] = -std::numeric_limits<float>::infinity();
+
+                    size_t seed_tuple[n_dimensions];
+                    size_t n = 0;
+                    seed_tuple[n++] = i;
+                    // only such tuples are generated
+                    if (generated_interesting_vars_count > 0 && !std::binary_search(interesting_begin, interesting_end, int(i))) {
+                        seed_tuple[n++] = best_interesting;
                     }
+                    for (size_t b = 0; b < n_best && n < n_dimensions; ++b) {
+                        if (std::find(seed_tuple, seed_tuple + n, best[b]) == seed_tuple + n) {
+                            seed_tuple[n++] = best[b];
+                        }
+                    }
+                    if (n < n_dimensions) {
+                        continue;
+                    }
+                    std::sort(seed_tuple, seed_tuple + n_dimensions);
+
+                    float* seed_H_except = nullptr;
+                    if (!H_pairs.empty()) {
+                        pairs_H_except(seed_tuple, H_except);
+                        seed_H_except = H_except;
+                    }
+                    process_tuple<n_decision_classes, n_dimensions, stat_mode>(
+                        data,
+                        decision,
+                        raw_data->info.object_count,
+                        weights,
+                        sparse,
+                        packed,
+                        n_classes,
+                        seed_tuple,
+                        counters, exact_counters, reduced,
+                        num_of_cubes, num_of_cubes_reduced,
+                        p,
+                        total_counters,
+                        d,
+                        H_Y,
+                        H,
+                        igs,
+                        timer,
+                        seed_H_except);
+                    timer.lap(RunPhase::Entropy);
+                    seed_igs[i] = igs[std::find(seed_tuple, seed_tuple + n_dimensions, i) - seed_tuple];
                 }
-                if (consumed_i <= omp_tidx) { // no tuple is available anymore
+
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::LowerEntropies);
+            }
+
+            generator.reset(thread_first_tuple, thread_last_tuple);
+            subgenerator.reset();
+
+            do {
+                if (!generator.hasNext()) {
                     break;
                 }
-                #else
-                if (!generator.hasNext()) {
+                generator.next(local_tuple);
+
+                for (size_t k = 0; k < n_dimensions; ++k) {
+                    tuple[k] = variable_at(local_tuple[k]);
+                }
+
+                if (progress != nullptr && progress->step(progress_pending, 1, omp_tidx == 0)) {
                     break;
                 }
-                generator.next(tuple);
-                #endif
 
-                if (mdfs_info.interesting_vars_count && !mdfs_info.require_all_vars) {
-                    std::list<int> current_interesting_vars;
-                    std::set_intersection(
-                        tuple, tuple+n_dimensions,
-                        mdfs_info.interesting_vars, mdfs_info.interesting_vars + mdfs_info.interesting_vars_count,
-                        std::back_inserter(current_interesting_vars));
+                float* tuple_H_except = nullptr;
+                bool lower_memo_complete = true;
+                if (!H_pairs.empty()) {
+                    pairs_H_except(local_tuple, H_except);
+                    tuple_H_except = H_except;
+                } else if (use_lower_memo) {
+                    lower_memo_complete = lower_memo.find(local_tuple, H_except);
+                    tuple_H_except = H_except;
+                }
 
-                    if (current_interesting_vars.empty()) {
+                if (prune && (n_dimensions == 2 || (tuple_H_except != nullptr && lower_memo_complete))) {
+                    bool cannot_change = true;
+                    for (size_t k = 0; k < n_dimensions && cannot_change; ++k) {
+                        const float bound = n_dimensions == 2 ? H[local_tuple[1 - k]] : H_except[k];
+                        if (out.type == MDFSOutputType::MaxIGs) {
+                            // max IGs (of the discretization when those are kept) are replaced only
+                            // by greater IGs, the seeds are reached by some tuple of the discretization
+                            const float known_max_ig = known_out->discretization_max_igs != nullptr
+                                ? known_out->discretization_max_igs[discretization_id * known_out->n_variables + tuple[k]]
+                                : (*known_out->max_igs)[tuple[k]];
+                            cannot_change = bound <= known_max_ig
+                                            || (seed_max_igs && bound < seed_igs[local_tuple[k]]);
+                        } else {
+                            cannot_change = bound <= ig_thr;
+                        }
+                    }
+                    if (cannot_change) {
+                        thread_stats.tuples_pruned++;
                         continue;
                     }
                 }
@@ -282,16 +623,26 @@ void scalarMDFS(
                     data,
                     decision,
                     raw_data->info.object_count,
+                    weights,
+                    sparse,
+                    packed,
                     n_classes,
-                    tuple,
-                    counters, reduced,
+                    local_tuple,
+                    counters, exact_counters, reduced,
                     num_of_cubes, num_of_cubes_reduced,
                     p,
                     total_counters,
                     d,
                     H_Y,
                     H,
-                    igs);
+                    igs,
+                    timer,
+                    tuple_H_except);
+                if (!lower_memo_complete) {
+                    lower_memo.insert(local_tuple, H_except);
+                }
+                timer.lap(RunPhase::Entropy);
+                thread_stats.tuples_evaluated++;
 
                 switch (out.type) {
                     case MDFSOutputType::MaxIGs:
@@ -321,30 +672,28 @@ void scalarMDFS(
                         }
                         break;
                 }
+                timer.lap(RunPhase::Merge);
             } while (true);
 
-            if (contrast_raw_data != nullptr) {
+            if (n_contrast_variables > 0) {
+                // contrast variables handled by this thread for each subtuple
+                const size_t thread_contrast_count = n_contrast_variables > size_t(omp_tidx) ?
+                    (n_contrast_variables - omp_tidx + omp_numthr - 1) / omp_numthr :
+                    0;
+
                 do {
                     if (!subgenerator.hasNext()) {
                         break;
                     }
                     subgenerator.next(subtuple);
 
-                    if (mdfs_info.interesting_vars_count && !mdfs_info.require_all_vars) {
-                        std::list<int> current_interesting_vars;
-                        std::set_intersection(
-                            subtuple, subtuple+(n_dimensions-1),
-                            mdfs_info.interesting_vars, mdfs_info.interesting_vars + mdfs_info.interesting_vars_count,
-                            std::back_inserter(current_interesting_vars));
-
-                        if (current_interesting_vars.empty()) {
-                            continue;
-                        }
+                    if (progress != nullptr && progress->step(progress_pending, thread_contrast_count, omp_tidx == 0)) {
+                        break;
                     }
 
                     float contrast_ig;
 
-                    for (size_t contrast_idx = omp_tidx; contrast_idx < contrast_raw_data->info.variable_count; contrast_idx += omp_numthr) {
+                    for (size_t contrast_idx = omp_tidx; contrast_idx < n_contrast_variables; contrast_idx += omp_numthr) {
                         // n_decision_classes == 2
                         // n_dimensions >= 2 && I_lower == nullptr
                         process_subtuple<n_decision_classes, n_dimensions-1>(
@@ -352,10 +701,11 @@ void scalarMDFS(
                             contrast_data,
                             decision,
                             raw_data->info.object_count,
+                            weights,
                             n_classes,
                             subtuple,
                             contrast_idx,
-                            counters, reduced,
+                            counters, exact_counters, reduced,
                             num_of_cubes, num_of_cubes_reduced,
                             p,
                             d,
@@ -367,9 +717,16 @@ void scalarMDFS(
                         #else
                         out.updateContrastMaxIG(contrast_idx, contrast_ig, discretization_id);
                         #endif
+                        timer.lap(RunPhase::Contrast);
+                        thread_stats.contrast_pairs++;
                     }
                 } while (true);
             }
+
+            if (progress != nullptr) {
+                progress->add(progress_pending);
+                progress_pending = 0;
+            }
         }
 
         #ifdef _OPENMP
@@ -395,26 +752,39 @@ void scalarMDFS(
                     }
                 }
             }
-            if (contrast_raw_data != nullptr) {
+            if (n_contrast_variables > 0) {
                 #pragma omp critical (SetContrastOutput)
-                for (size_t i = 0; i < contrast_raw_data->info.variable_count; i += 1) {
+                for (size_t i = 0; i < n_contrast_variables; i += 1) {
                     if ((*thread_out->contrast_max_igs)[i] > (*out.contrast_max_igs)[i]) {
                         (*out.contrast_max_igs)[i] = (*thread_out->contrast_max_igs)[i];
                     }
                 }
             }
+            if (out.discretization_max_igs != nullptr) {
+                #pragma omp critical (SetDiscretizationOutput)
+                out.mergeDiscretizationMaxIGs(thread_out->discretization_max_igs);
+                delete[] thread_out->discretization_max_igs;
+            }
             delete thread_out;
+            timer.lap(RunPhase::Merge);
         }
         #endif
 
+        if (out.run_stats != nullptr) {
+            out.run_stats->threads[omp_tidx] = thread_stats;
+        }
+
         delete[] reduced;
+        delete[] exact_counters;
         delete[] counters;
     }
 
-    if (contrast_raw_data != nullptr) {
-        delete[] contrast_data;
+    if (progress != nullptr) {
+        progress->finish();
     }
-    delete[] data;
+
+    delete[] contrast_data;
+    delete[] owned_data;
     if (n_dimensions == 2) {
         delete[] H;
     }
@@ -426,6 +796,13 @@ void scalarMDFS(
             (*out.all_tuples)[i] /= mdfs_info.discretizations;
         }
     }
+
+    if (out.run_stats != nullptr) {
+        #ifdef _OPENMP
+        out.run_stats->threads.resize(run_numthr);
+        #endif
+        out.run_stats->wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+    }
 }
 
 typedef void (*MdfsImpl) (
@@ -445,6 +822,52 @@ const MdfsImpl mdfs[5] = {
     scalarMDFS<2, 5, StatMode::MutualInformation>,
 };
 
+// as above, with decision of 3 to 8 classes (by the number of classes)
+const MdfsImpl mdfsMultiClass[6][5] = {
+    {
+        scalarMDFS<3, 1, StatMode::MutualInformation>,
+        scalarMDFS<3, 2, StatMode::MutualInformation>,
+        scalarMDFS<3, 3, StatMode::MutualInformation>,
+        scalarMDFS<3, 4, StatMode::MutualInformation>,
+        scalarMDFS<3, 5, StatMode::MutualInformation>,
+    },
+    {
+        scalarMDFS<4, 1, StatMode::MutualInformation>,
+        scalarMDFS<4, 2, StatMode::MutualInformation>,
+        scalarMDFS<4, 3, StatMode::MutualInformation>,
+        scalarMDFS<4, 4, StatMode::MutualInformation>,
+        scalarMDFS<4, 5, StatMode::MutualInformation>,
+    },
+    {
+        scalarMDFS<5, 1, StatMode::MutualInformation>,
+        scalarMDFS<5, 2, StatMode::MutualInformation>,
+        scalarMDFS<5, 3, StatMode::MutualInformation>,
+        scalarMDFS<5, 4, StatMode::MutualInformation>,
+        scalarMDFS<5, 5, StatMode::MutualInformation>,
+    },
+    {
+        scalarMDFS<6, 1, StatMode::MutualInformation>,
+        scalarMDFS<6, 2, StatMode::MutualInformation>,
+        scalarMDFS<6, 3, StatMode::MutualInformation>,
+        scalarMDFS<6, 4, StatMode::MutualInformation>,
+        scalarMDFS<6, 5, StatMode::MutualInformation>,
+    },
+    {
+        scalarMDFS<7, 1, StatMode::MutualInformation>,
+        scalarMDFS<7, 2, StatMode::MutualInformation>,
+        scalarMDFS<7, 3, StatMode::MutualInformation>,
+        scalarMDFS<7, 4, StatMode::MutualInformation>,
+        scalarMDFS<7, 5, StatMode::MutualInformation>,
+    },
+    {
+        scalarMDFS<8, 1, StatMode::MutualInformation>,
+        scalarMDFS<8, 2, StatMode::MutualInformation>,
+        scalarMDFS<8, 3, StatMode::MutualInformation>,
+        scalarMDFS<8, 4, StatMode::MutualInformation>,
+        scalarMDFS<8, 5, StatMode::MutualInformation>,
+    },
+};
+
 // entropy of decision (conditional on variables)
 const MdfsImpl mdfsDecisionConditionalEntropy[5] = {
     scalarMDFS<2, 1, StatMode::Entropy>,
@@ -4,11 +4,245 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <limits>
+#include <vector>
 
+#include "bed_file.h"
 
-// only 1 and 2 decision classes are supported
-template <uint8_t n_decision_classes, uint8_t n_dimensions, bool with_contrast>
-inline void count_counters(
+
+// discrete data in compressed sparse columns (by position) so that only the
+// cells other than 0 are visited in counting, the cube of all zeros of each
+// decision class is what is left of its total
+class SparseColumns {
+public:
+    std::vector<const int*> objects;  // ascending
+    std::vector<const int*> values;
+    std::vector<size_t> sizes;
+    std::vector<uint64_t> class_totals;  // of the weights, one with no decision
+};
+
+template <uint8_t n_decision_classes, uint8_t n_dimensions, typename count_t>
+inline void count_sparse_counters(
+    const SparseColumns& sparse,
+    const uint8_t *decision,
+    const size_t n_classes,
+    const size_t* tuple,
+    count_t* counters,
+    const size_t n_cubes,
+    const size_t* d,
+    const int* weights
+) {
+    size_t at[n_dimensions > 0 ? n_dimensions : 1];
+    size_t strides[n_dimensions > 0 ? n_dimensions : 1];
+    for (size_t k = 0; k < n_dimensions; ++k) {
+        at[k] = 0;
+        strides[k] = k == 0 ? 1 : k == 1 ? n_classes : d[k-2];
+    }
+
+    // merge the objects of the variables, each one with a cell other than 0 once
+    while (true) {
+        int o = std::numeric_limits<int>::max();
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            if (at[k] < sparse.sizes[tuple[k]] && sparse.objects[tuple[k]][at[k]] < o) {
+                o = sparse.objects[tuple[k]][at[k]];
+            }
+        }
+        if (o == std::numeric_limits<int>::max()) {
+            break;
+        }
+
+        size_t bucket = 0;
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            if (at[k] < sparse.sizes[tuple[k]] && sparse.objects[tuple[k]][at[k]] == o) {
+                bucket += strides[k] * sparse.values[tuple[k]][at[k]];
+                at[k]++;
+            }
+        }
+
+        const count_t weight = weights != nullptr ? weights[o] : 1;
+        if (n_decision_classes > 1) {
+            counters[decision[o] * n_cubes + bucket] += weight;
+        } else {
+            counters[bucket] += weight;
+        }
+    }
+
+    for (uint8_t k = 0; k < n_decision_classes; ++k) {
+        count_t zeros = sparse.class_totals[k];
+        for (size_t c = 1; c < n_cubes; ++c) {
+            zeros -= counters[k * n_cubes + c];
+        }
+        counters[k * n_cubes] = zeros;
+    }
+}
+
+// bits of the genotypes 1 and 2 of 64 objects (block b) of a packed column;
+// the bits of the objects of the first 32 are even, of the other 32 odd
+inline void packed_genotype_planes(const uint8_t* column, size_t column_bytes, size_t b, uint64_t& ones, uint64_t& twos) {
+    uint8_t tail[16] = {};
+    const uint8_t* bytes = column + 16 * b;
+    if (16 * b + 16 > column_bytes) {
+        std::memcpy(tail, bytes, column_bytes - 16 * b);
+        bytes = tail;
+    }
+    uint64_t words[2] = {0, 0};
+    for (size_t i = 0; i < 16; ++i) {
+        words[i / 8] |= uint64_t(bytes[i]) << (8 * (i % 8));
+    }
+
+    ones = 0;
+    twos = 0;
+    for (size_t i = 0; i < 2; ++i) {
+        const uint64_t low = words[i] & 0x5555555555555555ULL;
+        const uint64_t high = (words[i] >> 1) & 0x5555555555555555ULL;
+        ones |= (high & ~low) << i;
+        twos |= (high & low) << i;
+    }
+}
+
+// x86 without the popcnt instruction gets a library call for the builtin
+inline int popcount64(uint64_t x) {
+    #if (defined(__GNUC__) || defined(__clang__)) && (defined(__POPCNT__) || !(defined(__x86_64__) || defined(__i386__)))
+    return __builtin_popcountll(x);
+    #else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+    #endif
+}
+
+// genotypes packed 2 bits each (by position, see bed_file.h) counted 64
+// objects at once with popcounts in 1D and 2D, only of the genotypes 1 and 2
+// (the counters of 0 are what is left of the totals); otherwise (or when
+// weighted) object by object
+class PackedGenotypes {
+public:
+    std::vector<const uint8_t*> columns;
+    size_t column_bytes = 0;
+    size_t n_blocks = 0;  // of 64 objects
+    // bits of the objects of each decision class, as in packed_genotype_planes
+    std::vector<std::vector<uint64_t>> class_masks;
+    std::vector<uint64_t> class_totals;
+    // objects of the genotypes 1 and 2 of each position in each class
+    std::vector<uint64_t> genotype_counts;
+
+    // decision is nullptr with 1 decision class
+    void prepare(const uint8_t* decision, size_t n_decision_classes, size_t n_objects) {
+        this->column_bytes = packed_genotype_bytes(n_objects);
+        this->n_blocks = (n_objects + 63) / 64;
+        this->class_masks.assign(n_decision_classes, std::vector<uint64_t>(this->n_blocks, 0));
+        this->class_totals.assign(n_decision_classes, 0);
+        for (size_t o = 0; o < n_objects; ++o) {
+            const size_t k = decision != nullptr ? decision[o] : 0;
+            const size_t bit = o % 64 < 32 ? 2 * (o % 64) : 2 * (o % 64 - 32) + 1;
+            this->class_masks[k][o / 64] |= uint64_t(1) << bit;
+            this->class_totals[k]++;
+        }
+
+        this->genotype_counts.assign(this->columns.size() * n_decision_classes * 2, 0);
+        for (size_t i = 0; i < this->columns.size(); ++i) {
+            uint64_t* counts = &this->genotype_counts[i * n_decision_classes * 2];
+            for (size_t b = 0; b < this->n_blocks; ++b) {
+                uint64_t ones, twos;
+                packed_genotype_planes(this->columns[i], this->column_bytes, b, ones, twos);
+                for (size_t k = 0; k < n_decision_classes; ++k) {
+                    counts[2 * k] += popcount64(ones & this->class_masks[k][b]);
+                    counts[2 * k + 1] += popcount64(twos & this->class_masks[k][b]);
+                }
+            }
+        }
+    }
+};
+
+template <uint8_t n_decision_classes, uint8_t n_dimensions, typename count_t>
+inline void count_packed_counters(
+    const PackedGenotypes& packed,
+    const uint8_t *decision,
+    const size_t n_objects,
+    const size_t n_classes,
+    const size_t* tuple,
+    count_t* counters,
+    const size_t n_cubes,
+    const size_t* d,
+    const int* weights
+) {
+    if (n_dimensions == 1 && weights == nullptr) {
+        const uint64_t* counts = &packed.genotype_counts[tuple[0] * n_decision_classes * 2];
+        for (uint8_t k = 0; k < n_decision_classes; ++k) {
+            counters[k * n_cubes + 1] = counts[2 * k];
+            counters[k * n_cubes + 2] = counts[2 * k + 1];
+            counters[k * n_cubes] = packed.class_totals[k] - counts[2 * k] - counts[2 * k + 1];
+        }
+        return;
+    }
+
+    if (n_dimensions == 2 && weights == nullptr) {
+        // of the genotypes (1, 1), (2, 1), (1, 2) and (2, 2)
+        uint64_t counts[n_decision_classes][4] = {};
+        for (size_t b = 0; b < packed.n_blocks; ++b) {
+            uint64_t ones[2], twos[2];
+            packed_genotype_planes(packed.columns[tuple[0]], packed.column_bytes, b, ones[0], twos[0]);
+            packed_genotype_planes(packed.columns[tuple[1]], packed.column_bytes, b, ones[1], twos[1]);
+            for (uint8_t k = 0; k < n_decision_classes; ++k) {
+                const uint64_t class_mask = packed.class_masks[k][b];
+                const uint64_t ones_0 = ones[0] & class_mask;
+                const uint64_t twos_0 = twos[0] & class_mask;
+                counts[k][0] += popcount64(ones_0 & ones[1]);
+                counts[k][1] += popcount64(twos_0 & ones[1]);
+                counts[k][2] += popcount64(ones_0 & twos[1]);
+                counts[k][3] += popcount64(twos_0 & twos[1]);
+            }
+        }
+
+        const uint64_t* counts_0 = &packed.genotype_counts[tuple[0] * n_decision_classes * 2];
+        const uint64_t* counts_1 = &packed.genotype_counts[tuple[1] * n_decision_classes * 2];
+        for (uint8_t k = 0; k < n_decision_classes; ++k) {
+            count_t* class_counters = counters + k * n_cubes;
+            uint64_t rest = packed.class_totals[k];
+            for (size_t a = 1; a <= 2; ++a) {
+                for (size_t b = 1; b <= 2; ++b) {
+                    const uint64_t count = counts[k][(a - 1) + 2 * (b - 1)];
+                    class_counters[a + n_classes * b] = count;
+                    rest -= count;
+                }
+            }
+            for (size_t a = 1; a <= 2; ++a) {
+                // the other one is 0
+                const uint64_t a_0 = counts_0[2 * k + a - 1] - counts[k][(a - 1)] - counts[k][(a - 1) + 2];
+                const uint64_t b_0 = counts_1[2 * k + a - 1] - counts[k][2 * (a - 1)] - counts[k][2 * (a - 1) + 1];
+                class_counters[a] = a_0;
+                class_counters[n_classes * a] = b_0;
+                rest -= a_0 + b_0;
+            }
+            class_counters[0] = rest;
+        }
+        return;
+    }
+
+    size_t strides[n_dimensions > 0 ? n_dimensions : 1];
+    for (size_t k = 0; k < n_dimensions; ++k) {
+        strides[k] = k == 0 ? 1 : k == 1 ? n_classes : d[k-2];
+    }
+    for (size_t o = 0; o < n_objects; ++o) {
+        size_t bucket = 0;
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            bucket += strides[k] * packed_genotype(packed.columns[tuple[k]], o);
+        }
+        const count_t weight = weights != nullptr ? weights[o] : 1;
+        if (n_decision_classes > 1) {
+            counters[decision[o] * n_cubes + bucket] += weight;
+        } else {
+            counters[bucket] += weight;
+        }
+    }
+}
+
+// adds the counts of the objects [first, last) to the counters (of each
+// decision class after those of the previous one); weights are the
+// multiplicities of the objects (nullptr - 1 each)
+template <uint8_t n_decision_classes, uint8_t n_dimensions, bool with_contrast, typename count_t>
+inline void add_counts(
     const uint8_t *data,
     const uint8_t *contrast_data,
     const uint8_t *decision,
@@ -18,15 +252,16 @@ inline void count_counters(
     const size_t* tuple,
     const size_t contrast_idx,
 
-    float* counters,
+    count_t* counters,
     const size_t n_cubes,
 
-    const float p[n_decision_classes],
-    const size_t* d
-) {
-    std::memset(counters, 0, sizeof(float) * n_cubes * n_decision_classes);
+    const size_t* d,
 
-    for (size_t o = 0; o < n_objects; ++o) {
+    const int* weights,
+    const size_t first,
+    const size_t last
+) {
+    auto counter_of = [&](size_t o) -> count_t& {
         size_t bucket = 0;
         if (n_dimensions >= 1) {
             bucket += data[tuple[0] * n_objects + o];
@@ -55,18 +290,111 @@ inline void count_counters(
 
         if (n_decision_classes > 1) {
             size_t dec = decision[o];
-            counters[dec * n_cubes + bucket] += 1.0f;
+            return counters[dec * n_cubes + bucket];
         } else {
-            counters[bucket] += 1.0f;
+            return counters[bucket];
+        }
+    };
+
+    if (weights == nullptr) {
+        for (size_t o = first; o < last; ++o) {
+            counter_of(o) += 1;
+        }
+    } else {
+        for (size_t o = first; o < last; ++o) {
+            counter_of(o) += weights[o];
         }
     }
+}
 
-    for (size_t c = 0; c < n_cubes; ++c) {
-        counters[c] += p[0];
-        if (n_decision_classes > 1) {
-            counters[n_cubes + c] += p[1];
+template <uint8_t n_decision_classes>
+inline void add_pseudocounts(float* counters, const size_t n_cubes, const float p[n_decision_classes]) {
+    for (uint8_t k = 0; k < n_decision_classes; ++k) {
+        for (size_t c = 0; c < n_cubes; ++c) {
+            counters[k * n_cubes + c] += p[k];
         }
     }
 }
 
+// float counters hold the counts of objects exactly only up to 2^24
+// (of their total weight when weighted)
+constexpr size_t float_exact_objects = size_t(1) << 24;
+
+// counts the objects into zeroed counters, see count_counters
+template <uint8_t n_decision_classes, uint8_t n_dimensions, bool with_contrast, typename count_t>
+inline void count_objects(
+    const uint8_t *data,
+    const uint8_t *contrast_data,
+    const uint8_t *decision,
+    const size_t n_objects,
+    const size_t n_classes,
+    const size_t* tuple,
+    const size_t contrast_idx,
+    count_t* counters,
+    const size_t n_cubes,
+    const size_t* d,
+    const int* weights,
+    const SparseColumns* sparse,
+    const PackedGenotypes* packed
+) {
+    if (!with_contrast && sparse != nullptr) {
+        count_sparse_counters<n_decision_classes, n_dimensions>(
+            *sparse, decision, n_classes, tuple, counters, n_cubes, d, weights);
+    } else if (!with_contrast && packed != nullptr) {
+        count_packed_counters<n_decision_classes, n_dimensions>(
+            *packed, decision, n_objects, n_classes, tuple, counters, n_cubes, d, weights);
+    } else {
+        add_counts<n_decision_classes, n_dimensions, with_contrast>(
+            data, contrast_data, decision, n_objects, n_classes, tuple, contrast_idx,
+            counters, n_cubes, d, weights, 0, n_objects);
+    }
+}
+
+// counters of each decision class follow those of the previous one;
+// weights are the multiplicities of the objects (nullptr - 1 each);
+// data is not used when sparse or packed is set (not with contrast);
+// beyond float_exact_objects the objects are counted in integers into
+// exact_counters (as many as counters, kept by the caller) and the exact
+// counts are rounded only once, to float; exact_counters is nullptr when
+// float counting is exact
+template <uint8_t n_decision_classes, uint8_t n_dimensions, bool with_contrast>
+inline void count_counters(
+    const uint8_t *data,
+    const uint8_t *contrast_data,
+    const uint8_t *decision,
+    const size_t n_objects,
+    const size_t n_classes,
+
+    const size_t* tuple,
+    const size_t contrast_idx,
+
+    float* counters,
+    uint64_t* exact_counters,
+    const size_t n_cubes,
+
+    const float p[n_decision_classes],
+    const size_t* d,
+
+    const int* weights = nullptr,
+    const SparseColumns* sparse = nullptr,
+    const PackedGenotypes* packed = nullptr
+) {
+    if (exact_counters == nullptr) {
+        std::memset(counters, 0, sizeof(float) * n_cubes * n_decision_classes);
+        count_objects<n_decision_classes, n_dimensions, with_contrast>(
+            data, contrast_data, decision, n_objects, n_classes, tuple, contrast_idx,
+            counters, n_cubes, d, weights, sparse, packed);
+    } else {
+        std::memset(exact_counters, 0, sizeof(uint64_t) * n_cubes * n_decision_classes);
+        count_objects<n_decision_classes, n_dimensions, with_contrast>(
+            data, contrast_data, decision, n_objects, n_classes, tuple, contrast_idx,
+            exact_counters, n_cubes, d, weights, sparse, packed);
+        for (size_t c = 0; c < n_cubes * n_decision_classes; ++c) {
+            counters[c] = exact_counters[c];
+        }
+    }
+
+    add_pseudocounts<n_decision_classes>(counters, n_cubes, p);
+}
+
 #endif
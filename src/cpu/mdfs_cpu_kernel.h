@@ -1,6 +1,7 @@
 #ifndef MDFS_CPU_KERNEL_H
 #define MDFS_CPU_KERNEL_H
 
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -8,37 +9,35 @@
 #include "entropy.h"
 #include "mdfs_count_counters.h"
 #include "mdfs_reduce_counters.h"
+#include "run_stats.h"
 
 enum StatMode { Entropy, MutualInformation, VariationOfInformation };
 
-// only 1 and 2 decision classes are supported
+// IGs (or the other statistic) of a tuple from its counters, with pseudocounts;
+// 1 means no decision
 template <uint8_t n_decision_classes, uint8_t n_dimensions, StatMode stat_mode>
-inline void process_tuple(
-    const uint8_t *data,
-    const uint8_t *decision,
-    const size_t n_objects,
+inline void tuple_igs(
+    const float* counters,
+    float* counters_reduced,
     const size_t n_classes,
 
     const size_t* tuple,
 
-    float* counters,
-    float* counters_reduced,
     const size_t n_cubes,
     const size_t n_cubes_reduced,
 
-    const float p[n_decision_classes],
     const float total,  // total of all counters; used only in no decision mode
-    const size_t* d,
 
     const float H_Y,  // H(Y) (plain) entropy of decision
 
     const float* H,  // decisionless -> entropies of single variables
                      // decisionful  -> entropies of decision conditioned on single variables
 
-    float igs[n_dimensions]
-) {
-    count_counters<n_decision_classes, n_dimensions, false>(data, nullptr, decision, n_objects, n_classes, tuple, 0, counters, n_cubes, p, d);
+    float igs[n_dimensions],
 
+    float* H_except = nullptr  // optional (3D+ decisionful IG), H(Y|{X_i!=X_k}) for each k - NaN is
+                               // computed from the counters and set, others are used as given
+) {
     // H(Y|{X_i}) conditional entropy of decision given all tuple vars
     float H_Y_given_all = 0.0f;
     if (n_decision_classes > 1) {
@@ -123,32 +122,83 @@ inline void process_tuple(
     // only information gain (IG) is supported beyond this point
 
     for (size_t v = 0, stride = 1; v < n_dimensions; ++v, stride *= n_classes) {
+        if (n_decision_classes > 1 && H_except != nullptr && !std::isnan(H_except[v])) {
+            igs[v] = H_except[v] - H_Y_given_all;
+            continue;
+        }
         std::memset(counters_reduced, 0, sizeof(float) * n_cubes_reduced * n_decision_classes);
-        reduce_counters(n_classes, n_cubes, counters, counters_reduced, stride);
+        for (uint8_t k = 0; k < n_decision_classes; ++k) {
+            reduce_counters(n_classes, n_cubes, counters + k * n_cubes, counters_reduced + k * n_cubes_reduced, stride);
+        }
         if (n_decision_classes > 1) {
-            reduce_counters(n_classes, n_cubes, counters + n_cubes, counters_reduced + n_cubes_reduced, stride);
             // H(Y|{X_i!=X_k}) conditional entropy of decision given all tuple vars except the current one (X_k)
             float H_Y_given_all_except_current = conditional_entropy<n_decision_classes>(n_cubes_reduced, counters_reduced);
             // only one value type can be computed here
             // I(Y;X_k | {X_i!=X_k}) mutual information of decision and the current var given all the other tuple vars
             igs[v] = H_Y_given_all_except_current - H_Y_given_all;
+            if (H_except != nullptr) {
+                H_except[v] = H_Y_given_all_except_current;
+            }
         }
     }
 }
 
-// only 2 decision classes are supported
+// 1 means no decision
+template <uint8_t n_decision_classes, uint8_t n_dimensions, StatMode stat_mode>
+inline void process_tuple(
+    const uint8_t *data,
+    const uint8_t *decision,
+    const size_t n_objects,
+    const int* weights,  // multiplicities of the objects (nullptr - 1 each)
+    const SparseColumns* sparse,  // instead of data when set
+    const PackedGenotypes* packed,  // as well
+    const size_t n_classes,
+
+    const size_t* tuple,
+
+    float* counters,
+    uint64_t* exact_counters,  // see count_counters
+    float* counters_reduced,
+    const size_t n_cubes,
+    const size_t n_cubes_reduced,
+
+    const float p[n_decision_classes],
+    const float total,  // total of all counters; used only in no decision mode
+    const size_t* d,
+
+    const float H_Y,  // H(Y) (plain) entropy of decision
+
+    const float* H,  // decisionless -> entropies of single variables
+                     // decisionful  -> entropies of decision conditioned on single variables
+
+    float igs[n_dimensions],
+
+    PhaseTimer& timer,  // the caller attributes the rest to entropy
+
+    float* H_except = nullptr  // as in tuple_igs
+) {
+    count_counters<n_decision_classes, n_dimensions, false>(data, nullptr, decision, n_objects, n_classes, tuple, 0, counters, exact_counters, n_cubes, p, d, weights, sparse, packed);
+    timer.lap(RunPhase::Count);
+
+    tuple_igs<n_decision_classes, n_dimensions, stat_mode>(
+        counters, counters_reduced, n_classes, tuple, n_cubes, n_cubes_reduced, total, H_Y, H, igs, H_except);
+}
+
+// with decision only
 template <uint8_t n_decision_classes, uint8_t n_dimensions>
 inline void process_subtuple(
     const uint8_t *data,
     const uint8_t *contrast_data,
     const uint8_t *decision,
     const size_t n_objects,
+    const int* weights,  // multiplicities of the objects (nullptr - 1 each)
     const size_t n_classes,
 
     const size_t* subtuple,
     const size_t contrast_idx,
 
     float* counters,
+    uint64_t* exact_counters,  // see count_counters
     float* counters_reduced,
     const size_t n_cubes,
     const size_t n_cubes_reduced,
@@ -158,14 +208,15 @@ inline void process_subtuple(
 
     float *contrast_ig
 ) {
-    count_counters<n_decision_classes, n_dimensions, true>(data, contrast_data, decision, n_objects, n_classes, subtuple, contrast_idx, counters, n_cubes, p, d);
+    count_counters<n_decision_classes, n_dimensions, true>(data, contrast_data, decision, n_objects, n_classes, subtuple, contrast_idx, counters, exact_counters, n_cubes, p, d, weights);
 
     // H(Y|{X_i}) conditional entropy of decision given all tuple vars
     float H_Y_given_all = conditional_entropy<n_decision_classes>(n_cubes, counters);
 
     std::memset(counters_reduced, 0, sizeof(float) * n_cubes_reduced * n_decision_classes);
-    reduce_counters(n_classes, n_cubes, counters, counters_reduced, n_cubes_reduced);
-    reduce_counters(n_classes, n_cubes, counters + n_cubes, counters_reduced + n_cubes_reduced, n_cubes_reduced);
+    for (uint8_t k = 0; k < n_decision_classes; ++k) {
+        reduce_counters(n_classes, n_cubes, counters + k * n_cubes, counters_reduced + k * n_cubes_reduced, n_cubes_reduced);
+    }
     // H(Y|{X_i!=X_k}) conditional entropy of decision given all tuple vars except the current one (X_k)
     float H_Y_given_all_except_contrast = conditional_entropy<n_decision_classes>(n_cubes_reduced, counters_reduced);
     // I(Y;X_k | {X_i!=X_k}) mutual information of decision and the current var given all the other tuple vars
@@ -0,0 +1,521 @@
+#ifndef MDFS_DECISIONS_H
+#define MDFS_DECISIONS_H
+
+#include "mdfs_cpu_kernel.h"
+
+#include "common.h"
+#include "dataset.h"
+#include "discretization_cache.h"
+#include "mdfs_discretize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+// many binary decisions (of the same objects) bit-sliced: bit j of a word is
+// object 64 * b + j of block b, the words of all decisions of a block are
+// stored together so that they are read while the cubes of the block are known;
+// the decisions may instead be one decision under many weightings of the
+// objects (e.g. bootstrap resamples), then the multiplicities of each object
+// in all the weightings are stored together and added to the counters of the
+// cube (and class) of the object at once; or one decision with the objects of
+// each of the folds (of cross-validation) left out in turn, then each object
+// is counted once, in its fold, and the folds are subtracted from the total
+class DecisionPlanes {
+public:
+    size_t n_decisions = 0;  // or weightings, or folds
+    size_t n_blocks = 0;  // of 64 objects
+    bool weighted = false;
+    bool folded = false;
+    std::vector<uint64_t> ones;  // objects of class 1, by block, then decision
+    std::vector<uint8_t> classes;  // weighted or folded - of the objects
+    std::vector<uint32_t> multiplicities;  // weighted - by object, then weighting
+    std::vector<uint32_t> folds;  // folded - of the objects
+    std::vector<uint64_t> class_totals;  // of both classes, by decision (fold left out)
+
+    // decisions hold n_objects values (0 or 1) of each decision, one after another
+    void prepare(const int* decisions, size_t n_decisions, size_t n_objects) {
+        this->n_decisions = n_decisions;
+        this->n_blocks = (n_objects + 63) / 64;
+        this->weighted = false;
+        this->folded = false;
+        this->ones.assign(this->n_blocks * n_decisions, 0);
+        this->classes.clear();
+        this->multiplicities.clear();
+        this->folds.clear();
+        this->class_totals.assign(2 * n_decisions, 0);
+        for (size_t t = 0; t < n_decisions; ++t) {
+            const int* decision = decisions + t * n_objects;
+            for (size_t o = 0; o < n_objects; ++o) {
+                this->ones[(o / 64) * n_decisions + t] |= uint64_t(decision[o] == 1) << (o % 64);
+                this->class_totals[2 * t + decision[o]]++;
+            }
+        }
+    }
+
+    // decision (0 or 1) under n_weightings weightings, which hold n_objects
+    // multiplicities (not negative) of each weighting, one after another
+    void prepareWeighted(const int* decision, const int* weightings, size_t n_weightings, size_t n_objects) {
+        this->n_decisions = n_weightings;
+        this->n_blocks = (n_objects + 63) / 64;
+        this->weighted = true;
+        this->folded = false;
+        this->ones.clear();
+        this->classes.assign(decision, decision + n_objects);
+        this->multiplicities.resize(n_objects * n_weightings);
+        this->folds.clear();
+        this->class_totals.assign(2 * n_weightings, 0);
+        for (size_t t = 0; t < n_weightings; ++t) {
+            const int* weighting = weightings + t * n_objects;
+            for (size_t o = 0; o < n_objects; ++o) {
+                this->multiplicities[o * n_weightings + t] = weighting[o];
+                this->class_totals[2 * t + decision[o]] += weighting[o];
+            }
+        }
+    }
+
+    // decision (0 or 1) with the objects of each of n_folds folds left out in
+    // turn, folds holds the fold (0 to n_folds-1) of each of n_objects objects
+    void prepareFolds(const int* decision, const int* folds, size_t n_folds, size_t n_objects) {
+        this->n_decisions = n_folds;
+        this->n_blocks = (n_objects + 63) / 64;
+        this->weighted = false;
+        this->folded = true;
+        this->ones.clear();
+        this->classes.assign(decision, decision + n_objects);
+        this->multiplicities.clear();
+        this->folds.assign(folds, folds + n_objects);
+        std::vector<uint64_t> all(2, 0);
+        std::vector<uint64_t> fold_totals(2 * n_folds, 0);
+        for (size_t o = 0; o < n_objects; ++o) {
+            all[decision[o]]++;
+            fold_totals[2 * folds[o] + decision[o]]++;
+        }
+        this->class_totals.resize(2 * n_folds);
+        for (size_t i = 0; i < 2 * n_folds; ++i) {
+            this->class_totals[i] = all[i % 2] - fold_totals[i];
+        }
+    }
+};
+
+// objects of each cube of the tuple (cube_totals, n_cubes) and those of class 1
+// of each decision (ones, n_cubes by decision); the cubes are found once for
+// each block of 64 objects and counted against all the decisions with popcounts
+template <uint8_t n_dimensions>
+inline void count_decisions(
+    const uint8_t* data,
+    const size_t n_objects,
+    const size_t n_classes,
+    const size_t* tuple,
+    const DecisionPlanes& planes,
+    const size_t n_cubes,
+    const size_t* d,
+    uint64_t* cube_totals,
+    uint64_t* ones,
+    std::vector<uint64_t>& cube_masks,  // of n_cubes, all 0 (and left so)
+    std::vector<uint32_t>& block_cubes  // of at least 64
+) {
+    std::fill(cube_totals, cube_totals + n_cubes, uint64_t(0));
+    std::fill(ones, ones + planes.n_decisions * n_cubes, uint64_t(0));
+
+    const uint8_t* columns[n_dimensions];
+    size_t strides[n_dimensions];
+    for (size_t k = 0; k < n_dimensions; ++k) {
+        columns[k] = data + tuple[k] * n_objects;
+        strides[k] = k == 0 ? 1 : k == 1 ? n_classes : d[k-2];
+    }
+
+    for (size_t b = 0; b < planes.n_blocks; ++b) {
+        const size_t first = 64 * b;
+        const size_t last = std::min(n_objects, first + 64);
+        size_t n_block_cubes = 0;
+        for (size_t o = first; o < last; ++o) {
+            size_t bucket = 0;
+            for (size_t k = 0; k < n_dimensions; ++k) {
+                bucket += strides[k] * columns[k][o];
+            }
+            if (cube_masks[bucket] == 0) {
+                block_cubes[n_block_cubes++] = bucket;
+            }
+            cube_masks[bucket] |= uint64_t(1) << (o - first);
+        }
+
+        const uint64_t* block_ones = &planes.ones[b * planes.n_decisions];
+        for (size_t i = 0; i < n_block_cubes; ++i) {
+            const size_t c = block_cubes[i];
+            const uint64_t mask = cube_masks[c];
+            cube_totals[c] += popcount64(mask);
+            for (size_t t = 0; t < planes.n_decisions; ++t) {
+                ones[t * n_cubes + c] += popcount64(mask & block_ones[t]);
+            }
+            cube_masks[c] = 0;
+        }
+    }
+}
+
+// weighted objects of each class of each cube of the tuple under all the
+// weightings of planes (weighted_counts, by cube, class, then weighting);
+// the multiplicities of an object are added as a row, which vectorises
+template <uint8_t n_dimensions>
+inline void count_weightings(
+    const uint8_t* data,
+    const size_t n_objects,
+    const size_t n_classes,
+    const size_t* tuple,
+    const DecisionPlanes& planes,
+    const size_t n_cubes,
+    const size_t* d,
+    uint32_t* weighted_counts
+) {
+    const size_t n_weightings = planes.n_decisions;
+    std::fill(weighted_counts, weighted_counts + 2 * n_cubes * n_weightings, uint32_t(0));
+
+    const uint8_t* columns[n_dimensions];
+    size_t strides[n_dimensions];
+    for (size_t k = 0; k < n_dimensions; ++k) {
+        columns[k] = data + tuple[k] * n_objects;
+        strides[k] = k == 0 ? 1 : k == 1 ? n_classes : d[k-2];
+    }
+
+    for (size_t o = 0; o < n_objects; ++o) {
+        size_t bucket = 0;
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            bucket += strides[k] * columns[k][o];
+        }
+        uint32_t* row = weighted_counts + (2 * bucket + planes.classes[o]) * n_weightings;
+        const uint32_t* multiplicities = &planes.multiplicities[o * n_weightings];
+        for (size_t t = 0; t < n_weightings; ++t) {
+            row[t] += multiplicities[t];
+        }
+    }
+}
+
+// objects of each class of each cube of the tuple without the objects of
+// each of the folds of planes (weighted_counts, by cube, class, then fold),
+// as count_weightings with 0 for the fold left out and 1 for the others
+template <uint8_t n_dimensions>
+inline void count_folds(
+    const uint8_t* data,
+    const size_t n_objects,
+    const size_t n_classes,
+    const size_t* tuple,
+    const DecisionPlanes& planes,
+    const size_t n_cubes,
+    const size_t* d,
+    uint32_t* weighted_counts
+) {
+    const size_t n_folds = planes.n_decisions;
+    std::fill(weighted_counts, weighted_counts + 2 * n_cubes * n_folds, uint32_t(0));
+
+    const uint8_t* columns[n_dimensions];
+    size_t strides[n_dimensions];
+    for (size_t k = 0; k < n_dimensions; ++k) {
+        columns[k] = data + tuple[k] * n_objects;
+        strides[k] = k == 0 ? 1 : k == 1 ? n_classes : d[k-2];
+    }
+
+    // each object in its fold
+    for (size_t o = 0; o < n_objects; ++o) {
+        size_t bucket = 0;
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            bucket += strides[k] * columns[k][o];
+        }
+        weighted_counts[(2 * bucket + planes.classes[o]) * n_folds + planes.folds[o]]++;
+    }
+
+    // each fold left out of the total
+    for (size_t row = 0; row < 2 * n_cubes; ++row) {
+        uint32_t* fold_counts = weighted_counts + row * n_folds;
+        uint32_t total = 0;
+        for (size_t t = 0; t < n_folds; ++t) {
+            total += fold_counts[t];
+        }
+        for (size_t t = 0; t < n_folds; ++t) {
+            fold_counts[t] = total - fold_counts[t];
+        }
+    }
+}
+
+// counters of decision t (of 2 classes) from count_decisions, with pseudocounts
+inline void decision_counters(
+    const uint64_t* cube_totals,
+    const uint64_t* ones,
+    const size_t t,
+    const size_t n_cubes,
+    const float p[2],
+    float* counters
+) {
+    for (size_t c = 0; c < n_cubes; ++c) {
+        const uint64_t class_ones = ones[t * n_cubes + c];
+        counters[c] = float(cube_totals[c] - class_ones) + p[0];
+        counters[n_cubes + c] = float(class_ones) + p[1];
+    }
+}
+
+// counters of weighting t of n_weightings from count_weightings (or of fold t
+// left out from count_folds), with pseudocounts
+inline void weighting_counters(
+    const uint32_t* weighted_counts,
+    const size_t t,
+    const size_t n_weightings,
+    const size_t n_cubes,
+    const float p[2],
+    float* counters
+) {
+    for (size_t c = 0; c < n_cubes; ++c) {
+        counters[c] = float(weighted_counts[2 * c * n_weightings + t]) + p[0];
+        counters[n_cubes + c] = float(weighted_counts[(2 * c + 1) * n_weightings + t]) + p[1];
+    }
+}
+
+// max IGs (MI with decision) of all variables for each of the decisions in
+// one pass over the tuples: the data is discretized once and the cubes of each
+// tuple are found once for all the decisions; the IGs are those of scalarMDFS
+// with each decision (and weights; 3D+ with H(Y|{X_i!=X_k}) reduced from the
+// counters); max_igs holds variable_count values of each decision, one after another
+template <uint8_t n_dimensions>
+void decisionsMDFS(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    const DecisionPlanes& planes,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    std::vector<float>& max_igs
+) {
+    const size_t n_objects = raw_data->info.object_count;
+    const size_t variable_count = raw_data->info.variable_count;
+    const size_t n_decisions = planes.n_decisions;
+
+    const size_t n_classes = mdfs_info.divisions + 1;
+    const size_t num_of_cubes = std::pow(n_classes, n_dimensions);
+    const size_t num_of_cubes_reduced = std::pow(n_classes, n_dimensions - 1);
+
+    const auto d2 = n_classes*n_classes;
+    const auto d3 = d2*n_classes;
+    const auto d4 = d3*n_classes;
+    const size_t d[3] = {d2, d3, d4};
+
+    // pseudocounts and H(Y) of each decision, as in scalarMDFS
+    std::vector<float> p(2 * n_decisions);
+    std::vector<float> H_Y(n_decisions);
+    for (size_t t = 0; t < n_decisions; t++) {
+        const uint64_t* c = &planes.class_totals[2 * t];
+        const float cmin = std::min(c[0], c[1]);
+        float H_Y_counters[2];
+        for (uint8_t i = 0; i < 2; i++) {
+            p[2 * t + i] = c[i] / cmin * mdfs_info.pseudo;
+            H_Y_counters[i] = c[i] + p[2 * t + i] * num_of_cubes;
+        }
+        H_Y[t] = conditional_entropy<2>(1, H_Y_counters);
+    }
+
+    // variables in use, stored densely and tuples are made of their positions in data
+    const bool only_interesting = mdfs_info.interesting_vars_count && mdfs_info.require_all_vars;
+    const size_t n_positions = only_interesting ? mdfs_info.interesting_vars_count : variable_count;
+    auto variable_at = [&](size_t position) -> size_t {
+        return only_interesting ? mdfs_info.interesting_vars[position] : position;
+    };
+    const int* generated_interesting_vars = only_interesting ? nullptr : mdfs_info.interesting_vars;
+    const size_t generated_interesting_vars_count = only_interesting ? 0 : mdfs_info.interesting_vars_count;
+
+    // sparse data and packed genotypes are made dense as well
+    const bool in_place = raw_data->byte_values && !only_interesting;
+    uint8_t* owned_data = !in_place ? new uint8_t[n_objects * n_positions] : nullptr;
+    const uint8_t* data = in_place ? static_cast<const uint8_t*>(raw_data->data) : owned_data;
+
+    // H(Y|X_i) for the optimised 2D version, by decision, then position
+    std::vector<float> H(n_dimensions == 2 ? n_decisions * n_positions : 0);
+
+    DiscretizationCache* const cache = dfi ? mdfs_info.cache : nullptr;
+
+    max_igs.assign(variable_count * n_decisions, -std::numeric_limits<float>::infinity());
+
+    ProgressMonitor* const progress = mdfs_info.progress;
+    if (progress != nullptr) {
+        const uint64_t tuples_per_discretization = TupleGenerator<n_dimensions>(
+            n_positions, generated_interesting_vars, generated_interesting_vars_count).count();
+        progress->start(tuples_per_discretization * mdfs_info.discretizations, (1 << 22) / n_objects + 1);
+    }
+    bool stop_run = false;
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        #ifdef _OPENMP
+        const int omp_numthr = omp_get_num_threads();
+        const int omp_tidx = omp_get_thread_num();
+        #else
+        constexpr int omp_numthr = 1;
+        constexpr int omp_tidx = 0;
+        #endif
+
+        PhaseTimer timer(nullptr);
+        uint64_t progress_pending = 0;
+        std::vector<double> column_buffer;
+
+        size_t local_tuple[n_dimensions];
+        float igs[n_dimensions];
+        std::vector<float> counters(2 * num_of_cubes);
+        std::vector<float> reduced(2 * num_of_cubes_reduced);
+        const size_t max_cubes = std::max(num_of_cubes, n_classes);
+        const bool by_rows = planes.weighted || planes.folded;
+        std::vector<uint64_t> cube_totals(!by_rows ? max_cubes : 0);
+        std::vector<uint64_t> ones(!by_rows ? n_decisions * max_cubes : 0);
+        std::vector<uint64_t> cube_masks(!by_rows ? max_cubes : 0, 0);
+        std::vector<uint32_t> block_cubes(64);
+        std::vector<uint32_t> weighted_counts(by_rows ? 2 * n_decisions * max_cubes : 0);
+
+        TupleGenerator<n_dimensions> generator(n_positions, generated_interesting_vars, generated_interesting_vars_count);
+
+        // a contiguous range of tuples for each thread
+        const uint64_t thread_tuples = generator.count() / omp_numthr;
+        const uint64_t thread_tuples_left = generator.count() % omp_numthr;
+        const uint64_t thread_first_tuple = thread_tuples * omp_tidx + std::min<uint64_t>(omp_tidx, thread_tuples_left);
+        const uint64_t thread_last_tuple = thread_first_tuple + thread_tuples + (uint64_t(omp_tidx) < thread_tuples_left);
+
+        // by decision, then variable
+        std::vector<float> thread_max_igs(variable_count * n_decisions, -std::numeric_limits<float>::infinity());
+
+        for (size_t discretization_id = 0; discretization_id < mdfs_info.discretizations; discretization_id++) {
+            #ifdef _OPENMP
+            #pragma omp master
+            #endif
+            stop_run = progress != nullptr && progress->cancelled();
+
+            #ifdef _OPENMP
+            #pragma omp barrier
+            #endif
+
+            if (stop_run) {
+                break;
+            }
+
+            for (size_t i = omp_tidx; i < n_positions && owned_data != nullptr; i += omp_numthr) {
+                const size_t v = variable_at(i);
+                if (dfi) {
+                    DiscretizationCache::Key key;
+                    discretize_variable(raw_data, v, v, discretization_id, *dfi, cache, &key,
+                                        column_buffer, owned_data + i * n_objects, timer);
+                    raw_data->doneWith(v);
+                } else {
+                    copy_discrete_variable(raw_data, v, owned_data + i * n_objects);
+                }
+            }
+
+            #ifdef _OPENMP
+            #pragma omp barrier
+            #endif
+
+            if (n_dimensions == 2) {
+                std::vector<float> mini_counters(2 * n_classes);
+                for (size_t i = omp_tidx; i < n_positions; i += omp_numthr) {
+                    if (planes.weighted) {
+                        count_weightings<1>(data, n_objects, n_classes, &i, planes, n_classes, nullptr, weighted_counts.data());
+                    } else if (planes.folded) {
+                        count_folds<1>(data, n_objects, n_classes, &i, planes, n_classes, nullptr, weighted_counts.data());
+                    } else {
+                        count_decisions<1>(data, n_objects, n_classes, &i, planes, n_classes, nullptr,
+                                           cube_totals.data(), ones.data(), cube_masks, block_cubes);
+                    }
+                    for (size_t t = 0; t < n_decisions; t++) {
+                        // to match counting in higher dimensions
+                        const float mini_p[2] = {p[2 * t] * num_of_cubes_reduced, p[2 * t + 1] * num_of_cubes_reduced};
+                        if (by_rows) {
+                            weighting_counters(weighted_counts.data(), t, n_decisions, n_classes, mini_p, mini_counters.data());
+                        } else {
+                            decision_counters(cube_totals.data(), ones.data(), t, n_classes, mini_p, mini_counters.data());
+                        }
+                        H[t * n_positions + i] = conditional_entropy<2>(n_classes, mini_counters.data());
+                    }
+                }
+
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+            }
+
+            generator.reset(thread_first_tuple, thread_last_tuple);
+            while (generator.hasNext()) {
+                generator.next(local_tuple);
+
+                if (progress != nullptr && progress->step(progress_pending, 1, omp_tidx == 0)) {
+                    break;
+                }
+
+                if (planes.weighted) {
+                    count_weightings<n_dimensions>(data, n_objects, n_classes, local_tuple, planes, num_of_cubes, d,
+                                                   weighted_counts.data());
+                } else if (planes.folded) {
+                    count_folds<n_dimensions>(data, n_objects, n_classes, local_tuple, planes, num_of_cubes, d,
+                                              weighted_counts.data());
+                } else {
+                    count_decisions<n_dimensions>(data, n_objects, n_classes, local_tuple, planes, num_of_cubes, d,
+                                                  cube_totals.data(), ones.data(), cube_masks, block_cubes);
+                }
+                for (size_t t = 0; t < n_decisions; t++) {
+                    if (by_rows) {
+                        weighting_counters(weighted_counts.data(), t, n_decisions, num_of_cubes, &p[2 * t], counters.data());
+                    } else {
+                        decision_counters(cube_totals.data(), ones.data(), t, num_of_cubes, &p[2 * t], counters.data());
+                    }
+                    tuple_igs<2, n_dimensions, StatMode::MutualInformation>(
+                        counters.data(), reduced.data(), n_classes, local_tuple, num_of_cubes, num_of_cubes_reduced,
+                        0.0f, H_Y[t], n_dimensions == 2 ? &H[t * n_positions] : nullptr, igs);
+                    float* decision_max_igs = &thread_max_igs[t * variable_count];
+                    for (size_t k = 0; k < n_dimensions; k++) {
+                        float& max_ig = decision_max_igs[variable_at(local_tuple[k])];
+                        if (igs[k] > max_ig) {
+                            max_ig = igs[k];
+                        }
+                    }
+                }
+            }
+
+            if (progress != nullptr) {
+                progress->add(progress_pending);
+                progress_pending = 0;
+            }
+        }
+
+        #ifdef _OPENMP
+        #pragma omp critical (SetDecisionsOutput)
+        #endif
+        for (size_t i = 0; i < max_igs.size(); i++) {
+            if (thread_max_igs[i] > max_igs[i]) {
+                max_igs[i] = thread_max_igs[i];
+            }
+        }
+    }
+
+    if (progress != nullptr) {
+        progress->finish();
+    }
+
+    delete[] owned_data;
+}
+
+typedef void (*DecisionsMdfsImpl) (
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    const DecisionPlanes& planes,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    std::vector<float>& max_igs
+);
+
+// many binary decisions (or weightings, or folds left out) at once (mutual information), by dimensions
+const DecisionsMdfsImpl mdfsDecisions[5] = {
+    decisionsMDFS<1>,
+    decisionsMDFS<2>,
+    decisionsMDFS<3>,
+    decisionsMDFS<4>,
+    decisionsMDFS<5>,
+};
+
+#endif
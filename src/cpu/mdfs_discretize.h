@@ -0,0 +1,90 @@
+#ifndef MDFS_DISCRETIZE_H
+#define MDFS_DISCRETIZE_H
+
+#include "dataset.h"
+#include "discretization_cache.h"
+#include "discretize.h"
+#include "run_stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+// discretizes the continuous variable v of raw_data into out_data (feature_id
+// selects the thresholds); when the cache is set, the variable is looked up
+// in it first and its key is stored in key
+inline void discretize_variable(
+    const RawData* raw_data,
+    size_t v,
+    uint32_t feature_id,
+    size_t discretization_id,
+    const DiscretizationInfo& dfi,
+    DiscretizationCache* cache,
+    DiscretizationCache::Key* key,
+    std::vector<double>& column_buffer,
+    uint8_t* out_data,
+    PhaseTimer& timer
+) {
+    const double* in_data = raw_data->getVariable(v, column_buffer);
+
+    if (cache != nullptr) {
+        *key = DiscretizationCache::key(in_data, raw_data->info.object_count, feature_id,
+            dfi.seed, discretization_id, dfi.divisions, dfi.range);
+        if (cache->find(*key, out_data)) {
+            return;
+        }
+    }
+
+    std::vector<double> sorted_in_data(in_data, in_data + raw_data->info.object_count);
+    std::sort(sorted_in_data.begin(), sorted_in_data.end());
+    timer.lap(RunPhase::Sort);
+
+    discretize(
+        dfi.seed,
+        discretization_id,
+        feature_id,
+        dfi.divisions,
+        raw_data->info.object_count,
+        in_data,
+        sorted_in_data,
+        out_data,
+        dfi.range
+    );
+
+    if (cache != nullptr) {
+        cache->insert(*key, out_data);
+    }
+}
+
+// rewrites the discrete (int) variable v of raw_data to uint8_t, sparse data
+// and packed genotypes as dense
+inline void copy_discrete_variable(const RawData* raw_data, size_t v, uint8_t* out_data) {
+    if (raw_data->byte_values) {
+        std::memcpy(out_data, raw_data->getVariableB(v), raw_data->info.object_count);
+        return;
+    }
+
+    if (raw_data->packed_genotypes) {
+        const uint8_t* column = raw_data->getPackedVariable(v);
+        for (size_t o = 0; o < raw_data->info.object_count; o++) {
+            out_data[o] = packed_genotype(column, o);
+        }
+        return;
+    }
+    if (raw_data->isSparse()) {
+        const int* values = static_cast<const int*>(raw_data->data);
+        std::fill(out_data, out_data + raw_data->info.object_count, uint8_t(0));
+        for (int cell = raw_data->sparse_columns[v]; cell < raw_data->sparse_columns[v + 1]; cell++) {
+            out_data[raw_data->sparse_objects[cell]] = values[cell];
+        }
+        return;
+    }
+
+    const int* in_data = raw_data->getVariableI(v);
+    for (size_t o = 0; o < raw_data->info.object_count; o++) {
+        out_data[o] = in_data[o];
+    }
+}
+
+#endif
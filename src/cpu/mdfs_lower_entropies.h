@@ -0,0 +1,88 @@
+#ifndef MDFS_LOWER_ENTROPIES_H
+#define MDFS_LOWER_ENTROPIES_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+// index of the pair of variables i < j in a triangular table
+inline size_t pair_index(size_t i, size_t j) {
+    return j * (j - 1) / 2 + i;
+}
+
+// the 3D pair table is worth counting only for at least this many tuples per pair
+// (about where it starts to pay off, as measured)
+constexpr uint64_t pair_table_min_tuples_per_pair = 32;
+
+// Conditional entropies of decision given all but one variable of a tuple,
+// memoised by a thread during a discretization (beyond 3D, where a full
+// table does not fit). Everything is dropped at once when over the limit.
+template <uint8_t n_dimensions>
+class LowerEntropyMemo {
+    typedef std::array<size_t, n_dimensions - 1> Key;
+
+    class KeyHash {
+    public:
+        size_t operator()(const Key& key) const {
+            uint64_t h = 0x9e3779b97f4a7c15ULL;
+            for (size_t v : key) {
+                h = (h ^ v) * 0xff51afd7ed558ccdULL;
+                h ^= h >> 33;
+            }
+            return h;
+        }
+    };
+
+    std::unordered_map<Key, float, KeyHash> entropies;
+    const size_t max_entries;
+
+    // the tuple without its k-th variable
+    static Key except(const size_t* tuple, size_t k) {
+        Key key;
+        for (size_t v = 0, i = 0; v < n_dimensions; ++v) {
+            if (v != k) {
+                key[i++] = tuple[v];
+            }
+        }
+        return key;
+    }
+
+public:
+    // rough size of an entry of the map
+    static constexpr size_t entry_bytes = sizeof(Key) + sizeof(float) + 4 * sizeof(void*);
+
+    explicit LowerEntropyMemo(size_t max_bytes) : max_entries(max_bytes / entry_bytes) {}
+
+    void clear() {
+        this->entropies.clear();
+    }
+
+    // H_except[k] for each k of the tuple, NaN when not known; returns whether all were
+    bool find(const size_t* tuple, float* H_except) const {
+        bool all_found = true;
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            auto found = this->entropies.find(except(tuple, k));
+            if (found != this->entropies.end()) {
+                H_except[k] = found->second;
+            } else {
+                H_except[k] = std::numeric_limits<float>::quiet_NaN();
+                all_found = false;
+            }
+        }
+        return all_found;
+    }
+
+    void insert(const size_t* tuple, const float* H_except) {
+        if (this->entropies.size() + n_dimensions > this->max_entries) {
+            this->entropies.clear();
+        }
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            this->entropies.emplace(except(tuple, k), H_except[k]);
+        }
+    }
+};
+
+#endif
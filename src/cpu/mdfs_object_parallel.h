@@ -0,0 +1,618 @@
+#ifndef MDFS_OBJECT_PARALLEL_H
+#define MDFS_OBJECT_PARALLEL_H
+
+#include "mdfs_cpu_kernel.h"
+
+#include "common.h"
+#include "dataset.h"
+#include "discretize.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+// objects per thread below which splitting objects is not chosen automatically
+constexpr size_t object_parallel_min_objects = size_t(1) << 16;
+// memory for the partial counters of the tuples counted between synchronisations
+constexpr size_t object_parallel_batch_bytes = size_t(64) << 20;
+
+// first object of the part of n_objects (of parts)
+inline size_t object_part_start(size_t n_objects, size_t part, size_t parts) {
+    return n_objects * part / parts;
+}
+
+// number of the elements of a among the first k of the (stable) merge of a and b
+inline size_t merge_co_rank(const double* a, size_t na, const double* b, size_t nb, size_t k) {
+    size_t lo = k > nb ? k - nb : 0;
+    size_t hi = std::min(k, na);
+    while (lo < hi) {
+        const size_t i = lo + (hi - lo) / 2;
+        if (b[k - i - 1] >= a[i]) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+// sorts values (shared by the team) with all its threads: each thread sorts
+// its part of the objects, then the sorted parts are merged pairwise in rounds,
+// the output of each round split evenly among the threads by co-ranks;
+// returns values or scratch, whichever holds the result
+inline double* parallel_sort(double* values, double* scratch, size_t n_objects, int omp_tidx, int omp_numthr) {
+    auto part_start = [&](size_t part) {
+        return object_part_start(n_objects, std::min<size_t>(part, omp_numthr), omp_numthr);
+    };
+    std::sort(values + part_start(omp_tidx), values + part_start(omp_tidx + 1));
+
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
+
+    double* in = values;
+    double* out = scratch;
+    for (size_t run = 1; run < size_t(omp_numthr); run *= 2) {
+        const size_t out_first = part_start(omp_tidx);
+        const size_t out_last = part_start(omp_tidx + 1);
+        for (size_t r = 0; r < size_t(omp_numthr); r += 2 * run) {
+            const size_t a_first = part_start(r);
+            const size_t b_first = part_start(r + run);
+            const size_t b_last = part_start(r + 2 * run);
+            const size_t first = std::max(out_first, a_first);
+            const size_t last = std::min(out_last, b_last);
+            if (first >= last) {
+                continue;
+            }
+            const double* a = in + a_first;
+            const double* b = in + b_first;
+            const size_t na = b_first - a_first;
+            const size_t nb = b_last - b_first;
+            const size_t a_from = merge_co_rank(a, na, b, nb, first - a_first);
+            const size_t a_to = merge_co_rank(a, na, b, nb, last - a_first);
+            std::merge(a + a_from, a + a_to,
+                       b + (first - a_first - a_from), b + (last - a_first - a_to),
+                       out + first);
+        }
+
+        #ifdef _OPENMP
+        #pragma omp barrier
+        #endif
+
+        std::swap(in, out);
+    }
+    return in;
+}
+
+// whether objectParallelMDFS evaluates the run (see MDFSInfo::parallel_mode);
+// automatically when there are too few tuples (or variables to discretize)
+// to keep all the threads evenly busy and each still counts many objects,
+// but not in 3D+ with lower entropies kept, which would change the result,
+// nor when pruning, which only scalarMDFS does
+template <uint8_t n_dimensions>
+bool use_object_parallel(const MDFSInfo& mdfs_info, const RawData* raw_data, const RawData* contrast_raw_data) {
+    if (mdfs_info.parallel_mode == ParallelMode::Tuples || mdfs_info.tile_size > 0
+            || contrast_raw_data != nullptr || mdfs_info.contrast_sources_count > 0
+            || raw_data->isSparse() || raw_data->packed_genotypes) {
+        return false;
+    }
+    if (mdfs_info.parallel_mode == ParallelMode::Objects) {
+        return true;
+    }
+    // the results must not depend on the machine
+    if (n_dimensions > 2 && mdfs_info.lower_entropies_max_bytes > 0) {
+        return false;
+    }
+    if (mdfs_info.prune) {
+        return false;
+    }
+
+    #ifdef _OPENMP
+    const size_t threads = omp_get_max_threads();
+    #else
+    const size_t threads = 1;
+    #endif
+    if (threads < 2 || raw_data->info.object_count < threads * object_parallel_min_objects) {
+        return false;
+    }
+
+    const bool only_interesting = mdfs_info.interesting_vars_count && mdfs_info.require_all_vars;
+    const size_t n_positions = only_interesting ? mdfs_info.interesting_vars_count : raw_data->info.variable_count;
+    const uint64_t tuples = TupleGenerator<n_dimensions>(
+        n_positions,
+        only_interesting ? nullptr : mdfs_info.interesting_vars,
+        only_interesting ? 0 : mdfs_info.interesting_vars_count).count();
+    return tuples < 8 * threads || n_positions < 2 * threads;
+}
+
+
+// Object-parallel variant of scalarMDFS (see use_object_parallel), for few
+// variables of many objects: each thread discretizes and counts its own part
+// of the objects of every variable and tuple, and the partial counters are
+// summed before the entropies. Variables are sorted in parallel (see
+// parallel_sort) and tuples are counted in batches between synchronisations,
+// the sums and IGs of a batch split among the threads. The partial counters
+// are integers, so results are the same as of scalarMDFS without lower
+// entropies (lower_entropies_max_bytes = 0) at any number of objects.
+// Dense data without contrast variables only, the discretization cache is
+// not used.
+template <uint8_t n_decision_classes, uint8_t n_dimensions, StatMode stat_mode>
+void objectParallelMDFS(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    MDFSOutput& out
+) {
+    const auto run_start = std::chrono::steady_clock::now();
+    #ifdef _OPENMP
+    int run_numthr = 1;
+    const size_t max_threads = omp_get_max_threads();
+    if (out.run_stats != nullptr) {
+        out.run_stats->threads.resize(max_threads);
+    }
+    #else
+    const size_t max_threads = 1;
+    if (out.run_stats != nullptr) {
+        out.run_stats->threads.resize(1);
+    }
+    #endif
+
+    const size_t n_objects = raw_data->info.object_count;
+
+    // as in scalarMDFS
+    const bool only_interesting = mdfs_info.interesting_vars_count && mdfs_info.require_all_vars;
+    const size_t n_positions = only_interesting ? mdfs_info.interesting_vars_count : raw_data->info.variable_count;
+    auto variable_at = [&](size_t position) -> size_t {
+        return only_interesting ? mdfs_info.interesting_vars[position] : position;
+    };
+    const int* generated_interesting_vars = only_interesting ? nullptr : mdfs_info.interesting_vars;
+    const size_t generated_interesting_vars_count = only_interesting ? 0 : mdfs_info.interesting_vars_count;
+
+    size_t c[n_decision_classes];
+    for (uint8_t i = 0; i < n_decision_classes; i++) {
+        c[i] = 0;
+    }
+    const int* weights = raw_data->weights;  // as in scalarMDFS
+    auto weight_of = [&](size_t i) -> size_t {
+        return weights != nullptr ? weights[i] : 1;
+    };
+
+    uint8_t* decision = nullptr;
+    if (n_decision_classes > 1) {
+        decision = new uint8_t[n_objects];
+        for (size_t i = 0; i < n_objects; i++) {
+            decision[i] = raw_data->decision[i];
+            c[decision[i]] += weight_of(i);
+        }
+    } else {
+        for (size_t i = 0; i < n_objects; i++) {
+            c[0] += weight_of(i);
+        }
+    }
+    const float cmin = *std::min_element(c, c+n_decision_classes);
+
+    // as in scalarMDFS
+    const float ig_thr = mdfs_info.ig_thr > 0.0f ? mdfs_info.ig_thr : -std::numeric_limits<float>::infinity();
+
+    float p[n_decision_classes];
+    for (uint8_t i = 0; i < n_decision_classes; i++) {
+        p[i] = c[i] / cmin * mdfs_info.pseudo;
+    }
+
+    const size_t n_classes = mdfs_info.divisions + 1;
+    const size_t num_of_cubes = std::pow(n_classes, n_dimensions);
+    const size_t num_of_cubes_reduced = std::pow(n_classes, n_dimensions - 1);
+
+    const auto d2 = n_classes*n_classes;
+    const auto d3 = d2*n_classes;
+    const auto d4 = d3*n_classes;
+    const size_t d[3] = {d2, d3, d4};
+
+    float H_Y_counters[n_decision_classes];
+    for (uint8_t i = 0; i < n_decision_classes; i++) {
+        H_Y_counters[i] = c[i] + p[i] * num_of_cubes;
+    }
+    const float H_Y = conditional_entropy<n_decision_classes>(1, H_Y_counters);
+
+    const float total_counters = c[0] + p[0] * num_of_cubes;
+
+    // for the optimised 2D version, by position
+    std::vector<float> H;
+    if (n_dimensions == 2) {
+        H.resize(n_positions);
+        if (mdfs_info.I_lower != nullptr) {
+            for (size_t i = 0; i < n_positions; i++) {
+                if (n_decision_classes == 1) {
+                    H[i] = mdfs_info.I_lower[variable_at(i)];
+                } else {
+                    H[i] = H_Y - mdfs_info.I_lower[variable_at(i)];
+                }
+            }
+        }
+    }
+    const bool compute_H = n_dimensions == 2 && mdfs_info.I_lower == nullptr;
+    // to match counting in higher dimensions
+    float mini_p[n_decision_classes];
+    for (uint8_t i = 0; i < n_decision_classes; i++) {
+        mini_p[i] = p[i] * num_of_cubes_reduced;
+    }
+
+    // discretized data by position; discrete bytes are counted in place as in scalarMDFS
+    const bool in_place = !dfi && raw_data->byte_values && !only_interesting;
+    std::vector<uint8_t> owned_data(in_place ? 0 : n_objects * n_positions);
+    const uint8_t* data = in_place ? static_cast<const uint8_t*>(raw_data->data) : owned_data.data();
+
+    // values of the variable being discretized (converted when stored as float), sorted
+    std::vector<double> column(dfi && raw_data->single_precision ? n_objects : 0);
+    std::vector<double> sorted(dfi ? n_objects : 0);
+    std::vector<double> sort_scratch(dfi ? n_objects : 0);
+
+    // partial (exact) counters of each thread: of the tuples of a batch and of the single variables
+    const size_t cube_cells = n_decision_classes * num_of_cubes;
+    const size_t mini_cells = n_decision_classes * n_classes;
+    const size_t batch = std::max<size_t>(1, std::min<size_t>(
+        max_threads, object_parallel_batch_bytes / (max_threads * cube_cells * sizeof(uint64_t))));
+    std::vector<uint64_t> partials(max_threads * batch * cube_cells);
+    std::vector<uint64_t> mini_partials(compute_H ? max_threads * n_positions * mini_cells : 0);
+
+    ProgressMonitor* const progress = mdfs_info.progress;
+    if (progress != nullptr) {
+        const uint64_t tuples_per_discretization = TupleGenerator<n_dimensions>(
+            n_positions, generated_interesting_vars, generated_interesting_vars_count).count();
+        progress->start(tuples_per_discretization * mdfs_info.discretizations, 1);
+    }
+
+    // shared state, changed by the master thread between barriers
+    bool stop_run = false;
+    bool stop_batches = false;
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        #ifdef _OPENMP
+        const int omp_numthr = omp_get_num_threads();
+        const int omp_tidx = omp_get_thread_num();
+        #else
+        constexpr int omp_numthr = 1;
+        constexpr int omp_tidx = 0;
+        #endif
+
+        #ifdef _OPENMP
+        #pragma omp master
+        run_numthr = omp_numthr;
+        #endif
+
+        ThreadRunStats thread_stats;
+        PhaseTimer timer(out.run_stats != nullptr ? &thread_stats : nullptr);
+
+        // objects of this thread
+        const size_t first = object_part_start(n_objects, omp_tidx, omp_numthr);
+        const size_t last = object_part_start(n_objects, omp_tidx + 1, omp_numthr);
+
+        std::vector<double> thresholds(dfi ? dfi->divisions : 0);
+        std::vector<size_t> batch_tuples(batch * n_dimensions);  // positions, the same in all threads
+        size_t tuple[n_dimensions];
+        float igs[n_dimensions];
+        float* counters = new float[cube_cells];
+        float* reduced = new float[n_decision_classes * num_of_cubes_reduced];
+        float* mini_counters = compute_H ? new float[mini_cells] : nullptr;
+        std::vector<uint64_t> sums(compute_H ? std::max(cube_cells, mini_cells) : cube_cells);
+        uint64_t* const thread_partials = partials.data() + omp_tidx * batch * cube_cells;
+        uint64_t* const thread_mini_partials = compute_H ? mini_partials.data() + omp_tidx * n_positions * mini_cells : nullptr;
+
+        TupleGenerator<n_dimensions> generator(n_positions, generated_interesting_vars, generated_interesting_vars_count);
+
+        #ifdef _OPENMP
+        MDFSOutput* thread_out = nullptr;
+        if (out.type == MDFSOutputType::MaxIGs) {
+            thread_out = new MDFSOutput(out.type, n_dimensions, raw_data->info.variable_count, 0);
+            if (out.max_igs_tuples != nullptr) {
+                thread_out->setMaxIGsTuples(new int[n_dimensions*raw_data->info.variable_count], new int[raw_data->info.variable_count]);
+            }
+            if (out.discretization_max_igs != nullptr) {
+                thread_out->setDiscretizationMaxIGs(new float[mdfs_info.discretizations * raw_data->info.variable_count],
+                                                    mdfs_info.discretizations);
+            }
+        }
+        #endif
+
+        for (size_t discretization_id = 0; discretization_id < mdfs_info.discretizations; discretization_id++) {
+            #ifdef _OPENMP
+            #pragma omp master
+            #endif
+            stop_run = progress != nullptr && progress->cancelled();
+
+            #ifdef _OPENMP
+            #pragma omp barrier
+            #endif
+            timer.lap(RunBarrier::DiscretizationStart);
+
+            if (stop_run) {
+                break;
+            }
+
+            if (dfi) {
+                for (size_t i = 0; i < n_positions; i++) {
+                    const size_t v = variable_at(i);
+                    #ifdef _OPENMP
+                    #pragma omp master
+                    #endif
+                    if (i + 1 < n_positions) {
+                        raw_data->willNeed(variable_at(i + 1));
+                    }
+
+                    const double* values = nullptr;
+                    if (raw_data->single_precision) {
+                        const float* variable = raw_data->getVariableF(v);
+                        std::copy(variable + first, variable + last, column.begin() + first);
+                        values = column.data();
+                    } else {
+                        values = raw_data->getVariable(v);
+                    }
+                    std::copy(values + first, values + last, sorted.begin() + first);
+
+                    // parallel_sort synchronises the threads, so all the values are there
+                    const double* sorted_values = parallel_sort(sorted.data(), sort_scratch.data(), n_objects, omp_tidx, omp_numthr);
+                    timer.lap(RunPhase::Sort);
+
+                    discretization_thresholds(dfi->seed, discretization_id, v, dfi->divisions, n_objects,
+                                              sorted_values, dfi->range, thresholds.data());
+                    apply_thresholds(dfi->divisions, thresholds.data(), last - first,
+                                     values + first, owned_data.data() + i * n_objects + first);
+                    timer.lap(RunPhase::Discretize);
+
+                    // the sorted values are overwritten by the next variable
+                    #ifdef _OPENMP
+                    #pragma omp barrier
+                    #endif
+                    timer.lap(RunBarrier::Discretized);
+
+                    #ifdef _OPENMP
+                    #pragma omp master
+                    #endif
+                    {
+                        raw_data->doneWith(v);
+                        if (progress != nullptr) {
+                            progress->poll();
+                        }
+                    }
+                }
+            } else if (!in_place) {
+                // rewrite int to uint8_t
+                for (size_t i = 0; i < n_positions; i++) {
+                    uint8_t* out_data = owned_data.data() + i * n_objects;
+                    if (raw_data->byte_values) {
+                        std::memcpy(out_data + first, raw_data->getVariableB(variable_at(i)) + first, last - first);
+                    } else {
+                        const int* in_data = raw_data->getVariableI(variable_at(i));
+                        for (size_t o = first; o < last; o++) {
+                            out_data[o] = in_data[o];
+                        }
+                    }
+                }
+                timer.lap(RunPhase::Discretize);
+            }
+
+            #ifdef _OPENMP
+            #pragma omp barrier
+            #endif
+            timer.lap(RunBarrier::Discretized);
+
+            if (compute_H) {
+                for (size_t i = 0; i < n_positions; i++) {
+                    uint64_t* partial = thread_mini_partials + i * mini_cells;
+                    std::fill(partial, partial + mini_cells, 0);
+                    add_counts<n_decision_classes, 1, false>(data, nullptr, decision, n_objects, 0, &i, 0,
+                                                             partial, n_classes, nullptr, weights, first, last);
+                }
+                timer.lap(RunPhase::Count);
+
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::LowerEntropies);
+
+                for (size_t i = omp_tidx; i < n_positions; i += omp_numthr) {
+                    std::fill(sums.begin(), sums.begin() + mini_cells, 0);
+                    for (int t = 0; t < omp_numthr; t++) {
+                        const uint64_t* partial = mini_partials.data() + (t * n_positions + i) * mini_cells;
+                        for (size_t k = 0; k < mini_cells; k++) {
+                            sums[k] += partial[k];
+                        }
+                    }
+                    std::copy(sums.begin(), sums.begin() + mini_cells, mini_counters);
+                    add_pseudocounts<n_decision_classes>(mini_counters, n_classes, mini_p);
+                    timer.lap(RunPhase::Count);
+                    if (n_decision_classes == 1) {
+                        // H(X_i) (plain) entropy of the current var
+                        H[i] = entropy(total_counters, n_classes, mini_counters);
+                    } else {
+                        // H(Y|X_i) conditional entropy of decision given the current var
+                        H[i] = conditional_entropy<n_decision_classes>(n_classes, mini_counters);
+                    }
+                    timer.lap(RunPhase::Entropy);
+                }
+
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::LowerEntropies);
+            }
+
+            generator.reset();
+            do {
+                size_t n_batch = 0;
+                while (n_batch < batch && generator.hasNext()) {
+                    generator.next(batch_tuples.data() + n_batch * n_dimensions);
+                    n_batch++;
+                }
+                if (n_batch == 0) {
+                    break;
+                }
+
+                for (size_t b = 0; b < n_batch; b++) {
+                    uint64_t* partial = thread_partials + b * cube_cells;
+                    std::fill(partial, partial + cube_cells, 0);
+                    add_counts<n_decision_classes, n_dimensions, false>(
+                        data, nullptr, decision, n_objects, n_classes, batch_tuples.data() + b * n_dimensions, 0,
+                        partial, num_of_cubes, d, weights, first, last);
+                }
+                timer.lap(RunPhase::Count);
+
+                // waiting for the counts of the other threads counts as waiting for discretized data
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::Discretized);
+
+                for (size_t b = omp_tidx; b < n_batch; b += omp_numthr) {
+                    const size_t* local_tuple = batch_tuples.data() + b * n_dimensions;
+                    std::copy(partials.data() + b * cube_cells, partials.data() + (b + 1) * cube_cells, sums.begin());
+                    for (int t = 1; t < omp_numthr; t++) {
+                        const uint64_t* partial = partials.data() + (t * batch + b) * cube_cells;
+                        for (size_t k = 0; k < cube_cells; k++) {
+                            sums[k] += partial[k];
+                        }
+                    }
+                    std::copy(sums.begin(), sums.begin() + cube_cells, counters);
+                    add_pseudocounts<n_decision_classes>(counters, num_of_cubes, p);
+                    timer.lap(RunPhase::Count);
+
+                    for (size_t k = 0; k < n_dimensions; ++k) {
+                        tuple[k] = variable_at(local_tuple[k]);
+                    }
+
+                    tuple_igs<n_decision_classes, n_dimensions, stat_mode>(
+                        counters, reduced,
+                        n_classes,
+                        local_tuple,
+                        num_of_cubes, num_of_cubes_reduced,
+                        total_counters,
+                        H_Y,
+                        H.data(),
+                        igs);
+                    timer.lap(RunPhase::Entropy);
+                    thread_stats.tuples_evaluated++;
+
+                    switch (out.type) {
+                        case MDFSOutputType::MaxIGs:
+                            #ifdef _OPENMP
+                            thread_out->updateMaxIG(tuple, igs, discretization_id);
+                            #else
+                            out.updateMaxIG(tuple, igs, discretization_id);
+                            #endif
+                            break;
+
+                        case MDFSOutputType::MatchingTuples:
+                            #ifdef _OPENMP
+                            #pragma omp critical (AddMatchingTuples)
+                            #endif
+                            for (size_t v = 0; v < n_dimensions; ++v) {
+                                if (igs[v] > ig_thr) {
+                                    out.addTuple(tuple[v], igs[v], discretization_id, tuple);
+                                }
+                            }
+                            break;
+
+                        case MDFSOutputType::AllTuples:
+                            if (mdfs_info.average) {
+                                out.addAllTuplesIG(tuple, igs, discretization_id);
+                            } else {
+                                out.updateAllTuplesIG(tuple, igs, discretization_id);
+                            }
+                            break;
+                    }
+                    timer.lap(RunPhase::Merge);
+                }
+
+                #ifdef _OPENMP
+                #pragma omp master
+                #endif
+                if (progress != nullptr) {
+                    progress->add(n_batch);
+                    progress->poll();
+                    stop_batches = progress->cancelled();
+                }
+
+                // the partial counters are overwritten by the next batch
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::Discretized);
+            } while (!stop_batches);
+        }
+
+        #ifdef _OPENMP
+        if (out.type == MDFSOutputType::MaxIGs) {
+            if (out.max_igs_tuples != nullptr) {
+                #pragma omp critical (SetOutput)
+                for (size_t i = 0; i < raw_data->info.variable_count; i++) {
+                    if ((*thread_out->max_igs)[i] > (*out.max_igs)[i]) {
+                        (*out.max_igs)[i] = (*thread_out->max_igs)[i];
+                        std::copy(thread_out->max_igs_tuples + n_dimensions * i,
+                                  thread_out->max_igs_tuples + n_dimensions * (i+1),
+                                  out.max_igs_tuples + n_dimensions * i);
+                        out.dids[i] = thread_out->dids[i];
+                    }
+                }
+                delete[] thread_out->max_igs_tuples;
+                delete[] thread_out->dids;
+            } else {
+                #pragma omp critical (SetOutput)
+                for (size_t i = 0; i < raw_data->info.variable_count; i++) {
+                    if ((*thread_out->max_igs)[i] > (*out.max_igs)[i]) {
+                        (*out.max_igs)[i] = (*thread_out->max_igs)[i];
+                    }
+                }
+            }
+            if (out.discretization_max_igs != nullptr) {
+                #pragma omp critical (SetDiscretizationOutput)
+                out.mergeDiscretizationMaxIGs(thread_out->discretization_max_igs);
+                delete[] thread_out->discretization_max_igs;
+            }
+            delete thread_out;
+            timer.lap(RunPhase::Merge);
+        }
+        #endif
+
+        if (out.run_stats != nullptr) {
+            out.run_stats->threads[omp_tidx] = thread_stats;
+        }
+
+        delete[] mini_counters;
+        delete[] reduced;
+        delete[] counters;
+    }
+
+    if (progress != nullptr) {
+        progress->finish();
+    }
+
+    delete[] decision;
+
+    // only 2D supported
+    if (out.type == MDFSOutputType::AllTuples && mdfs_info.average) {
+        for (size_t i = 0; i < raw_data->info.variable_count * raw_data->info.variable_count; i++) {
+            (*out.all_tuples)[i] /= mdfs_info.discretizations;
+        }
+    }
+
+    if (out.run_stats != nullptr) {
+        #ifdef _OPENMP
+        out.run_stats->threads.resize(run_numthr);
+        #endif
+        out.run_stats->wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+    }
+}
+
+#endif
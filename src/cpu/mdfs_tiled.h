@@ -0,0 +1,634 @@
+#ifndef MDFS_TILED_H
+#define MDFS_TILED_H
+
+#include "mdfs_cpu_kernel.h"
+
+#include "common.h"
+#include "dataset.h"
+#include "discretization_cache.h"
+#include "mdfs_discretize.h"
+#include "tile_store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+// Tiles that the variables of a tuple are drawn from, one per dimension, in
+// non-decreasing order (like the packs of the GPU scheduler) so that each
+// tuple belongs to exactly one pack. Variables are identified by positions
+// in the list of the variables in use.
+template <uint8_t n_dimensions>
+class TilePack {
+public:
+    size_t tiles[n_dimensions];
+    size_t first[n_dimensions];  // position of the first variable of the tile
+    size_t size[n_dimensions];  // number of variables in the tile
+    size_t slot[n_dimensions];  // where the tile is in the pack buffer (repeated tiles are stored once)
+
+    void set(const size_t* tiles, size_t tile_size, size_t n_positions) {
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            this->tiles[k] = tiles[k];
+            this->first[k] = tiles[k] * tile_size;
+            this->size[k] = std::min(tile_size, n_positions - this->first[k]);
+            this->slot[k] = this->sameTile(k) ? this->slot[k-1] : k;
+        }
+    }
+
+    inline bool sameTile(size_t k) const {
+        return k > 0 && this->tiles[k] == this->tiles[k-1];
+    }
+
+    // tuples of the pack as offsets of the variables within their tiles,
+    // increasing within a repeated tile; both return false when there are no more
+    inline bool begin(size_t* offsets) const {
+        offsets[0] = 0;
+        return this->resetFrom(0, offsets);
+    }
+
+    inline bool advance(size_t* offsets) const {
+        for (size_t k = n_dimensions; k-- > 0;) {
+            ++offsets[k];
+            if (this->resetFrom(k, offsets)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    // lowest offsets after the k-th one; false when these do not fit
+    inline bool resetFrom(size_t k, size_t* offsets) const {
+        for (size_t j = k; j < n_dimensions; ++j) {
+            if (j > k) {
+                offsets[j] = this->sameTile(j) ? offsets[j-1] + 1 : 0;
+            }
+            if (offsets[j] >= this->size[j]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+
+// Out-of-core variant of scalarMDFS (used when mdfs_info.tile_size is set):
+// in each discretization the variables are discretized tile by tile into
+// a TileStore and then the tuples are evaluated pack by pack. Only the tiles
+// of the current pack and of the next one (loaded in the background) are
+// kept in memory, i.e. at most 2 * n_dimensions * tile_size * object_count
+// bytes of discretized data. Lower entropies are reduced from the counters
+// of each tuple, so results are the same as of scalarMDFS without them
+// (lower_entropies_max_bytes = 0); in 3D+ they may differ from those with
+// them in rounding. Contrast variables are not supported.
+template <uint8_t n_decision_classes, uint8_t n_dimensions, StatMode stat_mode>
+void tiledMDFS(
+    const MDFSInfo& mdfs_info,
+    RawData* raw_data,
+    std::unique_ptr<const DiscretizationInfo> dfi,
+    MDFSOutput& out
+) {
+    const auto run_start = std::chrono::steady_clock::now();
+    #ifdef _OPENMP
+    int run_numthr = 1;
+    if (out.run_stats != nullptr) {
+        out.run_stats->threads.resize(omp_get_max_threads());
+    }
+    #else
+    if (out.run_stats != nullptr) {
+        out.run_stats->threads.resize(1);
+    }
+    #endif
+
+    const size_t n_objects = raw_data->info.object_count;
+
+    // variables in use, tuples are made of their positions in here
+    const bool only_interesting = mdfs_info.interesting_vars_count && mdfs_info.require_all_vars;
+    const size_t n_positions = only_interesting ? mdfs_info.interesting_vars_count : raw_data->info.variable_count;
+    auto variable_at = [&](size_t position) -> size_t {
+        return only_interesting ? mdfs_info.interesting_vars[position] : position;
+    };
+
+    const size_t tile_size = std::min(mdfs_info.tile_size, n_positions);
+    const size_t tile_bytes = tile_size * n_objects;
+    const size_t n_tiles = (n_positions + tile_size - 1) / tile_size;
+
+    TileStore store(mdfs_info.tile_dir, tile_bytes);
+
+    size_t c[n_decision_classes];
+    for (uint8_t i = 0; i < n_decision_classes; i++) {
+        c[i] = 0;
+    }
+    const int* weights = raw_data->weights;  // as in scalarMDFS
+    auto weight_of = [&](size_t i) -> size_t {
+        return weights != nullptr ? weights[i] : 1;
+    };
+
+    uint8_t* decision = nullptr;
+    if (n_decision_classes > 1) {
+        decision = new uint8_t[n_objects];
+        for (size_t i = 0; i < n_objects; i++) {
+            decision[i] = raw_data->decision[i];
+            c[decision[i]] += weight_of(i);
+        }
+    } else {
+        for (size_t i = 0; i < n_objects; i++) {
+            c[0] += weight_of(i);
+        }
+    }
+    const float cmin = *std::min_element(c, c+n_decision_classes);
+    // the total weight of the objects, see count_counters
+    const bool exact_in_float = std::accumulate(c, c+n_decision_classes, size_t(0)) <= float_exact_objects;
+
+    // as in scalarMDFS
+    const float ig_thr = mdfs_info.ig_thr > 0.0f ? mdfs_info.ig_thr : -std::numeric_limits<float>::infinity();
+
+    float p[n_decision_classes];
+    for (uint8_t i = 0; i < n_decision_classes; i++) {
+        p[i] = c[i] / cmin * mdfs_info.pseudo;
+    }
+
+    const size_t n_classes = mdfs_info.divisions + 1;
+    const size_t num_of_cubes = std::pow(n_classes, n_dimensions);
+    const size_t num_of_cubes_reduced = std::pow(n_classes, n_dimensions - 1);
+
+    const auto d2 = n_classes*n_classes;
+    const auto d3 = d2*n_classes;
+    const auto d4 = d3*n_classes;
+    const size_t d[3] = {d2, d3, d4};
+
+    float H_Y_counters[n_decision_classes];
+    for (uint8_t i = 0; i < n_decision_classes; i++) {
+        H_Y_counters[i] = c[i] + p[i] * num_of_cubes;
+    }
+    const float H_Y = conditional_entropy<n_decision_classes>(1, H_Y_counters);
+
+    const float total_counters = c[0] + p[0] * num_of_cubes;
+
+    // when at least one interesting variable is required in a tuple
+    std::vector<bool> interesting;
+    if (mdfs_info.interesting_vars_count && !mdfs_info.require_all_vars) {
+        interesting.assign(raw_data->info.variable_count, false);
+        for (size_t i = 0; i < mdfs_info.interesting_vars_count; i++) {
+            interesting[mdfs_info.interesting_vars[i]] = true;
+        }
+    }
+
+    // for the optimised 2D version, by position
+    std::vector<float> H;
+    if (n_dimensions == 2) {
+        H.resize(n_positions);
+        if (mdfs_info.I_lower != nullptr) {
+            for (size_t i = 0; i < n_positions; i++) {
+                if (n_decision_classes == 1) {
+                    H[i] = mdfs_info.I_lower[variable_at(i)];
+                } else {
+                    H[i] = H_Y - mdfs_info.I_lower[variable_at(i)];
+                }
+            }
+        }
+    }
+    const bool compute_H = n_dimensions == 2 && mdfs_info.I_lower == nullptr;
+
+    // the current pack and the next one; buffers of the first slots stage the tiles being discretized
+    TilePack<n_dimensions> packs[2];
+    std::vector<uint8_t> pack_data[2];
+    std::vector<float> pack_H[2];
+    for (int b = 0; b < 2; b++) {
+        pack_data[b].resize(n_dimensions * tile_bytes);
+        if (n_dimensions == 2) {
+            pack_H[b].resize(n_dimensions * tile_size);
+        }
+    }
+
+    // tiles of a pack are combinations with repetition, generated as combinations without
+    TupleGenerator<n_dimensions> pack_generator(n_tiles + n_dimensions - 1);
+    auto next_pack = [&](int b) {
+        size_t tiles[n_dimensions];
+        pack_generator.next(tiles);
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            tiles[k] -= k;
+        }
+        packs[b].set(tiles, tile_size, n_positions);
+    };
+
+    // tiles already in the other buffer (from >= 0) are copied instead of read
+    auto load_pack = [&](int b, int from) {
+        const TilePack<n_dimensions>& pack = packs[b];
+        for (size_t k = 0; k < n_dimensions; ++k) {
+            if (pack.sameTile(k)) {
+                continue;
+            }
+            uint8_t* tile_data = pack_data[b].data() + pack.slot[k] * tile_bytes;
+
+            size_t resident = n_dimensions;
+            if (from >= 0) {
+                for (size_t j = 0; j < n_dimensions; ++j) {
+                    if (packs[from].tiles[j] == pack.tiles[k]) {
+                        resident = packs[from].slot[j];
+                        break;
+                    }
+                }
+            }
+            if (resident < n_dimensions) {
+                std::memcpy(tile_data, pack_data[from].data() + resident * tile_bytes, pack.size[k] * n_objects);
+            } else {
+                store.read(pack.tiles[k], tile_data, pack.size[k] * n_objects);
+            }
+
+            if (n_dimensions == 2) {
+                std::copy(H.begin() + pack.first[k], H.begin() + pack.first[k] + pack.size[k],
+                          pack_H[b].begin() + pack.slot[k] * tile_size);
+            }
+        }
+    };
+
+    // as in scalarMDFS, by position
+    DiscretizationCache* const cache = dfi ? mdfs_info.cache : nullptr;
+    std::vector<DiscretizationCache::Key> cache_keys(cache != nullptr ? n_positions : 0);
+
+    ProgressMonitor* const progress = mdfs_info.progress;
+    if (progress != nullptr) {
+        progress->start(binomial(n_positions, n_dimensions) * mdfs_info.discretizations, (1 << 22) / n_objects + 1);
+    }
+
+    // shared state, changed by the master thread between barriers
+    bool stop_run = false;
+    bool packs_done = false;
+    int current = 0;
+    std::exception_ptr error;
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        #ifdef _OPENMP
+        const int omp_numthr = omp_get_num_threads();
+        const int omp_tidx = omp_get_thread_num();
+        #else
+        constexpr int omp_numthr = 1;
+        constexpr int omp_tidx = 0;
+        #endif
+
+        #ifdef _OPENMP
+        #pragma omp master
+        run_numthr = omp_numthr;
+        #endif
+
+        ThreadRunStats thread_stats;
+        PhaseTimer timer(out.run_stats != nullptr ? &thread_stats : nullptr);
+
+        uint64_t progress_pending = 0;
+
+        std::vector<double> column_buffer;  // for data stored as float
+
+        size_t offsets[n_dimensions];
+        size_t local_tuple[n_dimensions];  // in the pack buffer
+        size_t tuple[n_dimensions];
+        float igs[n_dimensions];
+        float* counters = new float[n_decision_classes * num_of_cubes];
+        uint64_t* exact_counters = exact_in_float ? nullptr : new uint64_t[n_decision_classes * num_of_cubes];  // of any tuple counted here
+        float* reduced = new float[n_decision_classes * num_of_cubes_reduced];
+
+        float* mini_counters = nullptr;
+        float mini_p[n_decision_classes];
+        uint64_t cache_context = 0;
+        if (compute_H) {
+            mini_counters = new float[n_decision_classes * n_classes];
+            for (uint8_t i = 0; i < n_decision_classes; i++) {
+                mini_p[i] = p[i] * num_of_cubes_reduced;
+            }
+            if (cache != nullptr) {
+                cache_context = DiscretizationCache::hashContext(decision, n_objects, mini_p, n_decision_classes);
+            }
+        }
+
+        #ifdef _OPENMP
+        MDFSOutput* thread_out = nullptr;
+        if (out.type == MDFSOutputType::MaxIGs) {
+            thread_out = new MDFSOutput(out.type, n_dimensions, raw_data->info.variable_count, 0);
+            if (out.max_igs_tuples != nullptr) {
+                thread_out->setMaxIGsTuples(new int[n_dimensions*raw_data->info.variable_count], new int[raw_data->info.variable_count]);
+            }
+            if (out.discretization_max_igs != nullptr) {
+                thread_out->setDiscretizationMaxIGs(new float[mdfs_info.discretizations * raw_data->info.variable_count],
+                                                    mdfs_info.discretizations);
+            }
+        }
+        #endif
+
+        for (size_t discretization_id = 0; discretization_id < mdfs_info.discretizations; discretization_id++) {
+            #ifdef _OPENMP
+            #pragma omp master
+            #endif
+            stop_run = (progress != nullptr && progress->cancelled()) || error;
+
+            #ifdef _OPENMP
+            #pragma omp barrier
+            #endif
+            timer.lap(RunBarrier::DiscretizationStart);
+
+            if (stop_run) {
+                break;
+            }
+
+            // tiles are staged alternately in two buffers so that discretizing
+            // the next one overlaps with the master thread storing the previous one
+            for (size_t t = 0; t < n_tiles; ++t) {
+                uint8_t* stage = pack_data[t % 2].data();
+                const size_t first = t * tile_size;
+                const size_t count = std::min(tile_size, n_positions - first);
+
+                for (size_t i = omp_tidx; i < count; i += omp_numthr) {
+                    const size_t v = variable_at(first + i);
+                    uint8_t* data_current_var = stage + i * n_objects;
+
+                    if (dfi) {
+                        // mapped data is read ahead by one variable
+                        if (first + i + omp_numthr < n_positions) {
+                            raw_data->willNeed(variable_at(first + i + omp_numthr));
+                        }
+                        discretize_variable(raw_data, v, v, discretization_id, *dfi, cache,
+                                            cache != nullptr ? &cache_keys[first + i] : nullptr,
+                                            column_buffer, data_current_var, timer);
+                        raw_data->doneWith(v);
+                    } else {
+                        copy_discrete_variable(raw_data, v, data_current_var);
+                    }
+                    timer.lap(RunPhase::Discretize);
+
+                    if (compute_H && !(cache != nullptr && cache->findLowerEntropy(cache_keys[first + i], cache_context, H[first + i]))) {
+                        count_counters<n_decision_classes, 1, false>(stage, nullptr, decision, n_objects, 0, &i, 0, mini_counters, exact_counters, n_classes, mini_p, nullptr, weights);
+                        timer.lap(RunPhase::Count);
+                        if (n_decision_classes == 1) {
+                            H[first + i] = entropy(total_counters, n_classes, mini_counters);
+                        } else {
+                            H[first + i] = conditional_entropy<n_decision_classes>(n_classes, mini_counters);
+                        }
+                        if (cache != nullptr) {
+                            cache->insertLowerEntropy(cache_keys[first + i], cache_context, H[first + i]);
+                        }
+                        timer.lap(RunPhase::Entropy);
+                    }
+
+                    if (progress != nullptr && omp_tidx == 0) {
+                        progress->poll();
+                    }
+                }
+
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::Discretized);
+
+                #ifdef _OPENMP
+                #pragma omp master
+                #endif
+                {
+                    try {
+                        store.write(t, stage, count * n_objects);
+                    } catch (...) {
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    timer.lap(RunPhase::Discretize);
+                }
+            }
+
+            #ifdef _OPENMP
+            #pragma omp master
+            #endif
+            {
+                pack_generator.reset();
+                current = 0;
+                next_pack(current);
+                try {
+                    load_pack(current, -1);
+                } catch (...) {
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                packs_done = false;
+                stop_run = bool(error);
+            }
+
+            #ifdef _OPENMP
+            #pragma omp barrier
+            #endif
+            timer.lap(RunBarrier::Discretized);
+
+            if (stop_run) {
+                break;
+            }
+
+            do {
+                std::future<void> prefetch;
+
+                #ifdef _OPENMP
+                #pragma omp master
+                #endif
+                if (pack_generator.hasNext()) {
+                    next_pack(1 - current);
+                    try {
+                        prefetch = std::async(std::launch::async, load_pack, 1 - current, current);
+                    } catch (...) {
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+
+                const TilePack<n_dimensions>& pack = packs[current];
+                const uint8_t* data = pack_data[current].data();
+                const float* pack_lower_H = n_dimensions == 2 ? pack_H[current].data() : nullptr;
+
+                // tuples of the pack are split among threads round-robin
+                uint64_t tuple_idx = 0;
+                for (bool has_tuple = pack.begin(offsets); has_tuple; has_tuple = pack.advance(offsets)) {
+                    if (tuple_idx++ % omp_numthr != (uint64_t) omp_tidx) {
+                        continue;
+                    }
+
+                    if (progress != nullptr && progress->step(progress_pending, 1, omp_tidx == 0)) {
+                        break;
+                    }
+
+                    for (size_t k = 0; k < n_dimensions; ++k) {
+                        tuple[k] = variable_at(pack.first[k] + offsets[k]);
+                        local_tuple[k] = pack.slot[k] * tile_size + offsets[k];
+                    }
+
+                    if (!interesting.empty() && std::none_of(tuple, tuple+n_dimensions, [&](size_t v) { return interesting[v]; })) {
+                        thread_stats.tuples_filtered++;
+                        continue;
+                    }
+
+                    process_tuple<n_decision_classes, n_dimensions, stat_mode>(
+                        data,
+                        decision,
+                        n_objects,
+                        weights,
+                        nullptr,  // tiles are dense
+                        nullptr,
+                        n_classes,
+                        local_tuple,
+                        counters, exact_counters, reduced,
+                        num_of_cubes, num_of_cubes_reduced,
+                        p,
+                        total_counters,
+                        d,
+                        H_Y,
+                        pack_lower_H,
+                        igs,
+                        timer);
+                    timer.lap(RunPhase::Entropy);
+                    thread_stats.tuples_evaluated++;
+
+                    switch (out.type) {
+                        case MDFSOutputType::MaxIGs:
+                            #ifdef _OPENMP
+                            thread_out->updateMaxIG(tuple, igs, discretization_id);
+                            #else
+                            out.updateMaxIG(tuple, igs, discretization_id);
+                            #endif
+                            break;
+
+                        case MDFSOutputType::MatchingTuples:
+                            #ifdef _OPENMP
+                            #pragma omp critical (AddMatchingTuples)
+                            #endif
+                            for (size_t v = 0; v < n_dimensions; ++v) {
+                                if (igs[v] > ig_thr) {
+                                    out.addTuple(tuple[v], igs[v], discretization_id, tuple);
+                                }
+                            }
+                            break;
+
+                        case MDFSOutputType::AllTuples:
+                            if (mdfs_info.average) {
+                                out.addAllTuplesIG(tuple, igs, discretization_id);
+                            } else {
+                                out.updateAllTuplesIG(tuple, igs, discretization_id);
+                            }
+                            break;
+                    }
+                    timer.lap(RunPhase::Merge);
+                }
+
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::Discretized);  // waiting for the tiles counts as waiting for discretized data
+
+                #ifdef _OPENMP
+                #pragma omp master
+                #endif
+                {
+                    if (prefetch.valid()) {
+                        try {
+                            prefetch.get();
+                        } catch (...) {
+                            if (!error) {
+                                error = std::current_exception();
+                            }
+                        }
+                        current = 1 - current;
+                    } else {
+                        packs_done = true;
+                    }
+                    stop_run = (progress != nullptr && progress->cancelled()) || error;
+                }
+
+                #ifdef _OPENMP
+                #pragma omp barrier
+                #endif
+                timer.lap(RunBarrier::Discretized);
+            } while (!packs_done && !stop_run);
+
+            if (progress != nullptr) {
+                progress->add(progress_pending);
+                progress_pending = 0;
+            }
+        }
+
+        #ifdef _OPENMP
+        if (out.type == MDFSOutputType::MaxIGs) {
+            if (out.max_igs_tuples != nullptr) {
+                #pragma omp critical (SetOutput)
+                for (size_t i = 0; i < raw_data->info.variable_count; i++) {
+                    if ((*thread_out->max_igs)[i] > (*out.max_igs)[i]) {
+                        (*out.max_igs)[i] = (*thread_out->max_igs)[i];
+                        std::copy(thread_out->max_igs_tuples + n_dimensions * i,
+                                  thread_out->max_igs_tuples + n_dimensions * (i+1),
+                                  out.max_igs_tuples + n_dimensions * i);
+                        out.dids[i] = thread_out->dids[i];
+                    }
+                }
+                delete[] thread_out->max_igs_tuples;
+                delete[] thread_out->dids;
+            } else {
+                #pragma omp critical (SetOutput)
+                for (size_t i = 0; i < raw_data->info.variable_count; i++) {
+                    if ((*thread_out->max_igs)[i] > (*out.max_igs)[i]) {
+                        (*out.max_igs)[i] = (*thread_out->max_igs)[i];
+                    }
+                }
+            }
+            if (out.discretization_max_igs != nullptr) {
+                #pragma omp critical (SetDiscretizationOutput)
+                out.mergeDiscretizationMaxIGs(thread_out->discretization_max_igs);
+                delete[] thread_out->discretization_max_igs;
+            }
+            delete thread_out;
+            timer.lap(RunPhase::Merge);
+        }
+        #endif
+
+        if (out.run_stats != nullptr) {
+            out.run_stats->threads[omp_tidx] = thread_stats;
+        }
+
+        delete[] mini_counters;
+        delete[] reduced;
+        delete[] exact_counters;
+        delete[] counters;
+    }
+
+    if (progress != nullptr) {
+        progress->finish();
+    }
+
+    delete[] decision;
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // only 2D supported
+    if (out.type == MDFSOutputType::AllTuples && mdfs_info.average) {
+        for (size_t i = 0; i < raw_data->info.variable_count * raw_data->info.variable_count; i++) {
+            (*out.all_tuples)[i] /= mdfs_info.discretizations;
+        }
+    }
+
+    if (out.run_stats != nullptr) {
+        #ifdef _OPENMP
+        out.run_stats->threads.resize(run_numthr);
+        #endif
+        out.run_stats->wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+    }
+}
+
+#endif
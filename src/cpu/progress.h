@@ -0,0 +1,106 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+// Shared by all engine threads. Work is accounted in tuples (contrast pairs
+// and the pairs of the 3D lower entropies table count as tuples too). Only
+// the master thread reports and checks for interruption so that the
+// callbacks may use a single-threaded API (like R's).
+class ProgressMonitor {
+public:
+    typedef void (*ReportCallback)(void* context, uint64_t done, uint64_t total, double tuples_per_second, bool finished);
+    typedef bool (*InterruptCallback)(void* context);  // returns true to cancel the run
+
+    ProgressMonitor(ReportCallback report, InterruptCallback interrupted, void* context)
+        : report(report), interrupted(interrupted), context(context), total(0), batch(1),
+          done(0), cancel_requested(false) {}
+
+    // total is the expected number of tuples, batch is the number of tuples
+    // a thread processes between synchronisations with the monitor
+    void start(uint64_t total, uint64_t batch) {
+        this->total = total;
+        this->batch = batch > 0 ? batch : 1;
+        this->done.store(0, std::memory_order_relaxed);
+        this->started = clock::now();
+        this->last_poll = this->started;
+        this->last_report = this->started;
+    }
+
+    inline void add(uint64_t n) {
+        this->done.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    inline bool cancelled() const {
+        return this->cancel_requested.load(std::memory_order_relaxed);
+    }
+
+    // called by every thread after each unit of work (pending is thread-local);
+    // returns whether the thread should stop
+    inline bool step(uint64_t& pending, uint64_t n, bool master) {
+        pending += n;
+        if (pending < this->batch) {
+            return false;
+        }
+        this->add(pending);
+        pending = 0;
+        if (master) {
+            this->poll();
+        }
+        return this->cancelled();
+    }
+
+    // master thread only
+    void poll() {
+        const clock::time_point now = clock::now();
+
+        if (this->interrupted != nullptr && now - this->last_poll >= poll_interval) {
+            this->last_poll = now;
+            if (this->interrupted(this->context)) {
+                this->cancel_requested.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        if (this->report != nullptr && now - this->last_report >= report_interval) {
+            this->last_report = now;
+            this->report(this->context, this->done.load(std::memory_order_relaxed), this->total, this->rate(now), false);
+        }
+    }
+
+    // master thread only, after all the other threads are done
+    void finish() {
+        if (this->report != nullptr) {
+            this->report(this->context, this->done.load(std::memory_order_relaxed), this->total, this->rate(clock::now()), true);
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    static constexpr std::chrono::milliseconds poll_interval{100};
+    static constexpr std::chrono::milliseconds report_interval{1000};
+
+    const ReportCallback report;
+    const InterruptCallback interrupted;
+    void* const context;
+
+    uint64_t total;
+    uint64_t batch;
+    clock::time_point started;
+    clock::time_point last_poll;
+    clock::time_point last_report;
+
+    std::atomic<uint64_t> done;
+    std::atomic<bool> cancel_requested;
+
+    double rate(clock::time_point now) const {
+        const double seconds = std::chrono::duration<double>(now - this->started).count();
+        return seconds > 0.0 ? this->done.load(std::memory_order_relaxed) / seconds : 0.0;
+    }
+};
+
+#endif
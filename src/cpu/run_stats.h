@@ -0,0 +1,75 @@
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// phases of a run that time is attributed to
+enum class RunPhase { Sort, Discretize, Count, Entropy, Contrast, Merge };
+constexpr size_t n_run_phases = 6;
+
+// barriers at which threads wait for each other (once per discretization)
+enum class RunBarrier { DiscretizationStart, Discretized, LowerEntropies };
+constexpr size_t n_run_barriers = 3;
+
+class ThreadRunStats {
+public:
+    double phase_seconds[n_run_phases] = {};
+    double barrier_seconds[n_run_barriers] = {};
+
+    uint64_t tuples_evaluated = 0;
+    uint64_t tuples_filtered = 0;  // skipped due to interesting vars
+    uint64_t tuples_pruned = 0;  // skipped as unable to change the result
+    uint64_t contrast_pairs = 0;  // (subtuple, contrast variable) pairs evaluated
+};
+
+class MDFSRunStats {
+public:
+    double wall_seconds = 0.0;
+    std::vector<ThreadRunStats> threads;
+};
+
+// attributes time elapsed since the previous mark to a phase or a barrier;
+// does nothing (not even reading the clock) when constructed with nullptr
+class PhaseTimer {
+    typedef std::chrono::steady_clock clock;
+
+    ThreadRunStats* stats;
+    clock::time_point last;
+
+public:
+    explicit PhaseTimer(ThreadRunStats* stats) : stats(stats) {
+        if (stats != nullptr) {
+            last = clock::now();
+        }
+    }
+
+    inline bool enabled() const {
+        return stats != nullptr;
+    }
+
+    inline void lap(RunPhase phase) {
+        if (stats != nullptr) {
+            stats->phase_seconds[static_cast<size_t>(phase)] += this->elapsed();
+        }
+    }
+
+    inline void lap(RunBarrier barrier) {
+        if (stats != nullptr) {
+            stats->barrier_seconds[static_cast<size_t>(barrier)] += this->elapsed();
+        }
+    }
+
+private:
+    inline double elapsed() {
+        const clock::time_point now = clock::now();
+        const double seconds = std::chrono::duration<double>(now - last).count();
+        last = now;
+        return seconds;
+    }
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "tile_store.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+static std::string temporary_directory() {
+    #ifdef _WIN32
+    const char* dir = std::getenv("TEMP");
+    return dir != nullptr ? dir : ".";
+    #else
+    const char* dir = std::getenv("TMPDIR");
+    return dir != nullptr ? dir : "/tmp";
+    #endif
+}
+
+bool open_temporary_file(const std::string& dir, const std::string& prefix, std::fstream& file, std::string& path) {
+    // unique within the process, the pid makes it unique among processes
+    static std::atomic<unsigned> file_counter(0);
+
+    const std::string stem = (dir.empty() ? temporary_directory() : dir) + "/" + prefix + "-" + std::to_string(getpid()) + "-";
+    for (unsigned attempt = 0; ; attempt++) {
+        path = stem + std::to_string(file_counter.fetch_add(1)) + ".tmp";
+        // O_EXCL fails on any existing name, links included
+        #ifdef _WIN32
+        const int fd = _open(path.c_str(), _O_CREAT | _O_EXCL | _O_RDWR | _O_BINARY, _S_IREAD | _S_IWRITE);
+        #else
+        const int fd = open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+        #endif
+        if (fd >= 0) {
+            #ifdef _WIN32
+            _close(fd);
+            #else
+            close(fd);
+            #endif
+            break;
+        }
+        if (errno != EEXIST || attempt >= 100) {
+            throw std::runtime_error("cannot create " + path);
+        }
+    }
+
+    file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) {
+        std::remove(path.c_str());
+        throw std::runtime_error("cannot create " + path);
+    }
+
+    #ifdef _WIN32
+    return true;  // open files cannot be removed
+    #else
+    std::remove(path.c_str());
+    return false;
+    #endif
+}
+
+TileStore::TileStore(const std::string& dir, size_t tile_bytes) : tile_bytes(tile_bytes) {
+    this->remove_file = open_temporary_file(dir, "mdfs-tiles", this->file, this->path);
+}
+
+TileStore::~TileStore() {
+    this->file.close();
+    if (this->remove_file) {
+        std::remove(this->path.c_str());
+    }
+}
+
+void TileStore::write(size_t tile, const uint8_t* data, size_t size) {
+    this->file.seekp(tile * this->tile_bytes);
+    this->file.write(reinterpret_cast<const char*>(data), size);
+    if (!this->file) {
+        throw std::runtime_error("cannot write " + this->path);
+    }
+}
+
+void TileStore::read(size_t tile, uint8_t* data, size_t size) {
+    // written data has to reach the file before it is read back
+    this->file.flush();
+    this->file.seekg(tile * this->tile_bytes);
+    this->file.read(reinterpret_cast<char*>(data), size);
+    if (!this->file) {
+        throw std::runtime_error("cannot read " + this->path);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// opens a new temporary file in dir (empty - the system temporary directory)
+// as file, path gets its name; the file is created for the owner only, never
+// through a name that exists (e.g. a link put in a shared directory), and is
+// removed right away where open files can be, otherwise the caller removes it
+// once closed (returns true); throws std::runtime_error
+bool open_temporary_file(const std::string& dir, const std::string& prefix, std::fstream& file, std::string& path);
+
+// Temporary file on local disk holding discretized variables in tiles of
+// equal size (the last one may be shorter), used by the out-of-core mode.
+// The file is gone once the store is destroyed.
+class TileStore {
+public:
+    // dir empty means the system temporary directory;
+    // throws std::runtime_error when the file cannot be created
+    TileStore(const std::string& dir, size_t tile_bytes);
+    ~TileStore();
+
+    TileStore(const TileStore&) = delete;
+    TileStore& operator=(const TileStore&) = delete;
+
+    // both throw std::runtime_error, size is at most tile_bytes
+    void write(size_t tile, const uint8_t* data, size_t size);
+    void read(size_t tile, uint8_t* data, size_t size);
+
+private:
+    std::string path;
+    std::fstream file;
+    bool remove_file;  // see open_temporary_file
+    const size_t tile_bytes;
+};
+
+#endif
@@ -6,11 +6,20 @@
 #define CALLDEF(name, n)  {#name, (DL_FUNC) &name, n}
 
 static const R_CallMethodDef callMethods[]  = {
-  CALLDEF(r_compute_max_ig, 13),
-  CALLDEF(r_compute_max_ig_discrete, 10),
-  CALLDEF(r_compute_all_matching_tuples, 15),
-  CALLDEF(r_compute_all_matching_tuples_discrete, 11),
+  CALLDEF(r_compute_max_ig, 18),
+  CALLDEF(r_compute_screened_max_ig, 14),
+  CALLDEF(r_compute_max_ig_decisions, 11),
+  CALLDEF(r_compute_max_ig_discrete, 15),
+  CALLDEF(r_compute_max_ig_replicates, 12),
+  CALLDEF(r_compute_max_ig_folds, 13),
+  CALLDEF(r_compute_all_matching_tuples, 17),
+  CALLDEF(r_compute_all_matching_tuples_discrete, 15),
   CALLDEF(r_discretize, 6),
+  CALLDEF(r_write_column_file, 4),
+  CALLDEF(r_column_file_info, 1),
+  CALLDEF(r_bed_file_info, 2),
+  CALLDEF(r_set_discretization_cache, 2),
+  CALLDEF(r_discretization_cache_stats, 0),
   CALLDEF(r_omp_set_num_threads, 1),
   {NULL, NULL, 0}
 };
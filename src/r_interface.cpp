@@ -1,11 +1,266 @@
 #include "r_interface.h"
 
-#include "cpu/mdfs.h"
+#include "cpu/api.h"
+#include "cpu/discretization_cache.h"
+#include "cpu/discretize.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <memory>
+#include <new>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifdef WITH_CUDA
 #include "gpu/cucubes.h"
 #endif
 
+// kept for the whole session, see SetDiscretizationCache
+static std::unique_ptr<DiscretizationCache> discretization_cache;
+
+static void check_user_interrupt(void* dummy) {
+    R_CheckUserInterrupt();
+}
+
+// R_CheckUserInterrupt longjmps on interrupt which must not happen over C++ frames
+static bool r_interrupted(void* context) {
+    return !R_ToplevelExec(check_user_interrupt, nullptr);
+}
+
+static void r_report_progress(void* context, uint64_t done, uint64_t total, double tuples_per_second, bool finished) {
+    const double percent = total > 0 ? 100.0 * done / total : 100.0;
+    const double eta = tuples_per_second > 0.0 && total > done ? (total - done) / tuples_per_second : 0.0;
+
+    REprintf("\rMDFS: %5.1f%% (%.0f/%.0f tuples, %.0f tuples/s, ETA %.0fs)  ",
+             percent, (double) done, (double) total, tuples_per_second, eta);
+    if (finished) {
+        REprintf("\n");
+    }
+}
+
+// 1 - H, 2 - MI, 3 - VI, as mapped in R
+static StatMode r_stat_mode(SEXP Rin_stat_mode) {
+    switch (Rf_asInteger(Rin_stat_mode)) {
+        case 1: return StatMode::Entropy;
+        case 2: return StatMode::MutualInformation;
+        case 3: return StatMode::VariationOfInformation;
+        default: Rf_error("Unknown statistic");
+    }
+}
+
+// run_mdfs throws on these, the errors have to be raised before any C++ object is alive
+static void r_check_mdfs_args(int variable_count, SEXP Rin_dimensions, StatMode stat_mode, bool with_decision) {
+    const int dimensions = Rf_asInteger(Rin_dimensions);
+    if (!mdfs_supported(dimensions, stat_mode, with_decision)) {
+        Rf_error("Statistic not supported in %d dimensions", dimensions);
+    }
+    if (variable_count < dimensions) {
+        Rf_error("Fewer variables than dimensions");
+    }
+}
+
+static ColumnFileHeader r_column_file_header(SEXP Rin_path) {
+    ColumnFileHeader header;
+
+    // exceptions must not reach R, the error is raised once the exception is gone
+    char message[512] = "";
+    try {
+        header = read_column_file_header(CHAR(STRING_ELT(Rin_path, 0)));
+    } catch (const std::exception& e) {
+        std::snprintf(message, sizeof(message), "%s", e.what());
+    }
+    if (message[0] != '\0') {
+        Rf_error("%s", message);
+    }
+
+    return header;
+}
+
+// continuous data is either a double matrix or the path of a column file;
+// objects are counted as long vectors (a column file may hold more than a
+// matrix), variables fit in int as the results are indexed by them
+static void r_data_dims(SEXP Rin_data, R_xlen_t& object_count, int& variable_count) {
+    if (Rf_isString(Rin_data)) {
+        const ColumnFileHeader header = r_column_file_header(Rin_data);
+        if (header.object_count > (uint64_t) R_XLEN_T_MAX || header.variable_count > (uint64_t) INT_MAX) {
+            Rf_error("Column file too large for R");
+        }
+        object_count = header.object_count;
+        variable_count = header.variable_count;
+    } else {
+        const int* dims = INTEGER(Rf_getAttrib(Rin_data, R_DimSymbol));
+        object_count = dims[0];
+        variable_count = dims[1];
+    }
+}
+
+// discrete data is either an integer (or raw) matrix or a list of its dimensions and
+// compressed sparse columns (columns, objects, values) or the path of a .bed
+// file (see prepare_discrete_data)
+static void r_discrete_data_dims(SEXP Rin_data, R_xlen_t& object_count, int& variable_count) {
+    const int* dims = Rf_isNewList(Rin_data) ?
+                      INTEGER(VECTOR_ELT(Rin_data, 0)) :
+                      INTEGER(Rf_getAttrib(Rin_data, R_DimSymbol));
+    object_count = dims[0];
+    variable_count = dims[1];
+}
+
+// a .bed file is mapped into mapped_bed, which stays empty on failure
+static RawData r_discrete_raw_data(SEXP Rin_data, R_xlen_t object_count, int variable_count, const int* decision,
+                                   std::unique_ptr<MappedBedFile>& mapped_bed) {
+    if (Rf_isNewList(Rin_data) && Rf_isString(VECTOR_ELT(Rin_data, 1))) {
+        char message[512] = "";
+        try {
+            mapped_bed.reset(new MappedBedFile(CHAR(STRING_ELT(VECTOR_ELT(Rin_data, 1), 0)), object_count));
+            if (mapped_bed->variableCount() != (size_t) variable_count) {
+                std::snprintf(message, sizeof(message), ".bed file changed while being opened");
+            } else if (packed_genotypes_missing(mapped_bed->genotypes(), object_count, variable_count)) {
+                // run_mdfs would throw
+                std::snprintf(message, sizeof(message), "Missing genotypes are not supported");
+            }
+        } catch (const std::exception& e) {
+            std::snprintf(message, sizeof(message), "%s", e.what());
+        }
+        if (message[0] != '\0') {
+            mapped_bed.reset();
+            Rf_error("%s", message);
+        }
+        return RawData(*mapped_bed, decision);
+    }
+    if (Rf_isNewList(Rin_data)) {
+        return RawData(RawDataInfo(object_count, variable_count),
+                       INTEGER(VECTOR_ELT(Rin_data, 1)), INTEGER(VECTOR_ELT(Rin_data, 2)), INTEGER(VECTOR_ELT(Rin_data, 3)),
+                       decision);
+    }
+    if (TYPEOF(Rin_data) == RAWSXP) {
+        return RawData(RawDataInfo(object_count, variable_count), (const uint8_t*) RAW(Rin_data), decision);
+    }
+    return RawData(RawDataInfo(object_count, variable_count), INTEGER(Rin_data), decision);
+}
+
+// maps the data given as column files (the pointers stay empty for matrices);
+// on failure nothing stays mapped when the R error is raised
+static void r_map_column_files(
+        SEXP Rin_data,
+        SEXP Rin_contrast_data,
+        R_xlen_t object_count,
+        int variable_count,
+        int contrast_variable_count,
+        std::unique_ptr<MappedColumnFile>& mapped_data,
+        std::unique_ptr<MappedColumnFile>& mapped_contrast_data)
+{
+    char message[512] = "";
+    try {
+        if (Rf_isString(Rin_data)) {
+            mapped_data.reset(new MappedColumnFile(CHAR(STRING_ELT(Rin_data, 0))));
+            if (mapped_data->header().object_count != (uint64_t) object_count
+                    || mapped_data->header().variable_count != (uint64_t) variable_count) {
+                std::snprintf(message, sizeof(message), "Column file changed while being opened");
+            }
+        }
+        if (Rf_isString(Rin_contrast_data)) {
+            mapped_contrast_data.reset(new MappedColumnFile(CHAR(STRING_ELT(Rin_contrast_data, 0))));
+            if (mapped_contrast_data->header().object_count != (uint64_t) object_count
+                    || mapped_contrast_data->header().variable_count != (uint64_t) contrast_variable_count) {
+                std::snprintf(message, sizeof(message), "Column file changed while being opened");
+            }
+        }
+    } catch (const std::exception& e) {
+        std::snprintf(message, sizeof(message), "%s", e.what());
+    }
+    if (message[0] != '\0') {
+        mapped_data.reset();
+        mapped_contrast_data.reset();
+        Rf_error("%s", message);
+    }
+}
+
+// the engine runs in body, which must not touch the R allocator: an R error
+// longjmps past the destructors of its C++ objects; hence the R results are
+// allocated before body, or after it from RRunResults; exceptions must not
+// reach R either, the error is raised once body is unwound
+template <typename Body>
+static void r_guarded(Body body) {
+    char message[512] = "";
+    try {
+        body();
+    } catch (const std::exception& e) {
+        std::snprintf(message, sizeof(message), "%s", e.what());
+    }
+    if (message[0] != '\0') {
+        Rf_error("%s", message);
+    }
+}
+
+// what a run leaves for the R results which cannot be allocated before it
+class RRunResults {
+public:
+    std::unique_ptr<MDFSOutput> output;  // when the count of the results is known only after the run
+    MDFSRunStats run_stats;
+    ScreeningResult screening;
+};
+
+static void r_free_run_results(SEXP Rin_run_results) {
+    delete static_cast<RRunResults*>(R_ExternalPtrAddr(Rin_run_results));
+    R_ClearExternalPtr(Rin_run_results);
+}
+
+// RRunResults held by an external pointer (to be protected) which frees them
+// when collected, so nothing leaks when allocating the R results fails
+static SEXP r_run_results() {
+    SEXP Rout_run_results = PROTECT(R_MakeExternalPtr(nullptr, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(Rout_run_results, r_free_run_results, TRUE);
+    RRunResults* run_results = new (std::nothrow) RRunResults();
+    if (run_results == nullptr) {
+        Rf_error("Out of memory");
+    }
+    R_SetExternalPtrAddr(Rout_run_results, run_results);
+    UNPROTECT(1);
+
+    return Rout_run_results;
+}
+
+static RRunResults& r_run_results_of(SEXP Rin_run_results) {
+    return *static_cast<RRunResults*>(R_ExternalPtrAddr(Rin_run_results));
+}
+
+// shaped into the final form in R (prepare_run_stats)
+static void set_run_stats_attrib(SEXP Rout_result, const MDFSRunStats& run_stats) {
+    const int n_threads = run_stats.threads.size();
+
+    SEXP Rout_phases = PROTECT(Rf_allocMatrix(REALSXP, n_threads, n_run_phases));
+    SEXP Rout_barriers = PROTECT(Rf_allocMatrix(REALSXP, n_threads, n_run_barriers));
+    SEXP Rout_counters = PROTECT(Rf_allocMatrix(REALSXP, n_threads, 3));
+
+    for (int t = 0; t < n_threads; t++) {
+        const ThreadRunStats& thread_stats = run_stats.threads[t];
+
+        for (size_t i = 0; i < n_run_phases; i++) {
+            REAL(Rout_phases)[i * n_threads + t] = thread_stats.phase_seconds[i];
+        }
+        for (size_t i = 0; i < n_run_barriers; i++) {
+            REAL(Rout_barriers)[i * n_threads + t] = thread_stats.barrier_seconds[i];
+        }
+        // as double because they easily overflow int
+        REAL(Rout_counters)[t] = thread_stats.tuples_evaluated;
+        REAL(Rout_counters)[n_threads + t] = thread_stats.tuples_filtered;
+        REAL(Rout_counters)[2 * n_threads + t] = thread_stats.contrast_pairs;
+    }
+
+    SEXP Rout_run_stats = PROTECT(Rf_allocVector(VECSXP, 4));
+    SET_VECTOR_ELT(Rout_run_stats, 0, Rf_ScalarReal(run_stats.wall_seconds));
+    SET_VECTOR_ELT(Rout_run_stats, 1, Rout_phases);
+    SET_VECTOR_ELT(Rout_run_stats, 2, Rout_barriers);
+    SET_VECTOR_ELT(Rout_run_stats, 3, Rout_counters);
+
+    Rf_setAttrib(Rout_result, Rf_install("run.stats"), Rout_run_stats);
+
+    UNPROTECT(4);
+}
+
 extern "C"
 SEXP r_compute_max_ig(
         SEXP Rin_data,
@@ -20,7 +275,12 @@ SEXP r_compute_max_ig(
         SEXP Rin_interesting_vars,
         SEXP Rin_require_all_vars,
         SEXP Rin_return_tuples,
-        SEXP Rin_use_cuda)
+        SEXP Rin_use_cuda,
+        SEXP Rin_collect_run_stats,
+        SEXP Rin_progress,
+        SEXP Rin_contrast_indices,
+        SEXP Rin_return_discretizations,
+        SEXP Rin_lower_entropies_max_bytes)
 {
     #ifndef WITH_CUDA
     if (Rf_asLogical(Rin_use_cuda)) {
@@ -28,21 +288,40 @@ SEXP r_compute_max_ig(
     }
     #endif
 
-    const int* dataDims = INTEGER(Rf_getAttrib(Rin_data, R_DimSymbol));
-    int* contrastDataDims = nullptr;
-    if (!Rf_isNull(Rin_contrast_data)) {
-        contrastDataDims = INTEGER(Rf_getAttrib(Rin_contrast_data, R_DimSymbol));
-    }
-
-    const int obj_count = dataDims[0];
-    const int variable_count = dataDims[1];
+    R_xlen_t obj_count;
+    int variable_count;
+    r_data_dims(Rin_data, obj_count, variable_count);
     int contrast_variable_count = 0;
     if (!Rf_isNull(Rin_contrast_data)) {
-        contrast_variable_count = contrastDataDims[1];
+        R_xlen_t contrast_obj_count;
+        r_data_dims(Rin_contrast_data, contrast_obj_count, contrast_variable_count);
+        if (contrast_obj_count != obj_count) {
+            Rf_error("Contrast data has a different number of objects");
+        }
     }
+    // contrast variables permuted in the engine from these (0-based) variables
+    const bool has_contrast_indices = !Rf_isNull(Rin_contrast_indices);
+    if (has_contrast_indices) {
+        if (!Rf_isNull(Rin_contrast_data)) {
+            Rf_error("Contrast data and contrast indices are mutually exclusive");
+        }
+        contrast_variable_count = Rf_length(Rin_contrast_indices);
+        for (int i = 0; i < contrast_variable_count; i++) {
+            if (INTEGER(Rin_contrast_indices)[i] < 0 || INTEGER(Rin_contrast_indices)[i] >= variable_count) {
+                Rf_error("Contrast index out of range");
+            }
+        }
+    }
+    const bool has_contrast = !Rf_isNull(Rin_contrast_data) || has_contrast_indices;
+
+    r_check_mdfs_args(variable_count, Rin_dimensions, StatMode::MutualInformation, true);
 
     #ifdef WITH_CUDA
     if (Rf_asLogical(Rin_use_cuda)) {
+        if (Rf_isString(Rin_data)) {
+            Rf_error("CUDA acceleration does not support column files");
+        }
+
         SEXP Rout_max_igs = PROTECT(Rf_allocVector(REALSXP, variable_count));
 
         try {
@@ -77,95 +356,531 @@ SEXP r_compute_max_ig(
     }
     #endif
 
+    const int dimensions = Rf_asInteger(Rin_dimensions);
     const int discretizations = Rf_asInteger(Rin_discretizations);
     const int divisions = Rf_asInteger(Rin_divisions);
 
     const int* decision = INTEGER(Rin_decision);
 
-    RawData rawdata(RawDataInfo(obj_count, variable_count), REAL(Rin_data), decision);
-    RawData* contrast_rawdata = nullptr;
-    if (!Rf_isNull(Rin_contrast_data)) {
-        contrast_rawdata = new RawData(RawDataInfo(obj_count, contrast_variable_count), REAL(Rin_contrast_data), nullptr);
-    }
-
-    std::unique_ptr<const DiscretizationInfo> dfi(new DiscretizationInfo(
-        Rf_asInteger(Rin_seed),
-        discretizations,
-        divisions,
-        Rf_asReal(Rin_range)
-    ));
-
-    MDFSInfo mdfs_info(
-        Rf_asInteger(Rin_dimensions),
-        divisions,
-        discretizations,
-        Rf_asReal(Rin_pseudocount),
-        0.0f,
-        INTEGER(Rin_interesting_vars),
-        Rf_length(Rin_interesting_vars),
-        Rf_asLogical(Rin_require_all_vars),
-        nullptr,
-        false
-    );
-
-    SEXP Rout_max_igs = PROTECT(Rf_allocVector(REALSXP, variable_count));
+    const bool return_tuples = Rf_asLogical(Rin_return_tuples);
+    const bool return_discretizations = Rf_asLogical(Rin_return_discretizations);
+    const bool collect_run_stats = Rf_asLogical(Rin_collect_run_stats);
+
+    // the results are allocated before the run (see r_guarded)
+    const int result_members_count = 1 + 2 * return_tuples + has_contrast;
+    SEXP Rout_result = PROTECT(Rf_allocVector(VECSXP, result_members_count));
+
+    SEXP Rout_max_igs = Rf_allocVector(REALSXP, variable_count);
+    SET_VECTOR_ELT(Rout_result, 0, Rout_max_igs);
     SEXP Rout_contrast_max_igs = nullptr;
     SEXP Rout_tuples = nullptr;
     SEXP Rout_dids = nullptr;
+    SEXP Rout_discretization_igs = nullptr;
 
-    if (!Rf_isNull(Rin_contrast_data)) {
-        Rout_contrast_max_igs = PROTECT(Rf_allocVector(REALSXP, contrast_variable_count));
+    if (return_tuples) {
+        Rout_tuples = Rf_allocMatrix(INTSXP, dimensions, variable_count);
+        SET_VECTOR_ELT(Rout_result, 1, Rout_tuples);
+        Rout_dids = Rf_allocVector(INTSXP, variable_count);
+        SET_VECTOR_ELT(Rout_result, 2, Rout_dids);
     }
 
-    const bool return_tuples = Rf_asLogical(Rin_return_tuples);
-    MDFSOutput mdfs_output(MDFSOutputType::MaxIGs, mdfs_info.dimensions, variable_count, contrast_variable_count);
-    if (return_tuples) {
-        Rout_tuples = PROTECT(Rf_allocMatrix(INTSXP, mdfs_info.dimensions, variable_count));
-        Rout_dids = PROTECT(Rf_allocVector(INTSXP, variable_count));
-        mdfs_output.setMaxIGsTuples(INTEGER(Rout_tuples), INTEGER(Rout_dids)); // tuples are set row-first during computation, we transpose the result in R to speed up C code
+    if (has_contrast) {
+        Rout_contrast_max_igs = Rf_allocVector(REALSXP, contrast_variable_count);
+        SET_VECTOR_ELT(Rout_result, 1 + 2 * return_tuples, Rout_contrast_max_igs);
     }
 
-    mdfs[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, contrast_rawdata, std::move(dfi), mdfs_output);
+    if (return_discretizations) {
+        // by discretization, then variable - a variables x discretizations matrix in R
+        Rout_discretization_igs = PROTECT(Rf_allocMatrix(REALSXP, variable_count, discretizations));
+        Rf_setAttrib(Rout_result, Rf_install("discretization.igs"), Rout_discretization_igs);
+        UNPROTECT(1);
+    }
 
-    mdfs_output.copyMaxIGsAsDouble(REAL(Rout_max_igs));
+    SEXP Rout_run_results = PROTECT(collect_run_stats ? r_run_results() : R_NilValue);
+
+    bool cancelled = false;
+    r_guarded([&]() {
+        std::unique_ptr<MappedColumnFile> mapped_data;
+        std::unique_ptr<MappedColumnFile> mapped_contrast_data;
+        r_map_column_files(Rin_data, Rin_contrast_data, obj_count, variable_count, contrast_variable_count,
+                           mapped_data, mapped_contrast_data);
+
+        RawData rawdata = mapped_data
+            ? RawData(*mapped_data, decision)
+            : RawData(RawDataInfo(obj_count, variable_count), REAL(Rin_data), decision);
+        std::unique_ptr<RawData> contrast_rawdata;
+        if (mapped_contrast_data) {
+            contrast_rawdata.reset(new RawData(*mapped_contrast_data, nullptr));
+        } else if (!Rf_isNull(Rin_contrast_data)) {
+            contrast_rawdata.reset(new RawData(RawDataInfo(obj_count, contrast_variable_count), REAL(Rin_contrast_data), nullptr));
+        }
 
-    int result_members_count = 1;
+        std::unique_ptr<const DiscretizationInfo> dfi(new DiscretizationInfo(
+            Rf_asInteger(Rin_seed),
+            discretizations,
+            divisions,
+            Rf_asReal(Rin_range)
+        ));
+
+        MDFSInfo mdfs_info(
+            dimensions,
+            divisions,
+            discretizations,
+            Rf_asReal(Rin_pseudocount),
+            0.0f,
+            INTEGER(Rin_interesting_vars),
+            Rf_length(Rin_interesting_vars),
+            Rf_asLogical(Rin_require_all_vars),
+            nullptr,
+            false
+        );
+
+        mdfs_info.lower_entropies_max_bytes = Rf_asReal(Rin_lower_entropies_max_bytes);
+
+        if (has_contrast_indices) {
+            mdfs_info.contrast_sources = INTEGER(Rin_contrast_indices);
+            mdfs_info.contrast_sources_count = contrast_variable_count;
+            mdfs_info.contrast_seed = Rf_asInteger(Rin_seed);
+        }
 
-    if (return_tuples) {
-        result_members_count += 1; // for tuples
-        result_members_count += 1; // for disc nr
+        MDFSOutput mdfs_output(MDFSOutputType::MaxIGs, dimensions, variable_count, contrast_variable_count);
+        if (return_tuples) {
+            mdfs_output.setMaxIGsTuples(INTEGER(Rout_tuples), INTEGER(Rout_dids)); // tuples are set row-first during computation, we transpose the result in R to speed up C code
+        }
+
+        std::vector<float> discretization_igs;
+        if (return_discretizations) {
+            discretization_igs.resize(size_t(discretizations) * variable_count);
+            mdfs_output.setDiscretizationMaxIGs(discretization_igs.data(), discretizations);
+        }
+
+        if (collect_run_stats) {
+            mdfs_output.setRunStats(&r_run_results_of(Rout_run_results).run_stats);
+        }
+
+        ProgressMonitor progress(Rf_asLogical(Rin_progress) ? r_report_progress : nullptr, r_interrupted, nullptr);
+        mdfs_info.progress = &progress;
+        mdfs_info.cache = discretization_cache.get();
+
+        run_mdfs(mdfs_info, &rawdata, contrast_rawdata.get(), std::move(dfi), StatMode::MutualInformation, mdfs_output);
+
+        cancelled = progress.cancelled();
+        if (cancelled) {
+            return;
+        }
+
+        mdfs_output.copyMaxIGsAsDouble(REAL(Rout_max_igs));
+        if (has_contrast) {
+            mdfs_output.copyContrastMaxIGsAsDouble(REAL(Rout_contrast_max_igs));
+        }
+        if (return_discretizations) {
+            std::copy(discretization_igs.begin(), discretization_igs.end(), REAL(Rout_discretization_igs));
+        }
+    });
+
+    if (cancelled) {
+        // nothing is returned, the R wrapper reports the interruption
+        UNPROTECT(2);
+        return R_NilValue;
     }
 
-    if (!Rf_isNull(Rin_contrast_data)) {
-        mdfs_output.copyContrastMaxIGsAsDouble(REAL(Rout_contrast_max_igs));
-        result_members_count += 1;
+    if (collect_run_stats) {
+        set_run_stats_attrib(Rout_result, r_run_results_of(Rout_run_results).run_stats);
+        r_free_run_results(Rout_run_results);
+    }
+
+    UNPROTECT(2);
+
+    return Rout_result;
+}
+
+extern "C"
+SEXP r_compute_screened_max_ig(
+        SEXP Rin_data,
+        SEXP Rin_decision,
+        SEXP Rin_dimensions,
+        SEXP Rin_divisions,
+        SEXP Rin_discretizations,
+        SEXP Rin_seed,
+        SEXP Rin_range,
+        SEXP Rin_pseudocount,
+        SEXP Rin_screen_dimensions,
+        SEXP Rin_screen_top,
+        SEXP Rin_screen_partners,
+        SEXP Rin_require_all_vars,
+        SEXP Rin_return_tuples,
+        SEXP Rin_progress)
+{
+    R_xlen_t obj_count;
+    int variable_count;
+    r_data_dims(Rin_data, obj_count, variable_count);
+
+    r_check_mdfs_args(variable_count, Rin_dimensions, StatMode::MutualInformation, true);
+    r_check_mdfs_args(variable_count, Rin_screen_dimensions, StatMode::MutualInformation, true);
+    // more cannot be selected, partners only add to them
+    if (Rf_asLogical(Rin_require_all_vars) && std::min(Rf_asInteger(Rin_screen_top), variable_count) < Rf_asInteger(Rin_dimensions)) {
+        Rf_error("Fewer selected variables than dimensions");
     }
 
+    const int dimensions = Rf_asInteger(Rin_dimensions);
+    const int discretizations = Rf_asInteger(Rin_discretizations);
+    const int divisions = Rf_asInteger(Rin_divisions);
+
+    const int* decision = INTEGER(Rin_decision);
+
+    const bool return_tuples = Rf_asLogical(Rin_return_tuples);
+
+    // the results of a known size are allocated before the run (see r_guarded)
+    const int result_members_count = 4 + 2 * return_tuples;
     SEXP Rout_result = PROTECT(Rf_allocVector(VECSXP, result_members_count));
+
+    SEXP Rout_max_igs = Rf_allocVector(REALSXP, variable_count);
     SET_VECTOR_ELT(Rout_result, 0, Rout_max_igs);
+    SEXP Rout_tuples = nullptr;
+    SEXP Rout_dids = nullptr;
 
     if (return_tuples) {
+        Rout_tuples = Rf_allocMatrix(INTSXP, dimensions, variable_count);
         SET_VECTOR_ELT(Rout_result, 1, Rout_tuples);
+        Rout_dids = Rf_allocVector(INTSXP, variable_count);
         SET_VECTOR_ELT(Rout_result, 2, Rout_dids);
     }
 
-    if (!Rf_isNull(Rin_contrast_data)) {
+    SEXP Rout_run_results = PROTECT(r_run_results());
+    ScreeningResult& screening = r_run_results_of(Rout_run_results).screening;
+
+    bool cancelled = false;
+    r_guarded([&]() {
+        std::unique_ptr<MappedColumnFile> mapped_data;
+        std::unique_ptr<MappedColumnFile> mapped_contrast_data;
+        r_map_column_files(Rin_data, R_NilValue, obj_count, variable_count, 0,
+                           mapped_data, mapped_contrast_data);
+
+        RawData rawdata = mapped_data
+            ? RawData(*mapped_data, decision)
+            : RawData(RawDataInfo(obj_count, variable_count), REAL(Rin_data), decision);
+
+        std::unique_ptr<const DiscretizationInfo> dfi(new DiscretizationInfo(
+            Rf_asInteger(Rin_seed),
+            discretizations,
+            divisions,
+            Rf_asReal(Rin_range)
+        ));
+
+        MDFSInfo mdfs_info(
+            dimensions,
+            divisions,
+            discretizations,
+            Rf_asReal(Rin_pseudocount),
+            0.0f,
+            nullptr,
+            0,
+            Rf_asLogical(Rin_require_all_vars),
+            nullptr,
+            false
+        );
+
+        ScreeningInfo screening_info;
+        screening_info.dimensions = Rf_asInteger(Rin_screen_dimensions);
+        screening_info.top = Rf_asInteger(Rin_screen_top);
+        screening_info.partners = Rf_asLogical(Rin_screen_partners);
+
+        MDFSOutput mdfs_output(MDFSOutputType::MaxIGs, dimensions, variable_count, 0);
         if (return_tuples) {
-            SET_VECTOR_ELT(Rout_result, 3, Rout_contrast_max_igs);
-        } else {
-            SET_VECTOR_ELT(Rout_result, 1, Rout_contrast_max_igs);
+            mdfs_output.setMaxIGsTuples(INTEGER(Rout_tuples), INTEGER(Rout_dids)); // transposed in R like in r_compute_max_ig
         }
-    }
 
-    UNPROTECT(1 + result_members_count);
+        ProgressMonitor progress(Rf_asLogical(Rin_progress) ? r_report_progress : nullptr, r_interrupted, nullptr);
+        mdfs_info.progress = &progress;
+        mdfs_info.cache = discretization_cache.get();
 
-    if (!Rf_isNull(Rin_contrast_data)) {
-        delete contrast_rawdata;
+        run_screened_mdfs(mdfs_info, screening_info, &rawdata, std::move(dfi), screening, mdfs_output);
+
+        cancelled = progress.cancelled();
+        if (cancelled) {
+            return;
+        }
+
+        mdfs_output.copyMaxIGsAsDouble(REAL(Rout_max_igs));
+    });
+
+    if (cancelled) {
+        // nothing is returned, the R wrapper reports the interruption
+        UNPROTECT(2);
+        return R_NilValue;
     }
 
+    SEXP Rout_screen_max_igs = Rf_allocVector(REALSXP, variable_count);
+    SET_VECTOR_ELT(Rout_result, 1 + 2 * return_tuples, Rout_screen_max_igs);
+    std::copy(screening.max_igs.begin(), screening.max_igs.end(), REAL(Rout_screen_max_igs));
+    SEXP Rout_selected = Rf_allocVector(INTSXP, screening.selected.size());
+    SET_VECTOR_ELT(Rout_result, 2 + 2 * return_tuples, Rout_selected);
+    std::copy(screening.selected.begin(), screening.selected.end(), INTEGER(Rout_selected));
+    // as double because it easily overflows int
+    SET_VECTOR_ELT(Rout_result, 3 + 2 * return_tuples, Rf_ScalarReal(screening.tuples));
+
+    r_free_run_results(Rout_run_results);
+
+    UNPROTECT(2);
+
     return Rout_result;
 }
 
+extern "C"
+SEXP r_compute_max_ig_decisions(
+        SEXP Rin_data,
+        SEXP Rin_decisions,
+        SEXP Rin_dimensions,
+        SEXP Rin_divisions,
+        SEXP Rin_discretizations,
+        SEXP Rin_seed,
+        SEXP Rin_range,
+        SEXP Rin_pseudocount,
+        SEXP Rin_interesting_vars,
+        SEXP Rin_require_all_vars,
+        SEXP Rin_progress)
+{
+    R_xlen_t obj_count;
+    int variable_count;
+    r_data_dims(Rin_data, obj_count, variable_count);
+
+    r_check_mdfs_args(variable_count, Rin_dimensions, StatMode::MutualInformation, true);
+
+    // a matrix of objects by decisions, each of 0 and 1 (prepared in R)
+    const int decision_count = INTEGER(Rf_getAttrib(Rin_decisions, R_DimSymbol))[1];
+    if (decision_count < 1) {
+        Rf_error("At least one decision is required");
+    }
+
+    const int discretizations = Rf_asInteger(Rin_discretizations);
+    const int divisions = Rf_asInteger(Rin_divisions);
+
+    // variables by decisions, as the engine stores them
+    SEXP Rout_max_igs = PROTECT(Rf_allocMatrix(REALSXP, variable_count, decision_count));
+
+    bool cancelled = false;
+    r_guarded([&]() {
+        std::unique_ptr<MappedColumnFile> mapped_data;
+        std::unique_ptr<MappedColumnFile> mapped_contrast_data;
+        r_map_column_files(Rin_data, R_NilValue, obj_count, variable_count, 0,
+                           mapped_data, mapped_contrast_data);
+
+        RawData rawdata = mapped_data
+            ? RawData(*mapped_data, nullptr)
+            : RawData(RawDataInfo(obj_count, variable_count), REAL(Rin_data), nullptr);
+
+        std::unique_ptr<const DiscretizationInfo> dfi(new DiscretizationInfo(
+            Rf_asInteger(Rin_seed),
+            discretizations,
+            divisions,
+            Rf_asReal(Rin_range)
+        ));
+
+        MDFSInfo mdfs_info(
+            Rf_asInteger(Rin_dimensions),
+            divisions,
+            discretizations,
+            Rf_asReal(Rin_pseudocount),
+            0.0f,
+            INTEGER(Rin_interesting_vars),
+            Rf_length(Rin_interesting_vars),
+            Rf_asLogical(Rin_require_all_vars),
+            nullptr,
+            false
+        );
+
+        ProgressMonitor progress(Rf_asLogical(Rin_progress) ? r_report_progress : nullptr, r_interrupted, nullptr);
+        mdfs_info.progress = &progress;
+        mdfs_info.cache = discretization_cache.get();
+
+        std::vector<float> max_igs;
+        run_mdfs_decisions(mdfs_info, &rawdata, INTEGER(Rin_decisions), decision_count, std::move(dfi), max_igs);
+
+        cancelled = progress.cancelled();
+        if (cancelled) {
+            return;
+        }
+
+        std::copy(max_igs.begin(), max_igs.end(), REAL(Rout_max_igs));
+    });
+
+    UNPROTECT(1);
+
+    // nothing is returned when cancelled, the R wrapper reports the interruption
+    return cancelled ? R_NilValue : Rout_max_igs;
+}
+
+extern "C"
+SEXP r_compute_max_ig_replicates(
+        SEXP Rin_data,
+        SEXP Rin_decision,
+        SEXP Rin_weights,
+        SEXP Rin_dimensions,
+        SEXP Rin_divisions,
+        SEXP Rin_discretizations,
+        SEXP Rin_seed,
+        SEXP Rin_range,
+        SEXP Rin_pseudocount,
+        SEXP Rin_interesting_vars,
+        SEXP Rin_require_all_vars,
+        SEXP Rin_progress)
+{
+    R_xlen_t obj_count;
+    int variable_count;
+    r_data_dims(Rin_data, obj_count, variable_count);
+
+    r_check_mdfs_args(variable_count, Rin_dimensions, StatMode::MutualInformation, true);
+
+    // a matrix of objects by replicates, of multiplicities (prepared in R)
+    const int replicate_count = INTEGER(Rf_getAttrib(Rin_weights, R_DimSymbol))[1];
+    if (replicate_count < 1) {
+        Rf_error("At least one replicate is required");
+    }
+
+    const int discretizations = Rf_asInteger(Rin_discretizations);
+    const int divisions = Rf_asInteger(Rin_divisions);
+
+    // variables by replicates, as the engine stores them
+    SEXP Rout_max_igs = PROTECT(Rf_allocMatrix(REALSXP, variable_count, replicate_count));
+
+    bool cancelled = false;
+    r_guarded([&]() {
+        std::unique_ptr<MappedColumnFile> mapped_data;
+        std::unique_ptr<MappedColumnFile> mapped_contrast_data;
+        r_map_column_files(Rin_data, R_NilValue, obj_count, variable_count, 0,
+                           mapped_data, mapped_contrast_data);
+
+        RawData rawdata = mapped_data
+            ? RawData(*mapped_data, INTEGER(Rin_decision))
+            : RawData(RawDataInfo(obj_count, variable_count), REAL(Rin_data), INTEGER(Rin_decision));
+
+        std::unique_ptr<const DiscretizationInfo> dfi(new DiscretizationInfo(
+            Rf_asInteger(Rin_seed),
+            discretizations,
+            divisions,
+            Rf_asReal(Rin_range)
+        ));
+
+        MDFSInfo mdfs_info(
+            Rf_asInteger(Rin_dimensions),
+            divisions,
+            discretizations,
+            Rf_asReal(Rin_pseudocount),
+            0.0f,
+            INTEGER(Rin_interesting_vars),
+            Rf_length(Rin_interesting_vars),
+            Rf_asLogical(Rin_require_all_vars),
+            nullptr,
+            false
+        );
+
+        ProgressMonitor progress(Rf_asLogical(Rin_progress) ? r_report_progress : nullptr, r_interrupted, nullptr);
+        mdfs_info.progress = &progress;
+        mdfs_info.cache = discretization_cache.get();
+
+        std::vector<float> max_igs;
+        run_mdfs_replicates(mdfs_info, &rawdata, INTEGER(Rin_weights), replicate_count, std::move(dfi), max_igs);
+
+        cancelled = progress.cancelled();
+        if (cancelled) {
+            return;
+        }
+
+        std::copy(max_igs.begin(), max_igs.end(), REAL(Rout_max_igs));
+    });
+
+    UNPROTECT(1);
+
+    // nothing is returned when cancelled, the R wrapper reports the interruption
+    return cancelled ? R_NilValue : Rout_max_igs;
+}
+
+extern "C"
+SEXP r_compute_max_ig_folds(
+        SEXP Rin_data,
+        SEXP Rin_decision,
+        SEXP Rin_folds,
+        SEXP Rin_fold_count,
+        SEXP Rin_dimensions,
+        SEXP Rin_divisions,
+        SEXP Rin_discretizations,
+        SEXP Rin_seed,
+        SEXP Rin_range,
+        SEXP Rin_pseudocount,
+        SEXP Rin_interesting_vars,
+        SEXP Rin_require_all_vars,
+        SEXP Rin_progress)
+{
+    R_xlen_t obj_count;
+    int variable_count;
+    r_data_dims(Rin_data, obj_count, variable_count);
+
+    r_check_mdfs_args(variable_count, Rin_dimensions, StatMode::MutualInformation, true);
+
+    // folds from 0 (prepared in R)
+    const int fold_count = Rf_asInteger(Rin_fold_count);
+    if (fold_count < 2) {
+        Rf_error("At least two folds are required");
+    }
+
+    const int discretizations = Rf_asInteger(Rin_discretizations);
+    const int divisions = Rf_asInteger(Rin_divisions);
+
+    // variables by folds (left out), as the engine stores them
+    SEXP Rout_max_igs = PROTECT(Rf_allocMatrix(REALSXP, variable_count, fold_count));
+
+    bool cancelled = false;
+    r_guarded([&]() {
+        std::unique_ptr<MappedColumnFile> mapped_data;
+        std::unique_ptr<MappedColumnFile> mapped_contrast_data;
+        r_map_column_files(Rin_data, R_NilValue, obj_count, variable_count, 0,
+                           mapped_data, mapped_contrast_data);
+
+        RawData rawdata = mapped_data
+            ? RawData(*mapped_data, INTEGER(Rin_decision))
+            : RawData(RawDataInfo(obj_count, variable_count), REAL(Rin_data), INTEGER(Rin_decision));
+
+        std::unique_ptr<const DiscretizationInfo> dfi(new DiscretizationInfo(
+            Rf_asInteger(Rin_seed),
+            discretizations,
+            divisions,
+            Rf_asReal(Rin_range)
+        ));
+
+        MDFSInfo mdfs_info(
+            Rf_asInteger(Rin_dimensions),
+            divisions,
+            discretizations,
+            Rf_asReal(Rin_pseudocount),
+            0.0f,
+            INTEGER(Rin_interesting_vars),
+            Rf_length(Rin_interesting_vars),
+            Rf_asLogical(Rin_require_all_vars),
+            nullptr,
+            false
+        );
+
+        ProgressMonitor progress(Rf_asLogical(Rin_progress) ? r_report_progress : nullptr, r_interrupted, nullptr);
+        mdfs_info.progress = &progress;
+        mdfs_info.cache = discretization_cache.get();
+
+        std::vector<float> max_igs;
+        run_mdfs_folds(mdfs_info, &rawdata, INTEGER(Rin_folds), fold_count, std::move(dfi), max_igs);
+
+        cancelled = progress.cancelled();
+        if (cancelled) {
+            return;
+        }
+
+        std::copy(max_igs.begin(), max_igs.end(), REAL(Rout_max_igs));
+    });
+
+    UNPROTECT(1);
+
+    // nothing is returned when cancelled, the R wrapper reports the interruption
+    return cancelled ? R_NilValue : Rout_max_igs;
+}
+
 extern "C"
 SEXP r_compute_max_ig_discrete(
         SEXP Rin_data,
@@ -177,7 +892,12 @@ SEXP r_compute_max_ig_discrete(
         SEXP Rin_interesting_vars,
         SEXP Rin_require_all_vars,
         SEXP Rin_return_tuples,
-        SEXP Rin_use_cuda)
+        SEXP Rin_use_cuda,
+        SEXP Rin_collect_run_stats,
+        SEXP Rin_progress,
+        SEXP Rin_weights,
+        SEXP Rin_deduplicate,
+        SEXP Rin_lower_entropies_max_bytes)
 {
     #ifndef WITH_CUDA
     if (Rf_asLogical(Rin_use_cuda)) {
@@ -185,18 +905,21 @@ SEXP r_compute_max_ig_discrete(
     }
     #endif
 
-    const int* dataDims = INTEGER(Rf_getAttrib(Rin_data, R_DimSymbol));
     int* contrastDataDims = nullptr;
     if (!Rf_isNull(Rin_contrast_data)) {
         contrastDataDims = INTEGER(Rf_getAttrib(Rin_contrast_data, R_DimSymbol));
     }
 
-    const int obj_count = dataDims[0];
-    const int variable_count = dataDims[1];
+    R_xlen_t obj_count;
+    int variable_count;
+    r_discrete_data_dims(Rin_data, obj_count, variable_count);
     int contrast_variable_count = 0;
     if (!Rf_isNull(Rin_contrast_data)) {
         contrast_variable_count = contrastDataDims[1];
     }
+    const bool has_contrast = !Rf_isNull(Rin_contrast_data);
+
+    r_check_mdfs_args(variable_count, Rin_dimensions, StatMode::MutualInformation, true);
 
     #ifdef WITH_CUDA
     if (Rf_asLogical(Rin_use_cuda)) {
@@ -204,84 +927,103 @@ SEXP r_compute_max_ig_discrete(
     }
     #endif
 
+    const int dimensions = Rf_asInteger(Rin_dimensions);
     const int divisions = Rf_asInteger(Rin_divisions);
 
     const int* decision = INTEGER(Rin_decision);
 
-    RawData rawdata(RawDataInfo(obj_count, variable_count), INTEGER(Rin_data), decision);
-    RawData* contrast_rawdata = nullptr;
-    if (!Rf_isNull(Rin_contrast_data)) {
-        contrast_rawdata = new RawData(RawDataInfo(obj_count, contrast_variable_count), INTEGER(Rin_contrast_data), nullptr);
-    }
-
-    MDFSInfo mdfs_info(
-        Rf_asInteger(Rin_dimensions),
-        divisions,
-        1, // only one discretization
-        Rf_asReal(Rin_pseudocount),
-        0.0f,
-        INTEGER(Rin_interesting_vars),
-        Rf_length(Rin_interesting_vars),
-        Rf_asLogical(Rin_require_all_vars),
-        nullptr,
-        false
-    );
-
-    SEXP Rout_max_igs = PROTECT(Rf_allocVector(REALSXP, variable_count));
+    const bool return_tuples = Rf_asLogical(Rin_return_tuples);
+    const bool collect_run_stats = Rf_asLogical(Rin_collect_run_stats);
+
+    // the results are allocated before the run (see r_guarded)
+    const int result_members_count = 1 + 2 * return_tuples + has_contrast;
+    SEXP Rout_result = PROTECT(Rf_allocVector(VECSXP, result_members_count));
+
+    SEXP Rout_max_igs = Rf_allocVector(REALSXP, variable_count);
+    SET_VECTOR_ELT(Rout_result, 0, Rout_max_igs);
     SEXP Rout_contrast_max_igs = nullptr;
     SEXP Rout_tuples = nullptr;
     SEXP Rout_dids = nullptr;
 
-    if (!Rf_isNull(Rin_contrast_data)) {
-        Rout_contrast_max_igs = PROTECT(Rf_allocVector(REALSXP, contrast_variable_count));
+    if (return_tuples) {
+        Rout_tuples = Rf_allocMatrix(INTSXP, dimensions, variable_count);
+        SET_VECTOR_ELT(Rout_result, 1, Rout_tuples);
+        Rout_dids = Rf_allocVector(INTSXP, variable_count);
+        SET_VECTOR_ELT(Rout_result, 2, Rout_dids);
     }
 
-    const bool return_tuples = Rf_asLogical(Rin_return_tuples);
-    MDFSOutput mdfs_output(MDFSOutputType::MaxIGs, mdfs_info.dimensions, variable_count, contrast_variable_count);
-    if (return_tuples) {
-        Rout_tuples = PROTECT(Rf_allocMatrix(INTSXP, mdfs_info.dimensions, variable_count));
-        Rout_dids = PROTECT(Rf_allocVector(INTSXP, variable_count));
-        mdfs_output.setMaxIGsTuples(INTEGER(Rout_tuples), INTEGER(Rout_dids)); // tuples are set row-first during computation, we transpose the result in R to speed up C code
+    if (has_contrast) {
+        Rout_contrast_max_igs = Rf_allocVector(REALSXP, contrast_variable_count);
+        SET_VECTOR_ELT(Rout_result, 1 + 2 * return_tuples, Rout_contrast_max_igs);
     }
 
-    mdfs[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, contrast_rawdata, nullptr, mdfs_output);
+    SEXP Rout_run_results = PROTECT(collect_run_stats ? r_run_results() : R_NilValue);
 
-    mdfs_output.copyMaxIGsAsDouble(REAL(Rout_max_igs));
+    bool cancelled = false;
+    r_guarded([&]() {
+        std::unique_ptr<MappedBedFile> mapped_bed;
+        RawData rawdata = r_discrete_raw_data(Rin_data, obj_count, variable_count, decision, mapped_bed);
+        if (!Rf_isNull(Rin_weights)) {
+            rawdata.weights = INTEGER(Rin_weights);
+        }
+        std::unique_ptr<RawData> contrast_rawdata;
+        if (has_contrast) {
+            contrast_rawdata.reset(new RawData(RawDataInfo(obj_count, contrast_variable_count), INTEGER(Rin_contrast_data), nullptr));
+        }
 
-    int result_members_count = 1;
+        MDFSInfo mdfs_info(
+            dimensions,
+            divisions,
+            1, // only one discretization
+            Rf_asReal(Rin_pseudocount),
+            0.0f,
+            INTEGER(Rin_interesting_vars),
+            Rf_length(Rin_interesting_vars),
+            Rf_asLogical(Rin_require_all_vars),
+            nullptr,
+            false
+        );
+
+        MDFSOutput mdfs_output(MDFSOutputType::MaxIGs, dimensions, variable_count, contrast_variable_count);
+        if (return_tuples) {
+            mdfs_output.setMaxIGsTuples(INTEGER(Rout_tuples), INTEGER(Rout_dids)); // tuples are set row-first during computation, we transpose the result in R to speed up C code
+        }
 
-    if (return_tuples) {
-        result_members_count += 1; // for tuples
-        result_members_count += 1; // for disc nr
-    }
+        if (collect_run_stats) {
+            mdfs_output.setRunStats(&r_run_results_of(Rout_run_results).run_stats);
+        }
 
-    if (!Rf_isNull(Rin_contrast_data)) {
-        mdfs_output.copyContrastMaxIGsAsDouble(REAL(Rout_contrast_max_igs));
-        result_members_count += 1;
-    }
+        ProgressMonitor progress(Rf_asLogical(Rin_progress) ? r_report_progress : nullptr, r_interrupted, nullptr);
+        mdfs_info.progress = &progress;
+        mdfs_info.deduplicate = Rf_asLogical(Rin_deduplicate);
+        mdfs_info.lower_entropies_max_bytes = Rf_asReal(Rin_lower_entropies_max_bytes);
 
-    SEXP Rout_result = PROTECT(Rf_allocVector(VECSXP, result_members_count));
-    SET_VECTOR_ELT(Rout_result, 0, Rout_max_igs);
+        run_mdfs(mdfs_info, &rawdata, contrast_rawdata.get(), nullptr, StatMode::MutualInformation, mdfs_output);
 
-    if (return_tuples) {
-        SET_VECTOR_ELT(Rout_result, 1, Rout_tuples);
-        SET_VECTOR_ELT(Rout_result, 2, Rout_dids);
-    }
+        cancelled = progress.cancelled();
+        if (cancelled) {
+            return;
+        }
 
-    if (!Rf_isNull(Rin_contrast_data)) {
-        if (return_tuples) {
-            SET_VECTOR_ELT(Rout_result, 3, Rout_contrast_max_igs);
-        } else {
-            SET_VECTOR_ELT(Rout_result, 1, Rout_contrast_max_igs);
+        mdfs_output.copyMaxIGsAsDouble(REAL(Rout_max_igs));
+        if (has_contrast) {
+            mdfs_output.copyContrastMaxIGsAsDouble(REAL(Rout_contrast_max_igs));
         }
-    }
+    });
 
-    UNPROTECT(1 + result_members_count);
+    if (cancelled) {
+        // nothing is returned, the R wrapper reports the interruption
+        UNPROTECT(2);
+        return R_NilValue;
+    }
 
-    if (!Rf_isNull(Rin_contrast_data)) {
-        delete contrast_rawdata;
+    if (collect_run_stats) {
+        set_run_stats_attrib(Rout_result, r_run_results_of(Rout_run_results).run_stats);
+        r_free_run_results(Rout_run_results);
     }
 
+    UNPROTECT(2);
+
     return Rout_result;
 }
 
@@ -301,13 +1043,18 @@ SEXP r_compute_all_matching_tuples(
         SEXP Rin_I_lower,
         SEXP Rin_return_matrix,
         SEXP Rin_stat_mode,
-        SEXP Rin_average)
+        SEXP Rin_average,
+        SEXP Rin_collect_run_stats,
+        SEXP Rin_progress)
 {
-    const int* dataDims = INTEGER(Rf_getAttrib(Rin_data, R_DimSymbol));
+    R_xlen_t obj_count;
+    int variable_count;
+    r_data_dims(Rin_data, obj_count, variable_count);
 
-    const int obj_count = dataDims[0];
-    const int variable_count = dataDims[1];
+    const StatMode stat_mode = r_stat_mode(Rin_stat_mode);
+    r_check_mdfs_args(variable_count, Rin_dimensions, stat_mode, !Rf_isNull(Rin_decision));
 
+    const int dimensions = Rf_asInteger(Rin_dimensions);
     const int discretizations = Rf_asInteger(Rin_discretizations);
     const int divisions = Rf_asInteger(Rin_divisions);
 
@@ -316,91 +1063,106 @@ SEXP r_compute_all_matching_tuples(
         decision = INTEGER(Rin_decision);
     }
 
-    RawData rawdata(RawDataInfo(obj_count, variable_count), REAL(Rin_data), decision);
-
-    std::unique_ptr<const DiscretizationInfo> dfi(new DiscretizationInfo(
-        Rf_asInteger(Rin_seed),
-        discretizations,
-        divisions,
-        Rf_asReal(Rin_range)
-    ));
-
-    const double* I_lower = nullptr;
-    if (!Rf_isNull(Rin_I_lower)) {
-        I_lower = REAL(Rin_I_lower);
-    }
-
-    MDFSInfo mdfs_info(
-        Rf_asInteger(Rin_dimensions),
-        divisions,
-        discretizations,
-        Rf_asReal(Rin_pseudocount),
-        Rf_asReal(Rin_ig_thr),
-        INTEGER(Rin_interesting_vars),
-        Rf_length(Rin_interesting_vars),
-        Rf_asLogical(Rin_require_all_vars),
-        I_lower,
-        Rf_asLogical(Rin_average)
-    );
-
-    MDFSOutputType out_type = mdfs_info.dimensions == 2 && Rf_asReal(Rin_ig_thr) <= 0.0 && Rf_length(Rin_interesting_vars) == 0 ? MDFSOutputType::AllTuples : MDFSOutputType::MatchingTuples;
-    MDFSOutput mdfs_output(out_type, mdfs_info.dimensions, variable_count, 0);
-
-    if (Rf_isNull(Rin_decision)) {
-        switch (Rf_asInteger(Rin_stat_mode)) {
-            case 1: mdfsEntropy[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, std::move(dfi), mdfs_output);
-            break;
-            case 2: mdfsMutualInformation[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, std::move(dfi), mdfs_output);
-            break;
-            case 3: mdfsVariationOfInformation[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, std::move(dfi), mdfs_output);
-            break;
-            default: Rf_error("Unknown statistic");
+    const bool collect_run_stats = Rf_asLogical(Rin_collect_run_stats);
+
+    // the count of the results is known only after the run (see r_guarded)
+    SEXP Rout_run_results = PROTECT(r_run_results());
+    RRunResults& run_results = r_run_results_of(Rout_run_results);
+
+    bool cancelled = false;
+    r_guarded([&]() {
+        std::unique_ptr<MappedColumnFile> mapped_data;
+        std::unique_ptr<MappedColumnFile> no_contrast_data;
+        r_map_column_files(Rin_data, R_NilValue, obj_count, variable_count, 0, mapped_data, no_contrast_data);
+
+        RawData rawdata = mapped_data
+            ? RawData(*mapped_data, decision)
+            : RawData(RawDataInfo(obj_count, variable_count), REAL(Rin_data), decision);
+
+        std::unique_ptr<const DiscretizationInfo> dfi(new DiscretizationInfo(
+            Rf_asInteger(Rin_seed),
+            discretizations,
+            divisions,
+            Rf_asReal(Rin_range)
+        ));
+
+        const double* I_lower = nullptr;
+        if (!Rf_isNull(Rin_I_lower)) {
+            I_lower = REAL(Rin_I_lower);
         }
-    } else {
-        switch (Rf_asInteger(Rin_stat_mode)) {
-            case 1: mdfsDecisionConditionalEntropy[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, std::move(dfi), mdfs_output);
-            break;
-            case 2: mdfs[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, std::move(dfi), mdfs_output);
-            break;
-            case 3: mdfsDecisionConditionalVariationOfInformation[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, std::move(dfi), mdfs_output);
-            break;
-            default: Rf_error("Unknown statistic");
+
+        MDFSInfo mdfs_info(
+            dimensions,
+            divisions,
+            discretizations,
+            Rf_asReal(Rin_pseudocount),
+            Rf_asReal(Rin_ig_thr),
+            INTEGER(Rin_interesting_vars),
+            Rf_length(Rin_interesting_vars),
+            Rf_asLogical(Rin_require_all_vars),
+            I_lower,
+            Rf_asLogical(Rin_average)
+        );
+
+        run_results.output.reset(new MDFSOutput(tuples_output_type(mdfs_info), dimensions, variable_count, 0));
+        MDFSOutput& mdfs_output = *run_results.output;
+
+        if (collect_run_stats) {
+            mdfs_output.setRunStats(&run_results.run_stats);
         }
-    }
 
-    if (out_type == MDFSOutputType::AllTuples && Rf_asLogical(Rin_return_matrix)) {
-        SEXP Rout_result = PROTECT(Rf_allocMatrix(REALSXP, variable_count, variable_count));
+        ProgressMonitor progress(Rf_asLogical(Rin_progress) ? r_report_progress : nullptr, r_interrupted, nullptr);
+        mdfs_info.progress = &progress;
+        mdfs_info.cache = discretization_cache.get();
 
-        // TODO: perhaps we could avoid copying here at all and fill in this matrix already from the mdfs?
-        mdfs_output.copyAllTuplesMatrix(REAL(Rout_result));
+        run_mdfs(mdfs_info, &rawdata, nullptr, std::move(dfi), stat_mode, mdfs_output);
 
+        cancelled = progress.cancelled();
+    });
+
+    if (cancelled) {
+        // nothing is returned, the R wrapper reports the interruption
         UNPROTECT(1);
+        return R_NilValue;
+    }
 
-        return Rout_result;
+    const MDFSOutput& mdfs_output = *run_results.output;
+    SEXP Rout_result = nullptr;
+
+    if (mdfs_output.type == MDFSOutputType::AllTuples && Rf_asLogical(Rin_return_matrix)) {
+        Rout_result = PROTECT(Rf_allocMatrix(REALSXP, variable_count, variable_count));
+
+        // TODO: perhaps we could avoid copying here at all and fill in this matrix already from the mdfs?
+        mdfs_output.copyAllTuplesMatrix(REAL(Rout_result));
     } else {
         const int result_members_count = 3;
         // 2D only now
-        const int tuples_count = out_type == MDFSOutputType::AllTuples ? variable_count * (variable_count - 1) : mdfs_output.getMatchingTuplesCount();
+        const R_xlen_t tuples_count = mdfs_output.type == MDFSOutputType::AllTuples ? R_xlen_t(variable_count) * (variable_count - 1) : mdfs_output.getMatchingTuplesCount();
 
-        SEXP Rout_igs = PROTECT(Rf_allocVector(REALSXP, tuples_count));
-        SEXP Rout_tuples = PROTECT(Rf_allocMatrix(INTSXP, tuples_count, mdfs_info.dimensions));
-        SEXP Rout_vars = PROTECT(Rf_allocVector(INTSXP, tuples_count));
+        Rout_result = PROTECT(Rf_allocVector(VECSXP, result_members_count));
+        SEXP Rout_vars = Rf_allocVector(INTSXP, tuples_count);
+        SET_VECTOR_ELT(Rout_result, 0, Rout_vars);
+        SEXP Rout_tuples = Rf_allocMatrix(INTSXP, tuples_count, dimensions);
+        SET_VECTOR_ELT(Rout_result, 1, Rout_tuples);
+        SEXP Rout_igs = Rf_allocVector(REALSXP, tuples_count);
+        SET_VECTOR_ELT(Rout_result, 2, Rout_igs);
 
-        if (out_type == MDFSOutputType::AllTuples) {
+        if (mdfs_output.type == MDFSOutputType::AllTuples) {
             mdfs_output.copyAllTuples(INTEGER(Rout_vars), REAL(Rout_igs), INTEGER(Rout_tuples));
         } else {
             mdfs_output.copyMatchingTuples(INTEGER(Rout_vars), REAL(Rout_igs), INTEGER(Rout_tuples));
         }
+    }
 
-        SEXP Rout_result = PROTECT(Rf_allocVector(VECSXP, result_members_count));
-        SET_VECTOR_ELT(Rout_result, 0, Rout_vars);
-        SET_VECTOR_ELT(Rout_result, 1, Rout_tuples);
-        SET_VECTOR_ELT(Rout_result, 2, Rout_igs);
+    if (collect_run_stats) {
+        set_run_stats_attrib(Rout_result, run_results.run_stats);
+    }
 
-        UNPROTECT(1 + result_members_count);
+    r_free_run_results(Rout_run_results);
 
-        return Rout_result;
-    }
+    UNPROTECT(2);
+
+    return Rout_result;
 }
 
 extern "C"
@@ -415,13 +1177,20 @@ SEXP r_compute_all_matching_tuples_discrete(
         SEXP Rin_ig_thr,
         SEXP Rin_I_lower,
         SEXP Rin_return_matrix,
-        SEXP Rin_stat_mode)
+        SEXP Rin_stat_mode,
+        SEXP Rin_collect_run_stats,
+        SEXP Rin_progress,
+        SEXP Rin_weights,
+        SEXP Rin_deduplicate)
 {
-    const int* dataDims = INTEGER(Rf_getAttrib(Rin_data, R_DimSymbol));
+    R_xlen_t obj_count;
+    int variable_count;
+    r_discrete_data_dims(Rin_data, obj_count, variable_count);
 
-    const int obj_count = dataDims[0];
-    const int variable_count = dataDims[1];
+    const StatMode stat_mode = r_stat_mode(Rin_stat_mode);
+    r_check_mdfs_args(variable_count, Rin_dimensions, stat_mode, !Rf_isNull(Rin_decision));
 
+    const int dimensions = Rf_asInteger(Rin_dimensions);
     const int divisions = Rf_asInteger(Rin_divisions);
 
     const int* decision = nullptr;
@@ -429,84 +1198,97 @@ SEXP r_compute_all_matching_tuples_discrete(
         decision = INTEGER(Rin_decision);
     }
 
-    RawData rawdata(RawDataInfo(obj_count, variable_count), INTEGER(Rin_data), decision);
-
-    const double* I_lower = nullptr;
-    if (!Rf_isNull(Rin_I_lower)) {
-        I_lower = REAL(Rin_I_lower);
-    }
+    const bool collect_run_stats = Rf_asLogical(Rin_collect_run_stats);
 
-    MDFSInfo mdfs_info(
-        Rf_asInteger(Rin_dimensions),
-        divisions,
-        1, // only one discretization
-        Rf_asReal(Rin_pseudocount),
-        Rf_asReal(Rin_ig_thr),
-        INTEGER(Rin_interesting_vars),
-        Rf_length(Rin_interesting_vars),
-        Rf_asLogical(Rin_require_all_vars),
-        I_lower,
-        false
-    );
+    // the count of the results is known only after the run (see r_guarded)
+    SEXP Rout_run_results = PROTECT(r_run_results());
+    RRunResults& run_results = r_run_results_of(Rout_run_results);
 
-    MDFSOutputType out_type = mdfs_info.dimensions == 2 && Rf_asReal(Rin_ig_thr) <= 0.0 && Rf_length(Rin_interesting_vars) == 0 ? MDFSOutputType::AllTuples : MDFSOutputType::MatchingTuples;
-    MDFSOutput mdfs_output(out_type, mdfs_info.dimensions, variable_count, 0);
+    bool cancelled = false;
+    r_guarded([&]() {
+        std::unique_ptr<MappedBedFile> mapped_bed;
+        RawData rawdata = r_discrete_raw_data(Rin_data, obj_count, variable_count, decision, mapped_bed);
+        if (!Rf_isNull(Rin_weights)) {
+            rawdata.weights = INTEGER(Rin_weights);
+        }
 
-    if (Rf_isNull(Rin_decision)) {
-        switch (Rf_asInteger(Rin_stat_mode)) {
-            case 1: mdfsEntropy[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, nullptr, mdfs_output);
-            break;
-            case 2: mdfsMutualInformation[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, nullptr, mdfs_output);
-            break;
-            case 3: mdfsVariationOfInformation[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, nullptr, mdfs_output);
-            break;
-            default: Rf_error("Unknown statistic");
+        const double* I_lower = nullptr;
+        if (!Rf_isNull(Rin_I_lower)) {
+            I_lower = REAL(Rin_I_lower);
         }
-    } else {
-        switch (Rf_asInteger(Rin_stat_mode)) {
-            case 1: mdfsDecisionConditionalEntropy[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, nullptr, mdfs_output);
-            break;
-            case 2: mdfs[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, nullptr, mdfs_output);
-            break;
-            case 3: mdfsDecisionConditionalVariationOfInformation[Rf_asInteger(Rin_dimensions)-1](mdfs_info, &rawdata, nullptr, nullptr, mdfs_output);
-            break;
-            default: Rf_error("Unknown statistic");
+
+        MDFSInfo mdfs_info(
+            dimensions,
+            divisions,
+            1, // only one discretization
+            Rf_asReal(Rin_pseudocount),
+            Rf_asReal(Rin_ig_thr),
+            INTEGER(Rin_interesting_vars),
+            Rf_length(Rin_interesting_vars),
+            Rf_asLogical(Rin_require_all_vars),
+            I_lower,
+            false
+        );
+
+        run_results.output.reset(new MDFSOutput(tuples_output_type(mdfs_info), dimensions, variable_count, 0));
+        MDFSOutput& mdfs_output = *run_results.output;
+
+        if (collect_run_stats) {
+            mdfs_output.setRunStats(&run_results.run_stats);
         }
-    }
 
-    if (out_type == MDFSOutputType::AllTuples && Rf_asLogical(Rin_return_matrix)) {
-        SEXP Rout_result = PROTECT(Rf_allocMatrix(REALSXP, variable_count, variable_count));
+        ProgressMonitor progress(Rf_asLogical(Rin_progress) ? r_report_progress : nullptr, r_interrupted, nullptr);
+        mdfs_info.progress = &progress;
+        mdfs_info.deduplicate = Rf_asLogical(Rin_deduplicate);
 
-        // TODO: perhaps we could avoid copying here at all and fill in this matrix already from the mdfs?
-        mdfs_output.copyAllTuplesMatrix(REAL(Rout_result));
+        run_mdfs(mdfs_info, &rawdata, nullptr, nullptr, stat_mode, mdfs_output);
+
+        cancelled = progress.cancelled();
+    });
 
+    if (cancelled) {
+        // nothing is returned, the R wrapper reports the interruption
         UNPROTECT(1);
+        return R_NilValue;
+    }
 
-        return Rout_result;
+    const MDFSOutput& mdfs_output = *run_results.output;
+    SEXP Rout_result = nullptr;
+
+    if (mdfs_output.type == MDFSOutputType::AllTuples && Rf_asLogical(Rin_return_matrix)) {
+        Rout_result = PROTECT(Rf_allocMatrix(REALSXP, variable_count, variable_count));
+
+        // TODO: perhaps we could avoid copying here at all and fill in this matrix already from the mdfs?
+        mdfs_output.copyAllTuplesMatrix(REAL(Rout_result));
     } else {
         const int result_members_count = 3;
         // 2D only now
-        const int tuples_count = out_type == MDFSOutputType::AllTuples ? variable_count * (variable_count - 1) : mdfs_output.getMatchingTuplesCount();
+        const R_xlen_t tuples_count = mdfs_output.type == MDFSOutputType::AllTuples ? R_xlen_t(variable_count) * (variable_count - 1) : mdfs_output.getMatchingTuplesCount();
 
-        SEXP Rout_igs = PROTECT(Rf_allocVector(REALSXP, tuples_count));
-        SEXP Rout_tuples = PROTECT(Rf_allocMatrix(INTSXP, tuples_count, mdfs_info.dimensions));
-        SEXP Rout_vars = PROTECT(Rf_allocVector(INTSXP, tuples_count));
+        Rout_result = PROTECT(Rf_allocVector(VECSXP, result_members_count));
+        SEXP Rout_vars = Rf_allocVector(INTSXP, tuples_count);
+        SET_VECTOR_ELT(Rout_result, 0, Rout_vars);
+        SEXP Rout_tuples = Rf_allocMatrix(INTSXP, tuples_count, dimensions);
+        SET_VECTOR_ELT(Rout_result, 1, Rout_tuples);
+        SEXP Rout_igs = Rf_allocVector(REALSXP, tuples_count);
+        SET_VECTOR_ELT(Rout_result, 2, Rout_igs);
 
-        if (out_type == MDFSOutputType::AllTuples) {
+        if (mdfs_output.type == MDFSOutputType::AllTuples) {
             mdfs_output.copyAllTuples(INTEGER(Rout_vars), REAL(Rout_igs), INTEGER(Rout_tuples));
         } else {
             mdfs_output.copyMatchingTuples(INTEGER(Rout_vars), REAL(Rout_igs), INTEGER(Rout_tuples));
         }
+    }
 
-        SEXP Rout_result = PROTECT(Rf_allocVector(VECSXP, result_members_count));
-        SET_VECTOR_ELT(Rout_result, 0, Rout_vars);
-        SET_VECTOR_ELT(Rout_result, 1, Rout_tuples);
-        SET_VECTOR_ELT(Rout_result, 2, Rout_igs);
+    if (collect_run_stats) {
+        set_run_stats_attrib(Rout_result, run_results.run_stats);
+    }
 
-        UNPROTECT(1 + result_members_count);
+    r_free_run_results(Rout_run_results);
 
-        return Rout_result;
-    }
+    UNPROTECT(2);
+
+    return Rout_result;
 }
 
 extern "C"
@@ -518,7 +1300,7 @@ SEXP r_discretize(
         SEXP Rin_seed,
         SEXP Rin_range)
 {
-    const R_len_t obj_count = Rf_length(Rin_variable);
+    const R_xlen_t obj_count = Rf_xlength(Rin_variable);
     const int discretization_nr = Rf_asInteger(Rin_discretization_nr);
     const int variable_idx = Rf_asInteger(Rin_variable_idx);
     const int divisions = Rf_asInteger(Rin_divisions);
@@ -526,11 +1308,25 @@ SEXP r_discretize(
     double range = Rf_asReal(Rin_range);
     double* variable = REAL(Rin_variable);
 
-    std::vector<double> sorted_variable(variable, variable + obj_count);
-    std::sort(sorted_variable.begin(), sorted_variable.end());
-
     uint8_t* discretized_variable = new uint8_t[obj_count];
-    discretize(seed, discretization_nr, variable_idx, divisions, obj_count, variable, sorted_variable, discretized_variable, range);
+
+    DiscretizationCache::Key key;
+    bool cached = false;
+    if (discretization_cache) {
+        key = DiscretizationCache::key(variable, obj_count, variable_idx, seed, discretization_nr, divisions, range);
+        cached = discretization_cache->find(key, discretized_variable);
+    }
+
+    if (!cached) {
+        std::vector<double> sorted_variable(variable, variable + obj_count);
+        std::sort(sorted_variable.begin(), sorted_variable.end());
+
+        discretize(seed, discretization_nr, variable_idx, divisions, obj_count, variable, sorted_variable, discretized_variable, range);
+
+        if (discretization_cache) {
+            discretization_cache->insert(key, discretized_variable);
+        }
+    }
     SEXP Rout_result = PROTECT(Rf_allocVector(INTSXP, obj_count));
     std::copy(discretized_variable, discretized_variable + obj_count, INTEGER(Rout_result));
     delete[] discretized_variable;
@@ -539,6 +1335,115 @@ SEXP r_discretize(
     return Rout_result;
 }
 
+extern "C"
+SEXP r_write_column_file(
+        SEXP Rin_data,
+        SEXP Rin_path,
+        SEXP Rin_float32,
+        SEXP Rin_append)
+{
+    const int* dataDims = INTEGER(Rf_getAttrib(Rin_data, R_DimSymbol));
+    const ColumnType type = Rf_asLogical(Rin_float32) ? ColumnType::Float32 : ColumnType::Float64;
+
+    // exceptions must not reach R, the error is raised once the exception is gone
+    char message[512] = "";
+    try {
+        write_column_file(CHAR(STRING_ELT(Rin_path, 0)), REAL(Rin_data), dataDims[0], dataDims[1], type,
+                          Rf_asLogical(Rin_append));
+    } catch (const std::exception& e) {
+        std::snprintf(message, sizeof(message), "%s", e.what());
+    }
+    if (message[0] != '\0') {
+        Rf_error("%s", message);
+    }
+
+    return R_NilValue;
+}
+
+extern "C"
+SEXP r_column_file_info(
+        SEXP Rin_path)
+{
+    const ColumnFileHeader header = r_column_file_header(Rin_path);
+
+    SEXP Rout_result = PROTECT(Rf_allocVector(REALSXP, 3));
+    REAL(Rout_result)[0] = header.object_count;
+    REAL(Rout_result)[1] = header.variable_count;
+    REAL(Rout_result)[2] = static_cast<double>(header.type);
+    UNPROTECT(1);
+
+    return Rout_result;
+}
+
+extern "C"
+SEXP r_bed_file_info(
+        SEXP Rin_path,
+        SEXP Rin_object_count)
+{
+    size_t variable_count = 0;
+
+    char message[512] = "";
+    try {
+        variable_count = bed_file_variables(CHAR(STRING_ELT(Rin_path, 0)), Rf_asInteger(Rin_object_count));
+    } catch (const std::exception& e) {
+        std::snprintf(message, sizeof(message), "%s", e.what());
+    }
+    if (message[0] != '\0') {
+        Rf_error("%s", message);
+    }
+
+    return Rf_ScalarReal(variable_count);
+}
+
+extern "C"
+SEXP r_set_discretization_cache(
+        SEXP Rin_max_bytes,
+        SEXP Rin_spill_dir)
+{
+    const double max_bytes = Rf_asReal(Rin_max_bytes);
+
+    // the previous cache (with its spill file) goes in any case
+    discretization_cache.reset();
+    if (max_bytes <= 0) {
+        return R_NilValue;
+    }
+
+    // exceptions must not reach R, the error is raised once the exception is gone
+    char message[512] = "";
+    try {
+        const std::string spill_dir = Rf_isNull(Rin_spill_dir) ? "" : CHAR(STRING_ELT(Rin_spill_dir, 0));
+        discretization_cache.reset(new DiscretizationCache(max_bytes, spill_dir));
+    } catch (const std::exception& e) {
+        std::snprintf(message, sizeof(message), "%s", e.what());
+    }
+    if (message[0] != '\0') {
+        Rf_error("%s", message);
+    }
+
+    return R_NilValue;
+}
+
+extern "C"
+SEXP r_discretization_cache_stats()
+{
+    if (!discretization_cache) {
+        return R_NilValue;
+    }
+    const DiscretizationCacheStats stats = discretization_cache->stats();
+
+    // as double because they easily overflow int
+    SEXP Rout_result = PROTECT(Rf_allocVector(REALSXP, 6));
+    REAL(Rout_result)[0] = stats.hits;
+    REAL(Rout_result)[1] = stats.misses;
+    REAL(Rout_result)[2] = stats.entropy_hits;
+    REAL(Rout_result)[3] = stats.variables;
+    REAL(Rout_result)[4] = stats.memory_bytes;
+    REAL(Rout_result)[5] = stats.spilled_bytes;
+    UNPROTECT(1);
+
+    return Rout_result;
+}
+
 extern "C"
 SEXP r_omp_set_num_threads(
         SEXP Rin_num_threads)
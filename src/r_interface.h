@@ -18,7 +18,78 @@ SEXP r_compute_max_ig(
 	SEXP Rin_interesting_vars,
 	SEXP Rin_require_all_vars,
 	SEXP Rin_return_tuples,
-	SEXP Rin_use_cuda
+	SEXP Rin_use_cuda,
+	SEXP Rin_collect_run_stats,
+	SEXP Rin_progress,
+	SEXP Rin_contrast_indices,
+	SEXP Rin_return_discretizations,
+	SEXP Rin_lower_entropies_max_bytes
+);
+
+extern "C"
+SEXP r_compute_screened_max_ig(
+	SEXP Rin_data,
+	SEXP Rin_decision,
+	SEXP Rin_dimensions,
+	SEXP Rin_divisions,
+	SEXP Rin_discretizations,
+	SEXP Rin_seed,
+	SEXP Rin_range,
+	SEXP Rin_pseudocount,
+	SEXP Rin_screen_dimensions,
+	SEXP Rin_screen_top,
+	SEXP Rin_screen_partners,
+	SEXP Rin_require_all_vars,
+	SEXP Rin_return_tuples,
+	SEXP Rin_progress
+);
+
+extern "C"
+SEXP r_compute_max_ig_decisions(
+	SEXP Rin_data,
+	SEXP Rin_decisions,
+	SEXP Rin_dimensions,
+	SEXP Rin_divisions,
+	SEXP Rin_discretizations,
+	SEXP Rin_seed,
+	SEXP Rin_range,
+	SEXP Rin_pseudocount,
+	SEXP Rin_interesting_vars,
+	SEXP Rin_require_all_vars,
+	SEXP Rin_progress
+);
+
+extern "C"
+SEXP r_compute_max_ig_replicates(
+	SEXP Rin_data,
+	SEXP Rin_decision,
+	SEXP Rin_weights,
+	SEXP Rin_dimensions,
+	SEXP Rin_divisions,
+	SEXP Rin_discretizations,
+	SEXP Rin_seed,
+	SEXP Rin_range,
+	SEXP Rin_pseudocount,
+	SEXP Rin_interesting_vars,
+	SEXP Rin_require_all_vars,
+	SEXP Rin_progress
+);
+
+extern "C"
+SEXP r_compute_max_ig_folds(
+	SEXP Rin_data,
+	SEXP Rin_decision,
+	SEXP Rin_folds,
+	SEXP Rin_fold_count,
+	SEXP Rin_dimensions,
+	SEXP Rin_divisions,
+	SEXP Rin_discretizations,
+	SEXP Rin_seed,
+	SEXP Rin_range,
+	SEXP Rin_pseudocount,
+	SEXP Rin_interesting_vars,
+	SEXP Rin_require_all_vars,
+	SEXP Rin_progress
 );
 
 extern "C"
@@ -32,7 +103,12 @@ SEXP r_compute_max_ig_discrete(
 	SEXP Rin_interesting_vars,
 	SEXP Rin_require_all_vars,
 	SEXP Rin_return_tuples,
-	SEXP Rin_use_cuda
+	SEXP Rin_use_cuda,
+	SEXP Rin_collect_run_stats,
+	SEXP Rin_progress,
+	SEXP Rin_weights,
+	SEXP Rin_deduplicate,
+	SEXP Rin_lower_entropies_max_bytes
 );
 
 extern "C"
@@ -51,7 +127,9 @@ SEXP r_compute_all_matching_tuples(
 	SEXP Rin_I_lower,
 	SEXP Rin_return_matrix,
 	SEXP Rin_stat_mode,
-	SEXP Rin_average
+	SEXP Rin_average,
+	SEXP Rin_collect_run_stats,
+	SEXP Rin_progress
 );
 
 extern "C"
@@ -66,7 +144,11 @@ SEXP r_compute_all_matching_tuples_discrete(
 	SEXP Rin_ig_thr,
 	SEXP Rin_I_lower,
 	SEXP Rin_return_matrix,
-	SEXP Rin_stat_mode
+	SEXP Rin_stat_mode,
+	SEXP Rin_collect_run_stats,
+	SEXP Rin_progress,
+	SEXP Rin_weights,
+	SEXP Rin_deduplicate
 );
 
 extern "C"
@@ -79,6 +161,34 @@ SEXP r_discretize(
 	SEXP Rin_range
 );
 
+extern "C"
+SEXP r_write_column_file(
+	SEXP Rin_data,
+	SEXP Rin_path,
+	SEXP Rin_float32,
+	SEXP Rin_append
+);
+
+extern "C"
+SEXP r_column_file_info(
+	SEXP Rin_path
+);
+
+extern "C"
+SEXP r_bed_file_info(
+	SEXP Rin_path,
+	SEXP Rin_object_count
+);
+
+extern "C"
+SEXP r_set_discretization_cache(
+	SEXP Rin_max_bytes,
+	SEXP Rin_spill_dir
+);
+
+extern "C"
+SEXP r_discretization_cache_stats();
+
 extern "C"
 SEXP r_omp_set_num_threads(
 	SEXP Rin_num_threads